@@ -0,0 +1,27 @@
+#include <derplib/base/benchmark.h>
+#include <derplib/base/hdr_histogram.h>
+
+#include <cstdint>
+
+namespace {
+DERPLIB_BENCHMARK(hdr_histogram_record) {
+  derplib::hdr_histogram h{};
+  std::uint64_t value{1};
+  state.measure([&] {
+    h.record(value);
+    value = value * 6364136223846793005U + 1442695040888963407U;
+    value >>= 24;
+  });
+  derplib::do_not_optimize(h.count());
+}
+
+DERPLIB_BENCHMARK(concurrent_hdr_histogram_record) {
+  derplib::concurrent_hdr_histogram h{};
+  std::uint64_t value{1};
+  state.measure([&] {
+    h.record(value);
+    value = value * 6364136223846793005U + 1442695040888963407U;
+    value >>= 24;
+  });
+}
+}  // namespace
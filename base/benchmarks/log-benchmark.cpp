@@ -0,0 +1,73 @@
+#include <derplib/base/benchmark.h>
+#include <derplib/base/log.h>
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+namespace {
+/**
+ * \brief A stream buffer which discards everything written to it.
+ */
+class null_streambuf : public std::streambuf {
+ protected:
+  int_type overflow(const int_type c) override { return traits_type::not_eof(c); }
+  std::streamsize xsputn(const char*, const std::streamsize count) override { return count; }
+};
+
+DERPLIB_BENCHMARK(logger_info) {
+  null_streambuf buf{};
+  std::ostream os{&buf};
+  derplib::logger l{os, derplib::logger::level::verbose};
+
+  const std::string message{"Request handled"};
+  state.measure([&] { l.i(message); });
+}
+
+DERPLIB_BENCHMARK(logger_filtered) {
+  null_streambuf buf{};
+  std::ostream os{&buf};
+  derplib::logger l{os, derplib::logger::level::info};
+
+  // Forces the level to be reloaded in every iteration, as it would be in a real call site.
+  const std::string message{"Request handled"};
+  state.measure([&] {
+    l.d(message);
+    derplib::clobber_memory();
+  });
+}
+
+DERPLIB_BENCHMARK(logger_filtered_concat) {
+  null_streambuf buf{};
+  std::ostream os{&buf};
+  derplib::logger l{os, derplib::logger::level::info};
+
+  int id{0};
+  state.measure([&] {
+    l.d("Request " + std::to_string(++id) + " handled");
+    derplib::clobber_memory();
+  });
+}
+
+DERPLIB_BENCHMARK(logger_filtered_lazy) {
+  null_streambuf buf{};
+  std::ostream os{&buf};
+  derplib::logger l{os, derplib::logger::level::info};
+
+  int id{0};
+  state.measure([&] {
+    DERPLIB_LOG_D(l, "Request " + std::to_string(++id) + " handled");
+    derplib::clobber_memory();
+  });
+}
+
+DERPLIB_BENCHMARK(async_logger_info) {
+  null_streambuf buf{};
+  std::ostream os{&buf};
+  derplib::logger l{os, derplib::logger::level::verbose, derplib::logger::async_config{}};
+
+  const std::string message{"Request handled"};
+  state.measure([&] { l.i(message); });
+  l.flush();
+}
+}  // namespace
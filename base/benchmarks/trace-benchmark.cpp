@@ -0,0 +1,46 @@
+#include <derplib/base/benchmark.h>
+#include <derplib/base/trace.h>
+
+#include <cstddef>
+
+namespace {
+/**
+ * \brief Number of events recorded between clears, which must not exceed the buffer capacity so that no event is
+ * dropped.
+ */
+constexpr std::size_t events_per_clear{16384};
+
+// Reads the clock as often as a zone does, so that the cost of recording is the difference to `trace_zone`.
+DERPLIB_BENCHMARK(trace_zone_clock_reads) {
+  state.measure([] {
+    derplib::do_not_optimize(derplib::tsc_clock::now());
+    derplib::do_not_optimize(derplib::tsc_clock::now());
+  });
+}
+
+DERPLIB_BENCHMARK(trace_zone) {
+  derplib::tracer::clear();
+
+  std::size_t events{0};
+  state.measure([&] {
+    if (++events == events_per_clear) {
+      derplib::tracer::clear();
+      events = 0;
+    }
+    derplib::trace_zone zone{"zone"};
+  });
+}
+
+DERPLIB_BENCHMARK(trace_instant) {
+  derplib::tracer::clear();
+
+  std::size_t events{0};
+  state.measure([&] {
+    if (++events == events_per_clear) {
+      derplib::tracer::clear();
+      events = 0;
+    }
+    derplib::tracer::instant("instant");
+  });
+}
+}  // namespace
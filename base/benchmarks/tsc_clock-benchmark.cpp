@@ -0,0 +1,15 @@
+#include <derplib/base/benchmark.h>
+#include <derplib/base/tsc_clock.h>
+
+#include <chrono>
+
+namespace {
+DERPLIB_BENCHMARK(steady_clock_now) {
+  state.measure([] { derplib::do_not_optimize(std::chrono::steady_clock::now()); });
+}
+
+DERPLIB_BENCHMARK(tsc_clock_now) {
+  derplib::do_not_optimize(derplib::tsc_clock::now());
+  state.measure([] { derplib::do_not_optimize(derplib::tsc_clock::now()); });
+}
+}  // namespace
@@ -0,0 +1,510 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <derplib/base/stopwatch.h>
+
+namespace derplib {
+namespace internal {
+#if !defined(__GNUC__) && !defined(__clang__)
+/**
+ * \brief Stores a pointer into a volatile variable, so that the compiler must assume the pointee is read.
+ */
+inline void _benchmark_escape(const void* p) noexcept {
+  static const void* volatile sink{nullptr};
+  sink = p;
+}
+#endif  // !defined(__GNUC__) && !defined(__clang__)
+
+/**
+ * \brief Number of allocations made through the global `operator new`, which is counted once it is replaced by
+ * `DERPLIB_BENCHMARK_TRACK_ALLOCATIONS`.
+ */
+struct _benchmark_allocation_counters {
+  std::atomic<std::uint64_t> _allocations;
+  std::atomic<std::uint64_t> _bytes;
+  /**
+   * \brief Whether the global `operator new` is replaced, i.e. whether the counters are meaningful.
+   */
+  std::atomic<bool> _tracked;
+};
+
+inline _benchmark_allocation_counters& _benchmark_allocations() noexcept {
+  static _benchmark_allocation_counters counters{};
+  return counters;
+}
+
+inline void _benchmark_record_allocation(const std::size_t size) noexcept {
+  auto& counters{_benchmark_allocations()};
+  counters._allocations.fetch_add(1, std::memory_order_relaxed);
+  counters._bytes.fetch_add(size, std::memory_order_relaxed);
+}
+}  // namespace internal
+
+inline namespace base {
+
+/**
+ * \brief Prevents the compiler from optimizing away the computation of `value`.
+ *
+ * \param value value which must be computed
+ */
+template<typename T>
+inline void do_not_optimize(const T& value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __asm__ __volatile__("" : : "r,m"(value) : "memory");
+#else
+  internal::_benchmark_escape(&value);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif  // defined(__GNUC__) || defined(__clang__)
+}
+
+/**
+ * \brief Prevents the compiler from reordering or eliding memory accesses across this call, so that all pending
+ * writes are performed.
+ */
+inline void clobber_memory() noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  __asm__ __volatile__("" : : : "memory");
+#else
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif  // defined(__GNUC__) || defined(__clang__)
+}
+
+/**
+ * \brief Result of a benchmark. Times are per iteration.
+ */
+struct benchmark_result {
+  /**
+   * \brief Name of the benchmark.
+   */
+  std::string name;
+  /**
+   * \brief Number of iterations in each sample.
+   */
+  std::uint64_t iterations;
+  /**
+   * \brief Time per iteration of each sample, in nanoseconds.
+   */
+  std::vector<double> samples_ns;
+  /**
+   * \brief Median time per iteration, in nanoseconds.
+   */
+  double median_ns;
+  /**
+   * \brief Median absolute deviation of the time per iteration from `median_ns`, in nanoseconds.
+   */
+  double mad_ns;
+  /**
+   * \brief Mean number of bytes allocated per iteration, or `0` if allocations are not tracked.
+   */
+  double bytes_per_op;
+  /**
+   * \brief Mean number of allocations per iteration, or `0` if allocations are not tracked.
+   */
+  double allocations_per_op;
+};
+
+/**
+ * \brief Benchmark configuration.
+ */
+struct benchmark_config {
+  /**
+   * \brief Minimum time to run a benchmark before taking samples.
+   */
+  std::chrono::nanoseconds warmup_time{std::chrono::milliseconds{100}};
+  /**
+   * \brief Minimum duration of a sample. The number of iterations per sample is doubled until a sample takes at least
+   * this long.
+   */
+  std::chrono::nanoseconds min_sample_time{std::chrono::milliseconds{5}};
+  /**
+   * \brief Number of samples to take.
+   */
+  std::size_t samples = 30;
+};
+
+/**
+ * \brief State passed to a benchmark, used to measure the code under test.
+ */
+class benchmark_state {
+ public:
+  /**
+   * \param name name of the benchmark
+   * \param cfg benchmark configuration
+   */
+  benchmark_state(std::string name, const benchmark_config& cfg) : _name{std::move(name)}, _config{cfg} {}
+
+  /**
+   * \brief Measures the time taken by a callable.
+   *
+   * `body` is invoked repeatedly until `benchmark_config::warmup_time` has elapsed, while the number of iterations
+   * per sample is scaled up until a sample takes at least `benchmark_config::min_sample_time`. Samples are then taken
+   * with a fixed number of iterations. Use `do_not_optimize` and `clobber_memory` to prevent the compiler from
+   * eliminating the work done by `body`.
+   *
+   * If allocations are tracked, the number of allocations and bytes allocated per iteration are counted while samples
+   * are taken.
+   *
+   * Setup which should not be measured should be done before calling this function. Calling this function again
+   * replaces the previous result.
+   *
+   * \param body callable to measure, with a prototype of `void f()`
+   */
+  template<typename F>
+  void measure(F&& body) {
+    // Caps the number of iterations, in case the body is optimized away and takes no time. The cap is low enough that
+    // a sample still finishes in about a second if only the loop itself remains.
+    constexpr std::uint64_t max_iterations{std::uint64_t{1} << 30};
+
+    std::uint64_t iterations{1};
+    const auto warmup_end{stopwatch::clock::now() + _config.warmup_time};
+    for (;;) {
+      const auto elapsed{_run(body, iterations)};
+      if (elapsed < _config.min_sample_time && iterations < max_iterations) {
+        iterations *= 2;
+      } else if (stopwatch::clock::now() >= warmup_end) {
+        break;
+      }
+    }
+
+    const std::size_t samples{std::max(_config.samples, std::size_t{1})};
+    benchmark_result result{_name, iterations, {}, 0.0, 0.0, 0.0, 0.0};
+    result.samples_ns.reserve(samples);
+
+    const auto& allocations{internal::_benchmark_allocations()};
+    const std::uint64_t allocations_before{allocations._allocations.load(std::memory_order_relaxed)};
+    const std::uint64_t bytes_before{allocations._bytes.load(std::memory_order_relaxed)};
+    for (std::size_t i{0}; i < samples; ++i) {
+      const auto elapsed{std::chrono::duration<double, std::nano>{_run(body, iterations)}};
+      result.samples_ns.push_back(elapsed.count() / static_cast<double>(iterations));
+    }
+    const std::uint64_t allocations_after{allocations._allocations.load(std::memory_order_relaxed)};
+    const std::uint64_t bytes_after{allocations._bytes.load(std::memory_order_relaxed)};
+
+    if (allocations._tracked.load()) {
+      const double ops{static_cast<double>(iterations) * static_cast<double>(samples)};
+      result.allocations_per_op = static_cast<double>(allocations_after - allocations_before) / ops;
+      result.bytes_per_op = static_cast<double>(bytes_after - bytes_before) / ops;
+    }
+
+    result.median_ns = _median(result.samples_ns);
+    std::vector<double> deviations{};
+    deviations.reserve(result.samples_ns.size());
+    for (const double sample : result.samples_ns) {
+      deviations.push_back(std::abs(sample - result.median_ns));
+    }
+    result.mad_ns = _median(deviations);
+
+    _result_ = std::move(result);
+    _has_result_ = true;
+  }
+
+  /**
+   * \return Name of the benchmark.
+   */
+  const std::string& name() const noexcept { return _name; }
+
+  /**
+   * \return Whether `measure()` has been called.
+   */
+  bool has_result() const noexcept { return _has_result_; }
+
+  /**
+   * \return The result of the last call to `measure()`.
+   */
+  const benchmark_result& result() const noexcept { return _result_; }
+
+ private:
+  template<typename F>
+  static std::chrono::nanoseconds _run(F& body, const std::uint64_t iterations) {
+    stopwatch sw{};
+    sw.start();
+    for (std::uint64_t i{0}; i < iterations; ++i) {
+      body();
+    }
+    sw.stop();
+    return sw.duration();
+  }
+
+  static double _median(std::vector<double> values) {
+    if (values.empty()) {
+      return 0.0;
+    }
+
+    const auto mid{values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2)};
+    std::nth_element(values.begin(), mid, values.end());
+    if (values.size() % 2 != 0) {
+      return *mid;
+    }
+    return (*mid + *std::max_element(values.begin(), mid)) / 2.0;
+  }
+
+  const std::string _name;
+  const benchmark_config _config;
+
+  benchmark_result _result_{};
+  bool _has_result_ = false;
+};
+
+/**
+ * \brief Type of a benchmark function.
+ */
+using benchmark_function = std::function<void(benchmark_state&)>;
+
+/**
+ * \brief Registers a benchmark, to be run by `run_benchmarks()`.
+ *
+ * Prefer `DERPLIB_BENCHMARK`, which registers a benchmark during static initialization.
+ *
+ * \param name name of the benchmark
+ * \param function function which sets up and measures the benchmark
+ */
+inline void register_benchmark(std::string name, benchmark_function function);
+
+/**
+ * \brief Runs the registered benchmarks whose name contains `filter`, in order of registration.
+ *
+ * \param cfg benchmark configuration
+ * \param filter substring which the names of the benchmarks to run must contain
+ * \return The results of the benchmarks which called `benchmark_state::measure()`.
+ */
+inline std::vector<benchmark_result> run_benchmarks(const benchmark_config& cfg, const std::string& filter = "");
+
+/**
+ * \brief Writes benchmark results as a table, with one row per benchmark.
+ *
+ * \param os stream to write to
+ * \param results results to write
+ */
+inline void print_benchmark_results(std::ostream& os, const std::vector<benchmark_result>& results);
+
+/**
+ * \brief Type of a function which writes benchmark results to the file at `path`, returning whether it succeeded.
+ */
+using benchmark_file_writer = bool (*)(const std::string& path, const std::vector<benchmark_result>& results);
+
+/**
+ * \brief Entry point of a benchmark executable, which runs the registered benchmarks and prints their results.
+ *
+ * Accepts the following arguments:
+ *
+ * - `--filter=<substring>`: only runs benchmarks whose name contains the substring
+ * - `--samples=<n>`: number of samples to take
+ * - `--min-sample-ms=<n>`: minimum duration of a sample in milliseconds
+ * - `--warmup-ms=<n>`: minimum warmup time in milliseconds
+ * - `--json=<file>`: also writes the results to a file using `write_json`
+ *
+ * \param write_json function which writes the results as JSON, e.g. `write_benchmark_json_file()` from
+ * `<derplib/base/benchmark_report.h>`. If null, `--json` is rejected.
+ * \return `0` on success, or `1` if the arguments are invalid or the JSON file cannot be written
+ */
+inline int benchmark_main(int argc, char** argv, benchmark_file_writer write_json = nullptr);
+
+}  // namespace base
+
+namespace internal {
+struct _registered_benchmark {
+  std::string _name;
+  benchmark_function _function;
+};
+
+inline std::vector<_registered_benchmark>& _benchmark_registry() {
+  static std::vector<_registered_benchmark> registry{};
+  return registry;
+}
+
+/**
+ * \brief Registers a benchmark on construction.
+ */
+struct _benchmark_registrar {
+  _benchmark_registrar(const char* name, void (*function)(benchmark_state&)) { register_benchmark(name, function); }
+};
+
+/**
+ * \brief Enables reporting of allocations on construction.
+ */
+struct _benchmark_allocation_tracker {
+  _benchmark_allocation_tracker() noexcept { _benchmark_allocations()._tracked.store(true); }
+};
+
+/**
+ * \return Whether `arg` starts with `prefix`, in which case `value` is set to the remainder of `arg`.
+ */
+inline bool _parse_benchmark_arg(const std::string& arg, const std::string& prefix, std::string& value) {
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+/**
+ * \return Whether `str` is a non-negative integer, in which case `value` is set to its value.
+ */
+inline bool _parse_benchmark_uint(const std::string& str, unsigned long long& value) {
+  if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  value = std::strtoull(str.c_str(), nullptr, 10);
+  return true;
+}
+}  // namespace internal
+
+inline namespace base {
+
+void register_benchmark(std::string name, benchmark_function function) {
+  internal::_benchmark_registry().push_back(internal::_registered_benchmark{std::move(name), std::move(function)});
+}
+
+std::vector<benchmark_result> run_benchmarks(const benchmark_config& cfg, const std::string& filter) {
+  std::vector<benchmark_result> results{};
+  for (const auto& benchmark : internal::_benchmark_registry()) {
+    if (benchmark._name.find(filter) == std::string::npos) {
+      continue;
+    }
+
+    benchmark_state state{benchmark._name, cfg};
+    benchmark._function(state);
+    if (state.has_result()) {
+      results.push_back(state.result());
+    }
+  }
+  return results;
+}
+
+void print_benchmark_results(std::ostream& os, const std::vector<benchmark_result>& results) {
+  std::size_t name_width{9};
+  for (const auto& result : results) {
+    name_width = std::max(name_width, result.name.size());
+  }
+
+  const auto flags{os.flags()};
+  const auto precision{os.precision()};
+  os << std::fixed << std::setprecision(3);
+
+  os << std::left << std::setw(static_cast<int>(name_width)) << "Benchmark" << std::right << std::setw(14)
+     << "Iterations" << std::setw(16) << "Median (ns)" << std::setw(14) << "MAD (ns)" << std::setw(14) << "Bytes/op"
+     << std::setw(14) << "Allocs/op" << '\n';
+  for (const auto& result : results) {
+    os << std::left << std::setw(static_cast<int>(name_width)) << result.name << std::right << std::setw(14)
+       << result.iterations << std::setw(16) << result.median_ns << std::setw(14) << result.mad_ns << std::setw(14)
+       << result.bytes_per_op << std::setw(14) << result.allocations_per_op << '\n';
+  }
+
+  os.flags(flags);
+  os.precision(precision);
+}
+
+int benchmark_main(const int argc, char** argv, const benchmark_file_writer write_json) {
+  benchmark_config cfg{};
+  std::string filter{};
+  std::string json_path{};
+
+  for (int i{1}; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    std::string value{};
+    unsigned long long number{0};
+
+    if (internal::_parse_benchmark_arg(arg, "--filter=", value)) {
+      filter = value;
+    } else if (internal::_parse_benchmark_arg(arg, "--samples=", value) &&
+               internal::_parse_benchmark_uint(value, number) && number > 0) {
+      cfg.samples = static_cast<std::size_t>(number);
+    } else if (internal::_parse_benchmark_arg(arg, "--min-sample-ms=", value) &&
+               internal::_parse_benchmark_uint(value, number)) {
+      cfg.min_sample_time = std::chrono::milliseconds{static_cast<std::chrono::milliseconds::rep>(number)};
+    } else if (internal::_parse_benchmark_arg(arg, "--warmup-ms=", value) &&
+               internal::_parse_benchmark_uint(value, number)) {
+      cfg.warmup_time = std::chrono::milliseconds{static_cast<std::chrono::milliseconds::rep>(number)};
+    } else if (write_json != nullptr && internal::_parse_benchmark_arg(arg, "--json=", value) && !value.empty()) {
+      json_path = value;
+    } else {
+      std::cerr << "Unrecognized argument: " << arg << '\n';
+      return 1;
+    }
+  }
+
+  const auto results{run_benchmarks(cfg, filter)};
+  print_benchmark_results(std::cout, results);
+
+  if (!json_path.empty() && !write_json(json_path, results)) {
+    std::cerr << "Cannot write to " << json_path << '\n';
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace base
+}  // namespace derplib
+
+#define DERPLIB_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define DERPLIB_BENCHMARK_CONCAT(a, b) DERPLIB_BENCHMARK_CONCAT_IMPL(a, b)
+
+/**
+ * \brief Defines and registers a benchmark named `name`.
+ *
+ * The definition is followed by the body of the benchmark, which receives a `derplib::benchmark_state&` named `state`:
+ *
+ * \code
+ * DERPLIB_BENCHMARK(vector_push_back) {
+ *   std::vector<int> v{};
+ *   state.measure([&] { v.push_back(0); });
+ * }
+ * \endcode
+ */
+#define DERPLIB_BENCHMARK(name)                                                                  \
+  static void DERPLIB_BENCHMARK_CONCAT(_derplib_benchmark_, name)(::derplib::benchmark_state&);  \
+  static const ::derplib::internal::_benchmark_registrar                                         \
+      DERPLIB_BENCHMARK_CONCAT(_derplib_benchmark_registrar_, name){                             \
+          #name, &DERPLIB_BENCHMARK_CONCAT(_derplib_benchmark_, name)};                          \
+  static void DERPLIB_BENCHMARK_CONCAT(_derplib_benchmark_, name)(::derplib::benchmark_state & state)
+
+#if defined(__cpp_sized_deallocation)
+#define DERPLIB_BENCHMARK_SIZED_DELETE() \
+  void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+#else
+#define DERPLIB_BENCHMARK_SIZED_DELETE()
+#endif  // defined(__cpp_sized_deallocation)
+
+/**
+ * \brief Replaces the global `operator new` and `operator delete`, so that benchmarks report the number of allocations
+ * and bytes allocated per iteration.
+ *
+ * Must be used at most once in a program, at namespace scope. Allocations made through the aligned overloads of
+ * `operator new` are not counted.
+ */
+#define DERPLIB_BENCHMARK_TRACK_ALLOCATIONS()                                                    \
+  void* operator new(std::size_t size) {                                                         \
+    ::derplib::internal::_benchmark_record_allocation(size);                                     \
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {                                           \
+      return p;                                                                                  \
+    }                                                                                            \
+    throw std::bad_alloc{};                                                                      \
+  }                                                                                              \
+  void operator delete(void* p) noexcept { std::free(p); }                                       \
+  DERPLIB_BENCHMARK_SIZED_DELETE()                                                               \
+  static const ::derplib::internal::_benchmark_allocation_tracker _derplib_benchmark_allocation_tracker{}
+
+/**
+ * \brief Defines a `main` function which calls `derplib::benchmark_main()`, and tracks allocations using
+ * `DERPLIB_BENCHMARK_TRACK_ALLOCATIONS`.
+ */
+#define DERPLIB_BENCHMARK_MAIN()                  \
+  DERPLIB_BENCHMARK_TRACK_ALLOCATIONS();          \
+  int main(int argc, char** argv) {               \
+    return ::derplib::benchmark_main(argc, argv); \
+  }
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <derplib/base/benchmark.h>
+
+namespace derplib {
+inline namespace base {
+
+/**
+ * \brief Describes the machine and build which produced a set of benchmark results.
+ */
+struct benchmark_context {
+  /**
+   * \brief Model name of the CPU, or an empty string if it cannot be determined.
+   */
+  std::string cpu_model;
+  /**
+   * \brief Number of logical CPUs, or `0` if it cannot be determined.
+   */
+  unsigned cpu_count;
+  /**
+   * \brief Compiler which built the benchmarks.
+   */
+  std::string compiler;
+  /**
+   * \brief Either `"release"` or `"debug"`, depending on whether `NDEBUG` is defined.
+   */
+  std::string build_type;
+  /**
+   * \brief Whether allocations are tracked, i.e. whether `benchmark_result::bytes_per_op` and
+   * `benchmark_result::allocations_per_op` are meaningful.
+   */
+  bool allocations_tracked;
+};
+
+/**
+ * \brief Benchmark results and the context they were produced in.
+ */
+struct benchmark_report {
+  benchmark_context context;
+  std::vector<benchmark_result> results;
+};
+
+/**
+ * \brief Reports errors that are caused by reading malformed benchmark JSON.
+ */
+class benchmark_format_error final : public std::runtime_error {
+ public:
+  explicit benchmark_format_error(const char* what_arg);
+  explicit benchmark_format_error(const std::string& what_arg);
+
+  benchmark_format_error(const benchmark_format_error&);
+  benchmark_format_error(benchmark_format_error&&) noexcept;
+
+  benchmark_format_error& operator=(const benchmark_format_error&);
+  benchmark_format_error& operator=(benchmark_format_error&&) noexcept;
+
+  ~benchmark_format_error() final;
+};
+
+/**
+ * \return The context of the running program.
+ */
+benchmark_context current_benchmark_context();
+
+/**
+ * \brief Writes benchmark results as JSON.
+ *
+ * The output is an object with a `context` object, containing the members of `benchmark_context`, and a `benchmarks`
+ * array, containing one object per result with the members `name`, `iterations`, `ns_per_op` (the median), `mad_ns`,
+ * `bytes_per_op`, `allocations_per_op` and `samples_ns`.
+ *
+ * \param os stream to write to
+ * \param context context the results were produced in
+ * \param results results to write
+ */
+void write_benchmark_json(std::ostream& os, const benchmark_context& context,
+                          const std::vector<benchmark_result>& results);
+
+/**
+ * \brief Writes benchmark results of the running program as JSON to a file, together with
+ * `current_benchmark_context()`.
+ *
+ * Can be passed to `benchmark_main()` to enable its `--json` argument.
+ *
+ * \param path path of the file to write
+ * \param results results to write
+ * \return Whether the file is written successfully.
+ */
+bool write_benchmark_json_file(const std::string& path, const std::vector<benchmark_result>& results);
+
+/**
+ * \brief Reads benchmark results written by `write_benchmark_json()`. Unknown members are ignored.
+ *
+ * \param is stream to read from
+ * \return The results and their context.
+ * \throw benchmark_format_error if the input is not valid JSON, or does not have the expected structure
+ */
+benchmark_report read_benchmark_json(std::istream& is);
+
+/**
+ * \brief Performs a two-sided Mann-Whitney U test, which tests whether values drawn from one sample tend to be larger
+ * than values drawn from the other, without assuming that the samples are normally distributed.
+ *
+ * The p-value is computed using the normal approximation with tie and continuity correction, which is accurate for
+ * samples of about 10 or more values each.
+ *
+ * \param a first sample
+ * \param b second sample
+ * \return The probability of observing a difference at least as large if both samples come from the same
+ * distribution, or `1` if either sample is empty.
+ */
+double mann_whitney_u_test(const std::vector<double>& a, const std::vector<double>& b);
+
+/**
+ * \brief Outcome of comparing a benchmark between two runs.
+ */
+enum struct benchmark_verdict {
+  /**
+   * \brief The difference is either not significant or below the threshold.
+   */
+  unchanged,
+  /**
+   * \brief The benchmark is significantly faster, by more than the threshold.
+   */
+  improved,
+  /**
+   * \brief The benchmark is significantly slower, by more than the threshold.
+   */
+  regressed
+};
+
+/**
+ * \brief Comparison configuration.
+ */
+struct benchmark_compare_config {
+  /**
+   * \brief Minimum relative change in the median time for a difference to be reported, e.g. `0.05` for 5%.
+   */
+  double threshold = 0.05;
+  /**
+   * \brief Significance level which the p-value of the Mann-Whitney U test must be below for a difference to be
+   * reported.
+   */
+  double alpha = 0.05;
+};
+
+/**
+ * \brief Comparison of a benchmark between a baseline run and a contender run.
+ */
+struct benchmark_comparison {
+  std::string name;
+  double baseline_ns;
+  double contender_ns;
+  /**
+   * \brief Relative change of the median time from the baseline, e.g. `0.1` if the contender is 10% slower.
+   */
+  double change;
+  /**
+   * \brief p-value of the Mann-Whitney U test over the samples of both runs.
+   */
+  double p_value;
+  benchmark_verdict verdict;
+};
+
+/**
+ * \brief Compares the benchmarks which are present in both runs, in the order of the baseline.
+ *
+ * \param baseline results of the baseline run
+ * \param contender results of the run to compare against the baseline
+ * \param cfg comparison configuration
+ * \return One comparison per benchmark which is present in both runs.
+ */
+std::vector<benchmark_comparison> compare_benchmarks(const benchmark_report& baseline,
+                                                     const benchmark_report& contender,
+                                                     const benchmark_compare_config& cfg = benchmark_compare_config{});
+
+/**
+ * \brief Writes benchmark comparisons as a table, with one row per benchmark.
+ *
+ * \param os stream to write to
+ * \param comparisons comparisons to write
+ */
+void print_benchmark_comparisons(std::ostream& os, const std::vector<benchmark_comparison>& comparisons);
+
+}  // namespace base
+}  // namespace derplib
+
+/**
+ * \brief Defines a `main` function like `DERPLIB_BENCHMARK_MAIN`, which additionally accepts `--json=<file>` to write
+ * the results using `derplib::write_benchmark_json_file()`.
+ */
+#define DERPLIB_BENCHMARK_JSON_MAIN()                                                    \
+  DERPLIB_BENCHMARK_TRACK_ALLOCATIONS();                                                 \
+  int main(int argc, char** argv) {                                                      \
+    return ::derplib::benchmark_main(argc, argv, &::derplib::write_benchmark_json_file); \
+  }
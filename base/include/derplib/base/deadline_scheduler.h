@@ -0,0 +1,340 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <derplib/base/timer_stats.h>
+
+namespace derplib {
+inline namespace base {
+
+#include <derplib/internal/common_macros_begin.h>
+
+/**
+ * \brief A scheduler which invokes callbacks at arbitrary deadlines, using a single driver thread.
+ *
+ * Tasks are kept in a 4-ary min-heap ordered by deadline, with tasks of equal deadlines invoked in the order they are
+ * scheduled. Scheduling a task takes `O(log n)` time, and the next deadline is available in constant time. The driver
+ * thread sleeps until the earliest deadline, and invokes all tasks which have expired by then as one batch.
+ * Tasks scheduled with a slack are ordered by their deadline plus slack instead, as described below.
+ *
+ * Cancelled tasks are not removed from the heaps immediately. Instead, their entries become tombstones which are
+ * discarded when they reach the top of a heap, or when tombstones make up more than half of a heap.
+ *
+ * Unlike `timer_service`, deadlines are not rounded to a tick, which makes this suitable for tasks with arbitrary
+ * deadlines such as retries with backoff.
+ *
+ * Each task may be given a slack, which allows the task to be invoked up to that duration after its deadline. Every
+ * task is kept in a second heap, ordered by the latest time the task may be invoked, and the driver thread only wakes
+ * up at the earliest of those times. On waking up, every task whose deadline has passed is taken from the top of the
+ * deadline-ordered heap and invoked in the same batch, so that tasks with nearby deadlines share a single wakeup
+ * instead of waking the driver thread one by one.
+ */
+class deadline_scheduler {
+ public:
+  /**
+   * \brief Clock used to measure deadlines.
+   */
+  using clock = std::chrono::steady_clock;
+  /**
+   * \brief Type of a task.
+   */
+  using callback_type = std::function<void()>;
+  /**
+   * \brief Type of a function which invokes a task.
+   */
+  using executor_type = std::function<void(callback_type)>;
+
+  /**
+   * \brief Scheduler configuration.
+   */
+  struct config {
+    /**
+     * \brief Function used to dispatch expired tasks. If empty, tasks are invoked on the driver thread.
+     */
+    executor_type executor;
+    /**
+     * \brief Slack of tasks which are scheduled without an explicit slack.
+     */
+    clock::duration slack{clock::duration::zero()};
+    /**
+     * \brief Whether to record the lateness and execution time of each task.
+     *
+     * Recording requires reading the clock twice per task on the driver thread. If `executor` is set, the execution
+     * time only covers dispatching the task.
+     */
+    bool record_stats = true;
+  };
+
+  /**
+   * \brief Handle to a scheduled task.
+   *
+   * A handle must not be used after the scheduler which created it has been destroyed.
+   */
+  class handle {
+   public:
+    /**
+     * \brief Constructs a handle which does not refer to any task.
+     */
+    handle() noexcept = default;
+
+    /**
+     * \brief Cancels the task.
+     *
+     * \return `true` if the task is cancelled, `false` if the task has already expired or been cancelled, or if this
+     * handle does not refer to any task.
+     */
+    bool cancel();
+
+   private:
+    friend class deadline_scheduler;
+
+    handle(deadline_scheduler* scheduler, std::size_t index, std::uint32_t generation) noexcept :
+        _scheduler_{scheduler}, _index_{index}, _generation_{generation} {}
+
+    deadline_scheduler* _scheduler_ = nullptr;
+    std::size_t _index_ = 0;
+    std::uint32_t _generation_ = 0;
+  };
+
+  /**
+   * \brief Constructs a scheduler with the default configuration.
+   */
+  deadline_scheduler();
+
+  /**
+   * \param cfg Configuration of the scheduler.
+   * \throw std::invalid_argument if `cfg.slack` is negative.
+   */
+  explicit deadline_scheduler(const config& cfg);
+
+  deadline_scheduler(const deadline_scheduler&) = delete;
+  deadline_scheduler(deadline_scheduler&&) noexcept = delete;
+
+  deadline_scheduler& operator=(const deadline_scheduler&) = delete;
+  deadline_scheduler& operator=(deadline_scheduler&&) noexcept = delete;
+
+  /**
+   * \brief Destructor.
+   *
+   * Stops the driver thread. Pending tasks are discarded without being invoked.
+   */
+  ~deadline_scheduler();
+
+  /**
+   * \brief Schedules a task to be invoked after a duration.
+   *
+   * \tparam Rep an arithmetic type representing the number of ticks
+   * \tparam Period a `std::ratio` representing the tick period
+   * \param delay duration after which `callback` is invoked
+   * \param callback task to invoke
+   * \return Handle which can be used to cancel the task.
+   */
+  template<typename Rep, typename Period>
+  handle schedule_after(std::chrono::duration<Rep, Period> delay, callback_type callback) {
+    return schedule_after(delay, _slack, std::move(callback));
+  }
+
+  /**
+   * \brief Schedules a task to be invoked after a duration, with a slack.
+   *
+   * \tparam Rep an arithmetic type representing the number of ticks
+   * \tparam Period a `std::ratio` representing the tick period
+   * \param delay duration after which `callback` is invoked
+   * \param slack duration after the deadline within which `callback` may be invoked
+   * \param callback task to invoke
+   * \return Handle which can be used to cancel the task.
+   * \throw std::invalid_argument if `slack` is negative.
+   */
+  template<typename Rep, typename Period>
+  handle schedule_after(std::chrono::duration<Rep, Period> delay, clock::duration slack, callback_type callback) {
+    return schedule_at(clock::now() + std::chrono::duration_cast<clock::duration>(delay), slack, std::move(callback));
+  }
+
+  /**
+   * \brief Schedules a task to be invoked at a point in time.
+   *
+   * \param deadline time at which `callback` is invoked
+   * \param callback task to invoke
+   * \return Handle which can be used to cancel the task.
+   */
+  handle schedule_at(clock::time_point deadline, callback_type callback) {
+    return schedule_at(deadline, _slack, std::move(callback));
+  }
+
+  /**
+   * \brief Schedules a task to be invoked at a point in time, with a slack.
+   *
+   * \param deadline time at which `callback` is invoked
+   * \param slack duration after `deadline` within which `callback` may be invoked
+   * \param callback task to invoke
+   * \return Handle which can be used to cancel the task.
+   * \throw std::invalid_argument if `slack` is negative.
+   */
+  handle schedule_at(clock::time_point deadline, clock::duration slack, callback_type callback);
+
+  /**
+   * \brief Cancels a task.
+   *
+   * \param h handle of the task
+   * \return `true` if the task is cancelled, `false` if the task has already expired or been cancelled, or if `h` does
+   * not refer to a task of this scheduler.
+   */
+  bool cancel(const handle& h);
+
+  /**
+   * \return Number of tasks which are scheduled but have not expired or been cancelled.
+   */
+  DERPLIB_NODISCARD std::size_t pending() const;
+
+  /**
+   * \return The earliest time by which a scheduled task must be invoked, i.e. the earliest deadline plus slack of all
+   * scheduled tasks, or `clock::time_point::max()` if no task is scheduled. The returned time may belong to a task
+   * which has been cancelled.
+   */
+  DERPLIB_NODISCARD clock::time_point next_deadline() const;
+
+  /**
+   * \return The statistics of the tasks invoked so far. Lateness is measured from the deadline of each task, and
+   * therefore includes the slack used for coalescing. Only populated if `config::record_stats` is `true`.
+   */
+  DERPLIB_NODISCARD timer_stats stats() const { return _stats_._snapshot(); }
+
+ private:
+  /**
+   * \brief Number of children of each node of the heap.
+   */
+  static constexpr std::size_t Arity = 4;
+  /**
+   * \brief Sentinel index for the end of the free list.
+   */
+  static constexpr std::size_t NoNode = std::numeric_limits<std::size_t>::max();
+
+  /**
+   * \brief A task, stored in `_nodes_`.
+   */
+  struct _node {
+    callback_type _callback;
+    /**
+     * \brief Incremented every time the node is released, so that stale handles and heap entries can be detected.
+     */
+    std::uint32_t _generation;
+    /**
+     * \brief Index of the next free node, if this node is free.
+     */
+    std::size_t _next_free;
+  };
+
+  /**
+   * \brief An entry of a heap, referring to a node.
+   */
+  struct _entry {
+    clock::time_point _deadline;
+    /**
+     * \brief Latest time at which the task may be invoked, i.e. the deadline plus slack.
+     */
+    clock::time_point _latest;
+    /**
+     * \brief Order in which the entry is scheduled, used to break ties between equal deadlines.
+     */
+    std::uint64_t _sequence;
+    std::size_t _index;
+    std::uint32_t _generation;
+  };
+
+  /**
+   * \brief A task which has expired and is waiting to be invoked.
+   */
+  struct _expiry {
+    callback_type _callback;
+    clock::time_point _deadline;
+  };
+
+  /**
+   * \brief Daemon method of the driver thread.
+   */
+  void _driver();
+
+  /**
+   * \brief Removes all live tasks whose deadline has passed, collecting their callbacks in the order of their
+   * deadlines. Must be called while holding `_mutex_`.
+   *
+   * \param now the current time
+   * \param expired receives the expired tasks
+   */
+  void _pop_expired(clock::time_point now, std::vector<_expiry>& expired);
+
+  /**
+   * \return Whether the deadline of `lhs` is before that of `rhs`. Orders `_deadline_heap_`.
+   */
+  static bool _is_due_before(const _entry& lhs, const _entry& rhs);
+  /**
+   * \return Whether `lhs` must be invoked before `rhs`. Orders `_latest_heap_`.
+   */
+  static bool _is_latest_before(const _entry& lhs, const _entry& rhs);
+
+  /**
+   * \return Whether an entry no longer refers to a live task. Must be called while holding `_mutex_`.
+   */
+  bool _is_tombstone(const _entry& e) const;
+
+  template<typename Before>
+  static void _sift_up(std::vector<_entry>& heap, std::size_t pos, Before is_before);
+  template<typename Before>
+  static void _sift_down(std::vector<_entry>& heap, std::size_t pos, Before is_before);
+  template<typename Before>
+  static void _pop_heap(std::vector<_entry>& heap, Before is_before);
+
+  /**
+   * \brief Discards the tombstones at the top of a heap, and removes all tombstones from it if they make up more than
+   * half of the heap. Must be called while holding `_mutex_`.
+   */
+  template<typename Before>
+  void _discard_tombstones(std::vector<_entry>& heap, Before is_before);
+
+  /**
+   * \brief Returns a node to the free list. Must be called while holding `_mutex_`.
+   */
+  void _release(std::size_t index);
+
+  const executor_type _executor;
+  const clock::duration _slack;
+  const bool _record_stats;
+
+  mutable std::mutex _mutex_;
+  std::condition_variable _cv_;
+  bool _keep_alive_ = true;
+
+  /**
+   * \brief Entries of all tasks, ordered by `_is_due_before()`.
+   */
+  std::vector<_entry> _deadline_heap_;
+  /**
+   * \brief Entries of all tasks, ordered by `_is_latest_before()`.
+   */
+  std::vector<_entry> _latest_heap_;
+  std::uint64_t _sequence_ = 0;
+  /**
+   * \brief Number of live tasks. The remaining entries of each heap are tombstones.
+   */
+  std::size_t _size_ = 0;
+
+  std::vector<_node> _nodes_;
+  std::size_t _free_ = NoNode;
+
+  internal::_timer_stats_recorder _stats_;
+
+  std::thread _thread_;
+};
+
+#include <derplib/internal/common_macros_end.h>
+
+}  // namespace base
+}  // namespace derplib
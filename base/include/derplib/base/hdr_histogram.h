@@ -0,0 +1,307 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace derplib {
+namespace internal {
+
+/**
+ * \brief Maps values to the buckets of a log-linear histogram.
+ *
+ * Values are grouped into buckets of exponentially increasing width. Each bucket is divided into sub-buckets of equal
+ * width, so that the relative error of the value represented by any sub-bucket is bounded by the number of significant
+ * digits. Values above the highest trackable value are clamped to the highest trackable value.
+ */
+class _hdr_histogram_layout {
+ public:
+  /**
+   * \param highest_trackable_value highest value which can be recorded without clamping. Must be at least `2`.
+   * \param significant_digits number of significant decimal digits to maintain. Must be in the range `[0, 5]`.
+   * \throw std::invalid_argument if either argument is out of range
+   */
+  _hdr_histogram_layout(std::uint64_t highest_trackable_value, unsigned significant_digits);
+
+  /**
+   * \return The index of the sub-bucket which `value` is recorded into.
+   */
+  std::size_t _index_of(std::uint64_t value) const noexcept {
+    if (value > _highest_trackable_value) {
+      value = _highest_trackable_value;
+    }
+
+    const unsigned bucket{_bit_length(value | _sub_bucket_mask) - (_sub_bucket_half_count_magnitude + 1)};
+    const std::uint64_t sub_bucket{value >> bucket};
+    return ((std::uint64_t{bucket} + 1) << _sub_bucket_half_count_magnitude) + sub_bucket - _sub_bucket_half_count;
+  }
+
+  /**
+   * \return The smallest value which is recorded into the sub-bucket at `index`.
+   */
+  std::uint64_t _lowest_equivalent_value(std::size_t index) const noexcept;
+
+  /**
+   * \return The largest value which is recorded into the sub-bucket at `index`.
+   */
+  std::uint64_t _highest_equivalent_value(std::size_t index) const noexcept;
+
+  /**
+   * \return The value halfway between the lowest and highest values recorded into the sub-bucket at `index`.
+   */
+  std::uint64_t _median_equivalent_value(std::size_t index) const noexcept;
+
+  /**
+   * \return Whether `other` maps values to the same sub-buckets as this layout.
+   */
+  bool _same_as(const _hdr_histogram_layout& other) const noexcept {
+    return _highest_trackable_value == other._highest_trackable_value &&
+           _significant_digits == other._significant_digits;
+  }
+
+  const std::uint64_t _highest_trackable_value;
+  const unsigned _significant_digits;
+  /**
+   * \brief Base-2 logarithm of half the number of sub-buckets in each bucket.
+   */
+  const unsigned _sub_bucket_half_count_magnitude;
+  const std::size_t _sub_bucket_half_count;
+  const std::uint64_t _sub_bucket_mask;
+  /**
+   * \brief Total number of sub-buckets.
+   */
+  const std::size_t _counts_length;
+
+ private:
+  /**
+   * \return The number of bits required to represent `value`.
+   */
+  static unsigned _bit_length(std::uint64_t value) noexcept {
+#if defined(__clang__) || defined(__GNUG__)
+    return value == 0 ? 0 : static_cast<unsigned>(64 - __builtin_clzll(value));
+#else
+    unsigned length{0};
+    while (value != 0) {
+      ++length;
+      value >>= 1;
+    }
+    return length;
+#endif  // defined(__clang__) || defined(__GNUG__)
+  }
+};
+
+}  // namespace internal
+
+inline namespace base {
+
+class concurrent_hdr_histogram;
+
+/**
+ * \brief A fixed-memory histogram with log-linear buckets, in the style of HdrHistogram.
+ *
+ * Recording a value takes constant time and never allocates. The value reported for a percentile is within the
+ * configured number of significant digits of the recorded value, e.g. within 0.1% when maintaining three significant
+ * digits. Durations are recorded in nanoseconds.
+ *
+ * Histograms with the same configuration can be merged, so that each thread can record into its own histogram without
+ * synchronization. Use `concurrent_hdr_histogram` to record into a single histogram from multiple threads.
+ */
+class hdr_histogram {
+ public:
+  /**
+   * \brief Histogram configuration.
+   */
+  struct config {
+    /**
+     * \brief Highest value which can be recorded. Larger values are recorded as this value.
+     *
+     * Defaults to one hour in nanoseconds.
+     */
+    std::uint64_t highest_trackable_value = 3600000000000;
+    /**
+     * \brief Number of significant decimal digits to maintain, in the range `[0, 5]`.
+     *
+     * Each additional digit multiplies the memory used by the histogram by about ten.
+     */
+    unsigned significant_digits = 3;
+  };
+
+  /**
+   * \brief Creates a histogram with the default configuration.
+   */
+  hdr_histogram();
+  /**
+   * \brief Creates a histogram.
+   *
+   * \param cfg histogram configuration
+   * \throw std::invalid_argument if `cfg.highest_trackable_value` is less than `2`, or `cfg.significant_digits` is
+   * greater than `5`
+   */
+  explicit hdr_histogram(const config& cfg);
+
+  /**
+   * \brief Records a value.
+   *
+   * \param value value to record
+   */
+  void record(std::uint64_t value) noexcept { record(value, 1); }
+
+  /**
+   * \brief Records a value multiple times.
+   *
+   * \param value value to record
+   * \param count number of times to record `value`
+   */
+  void record(const std::uint64_t value, const std::uint64_t count) noexcept {
+    _counts_[_layout._index_of(value)] += count;
+    _total_count_ += count;
+  }
+
+  /**
+   * \brief Records a duration in nanoseconds. Negative durations are recorded as zero.
+   *
+   * \param duration duration to record, such as one returned by `stopwatch::duration()`
+   */
+  template<typename Rep, typename Period>
+  void record(const std::chrono::duration<Rep, Period> duration) noexcept {
+    const auto ns{std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()};
+    record(ns > 0 ? static_cast<std::uint64_t>(ns) : 0);
+  }
+
+  /**
+   * \brief Adds the values recorded by another histogram into this histogram.
+   *
+   * \param other histogram to merge from
+   * \throw std::invalid_argument if `other` does not have the same configuration as this histogram
+   */
+  void merge(const hdr_histogram& other);
+
+  /**
+   * \brief Removes all recorded values.
+   */
+  void reset() noexcept;
+
+  /**
+   * \return The number of recorded values.
+   */
+  std::uint64_t count() const noexcept { return _total_count_; }
+
+  /**
+   * \return The smallest recorded value, rounded down to the precision of the histogram, or `0` if no values have been
+   * recorded.
+   */
+  std::uint64_t min() const noexcept;
+
+  /**
+   * \return The largest recorded value, rounded up to the precision of the histogram, or `0` if no values have been
+   * recorded.
+   */
+  std::uint64_t max() const noexcept;
+
+  /**
+   * \return The mean of the recorded values, to the precision of the histogram, or `0` if no values have been
+   * recorded.
+   */
+  double mean() const noexcept;
+
+  /**
+   * \brief Returns the value below which a given percentage of the recorded values fall.
+   *
+   * For example, `value_at_percentile(99.9)` returns the 99.9th percentile.
+   *
+   * \param percentile percentage of values, in the range `[0, 100]`. Out-of-range percentages are clamped.
+   * \return The largest value equivalent to the value at `percentile`, or `0` if no values have been recorded.
+   */
+  std::uint64_t value_at_percentile(double percentile) const noexcept;
+
+  /**
+   * \return The configuration of this histogram.
+   */
+  const config& configuration() const noexcept { return _config; }
+
+ private:
+  friend class concurrent_hdr_histogram;
+
+  const config _config;
+  const internal::_hdr_histogram_layout _layout;
+
+  std::vector<std::uint64_t> _counts_;
+  std::uint64_t _total_count_ = 0;
+};
+
+/**
+ * \brief An `hdr_histogram` which can be recorded into concurrently from multiple threads.
+ *
+ * Recording is lock-free and only requires a single relaxed atomic increment. Use `snapshot()` to query the recorded
+ * values. A snapshot taken while values are being recorded may not reflect the most recent records.
+ */
+class concurrent_hdr_histogram {
+ public:
+  /**
+   * \brief Creates a histogram with the default configuration.
+   */
+  concurrent_hdr_histogram();
+  /**
+   * \brief Creates a histogram.
+   *
+   * \param cfg histogram configuration
+   * \throw std::invalid_argument if `cfg.highest_trackable_value` is less than `2`, or `cfg.significant_digits` is
+   * greater than `5`
+   */
+  explicit concurrent_hdr_histogram(const hdr_histogram::config& cfg);
+
+  /**
+   * \brief Records a value.
+   *
+   * \param value value to record
+   */
+  void record(std::uint64_t value) noexcept { record(value, 1); }
+
+  /**
+   * \brief Records a value multiple times.
+   *
+   * \param value value to record
+   * \param count number of times to record `value`
+   */
+  void record(const std::uint64_t value, const std::uint64_t count) noexcept {
+    _counts_[_layout._index_of(value)].fetch_add(count, std::memory_order_relaxed);
+  }
+
+  /**
+   * \brief Records a duration in nanoseconds. Negative durations are recorded as zero.
+   *
+   * \param duration duration to record, such as one returned by `stopwatch::duration()`
+   */
+  template<typename Rep, typename Period>
+  void record(const std::chrono::duration<Rep, Period> duration) noexcept {
+    const auto ns{std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()};
+    record(ns > 0 ? static_cast<std::uint64_t>(ns) : 0);
+  }
+
+  /**
+   * \brief Removes all recorded values. Values recorded concurrently with the reset may be partially retained.
+   */
+  void reset() noexcept;
+
+  /**
+   * \return A copy of the values recorded so far.
+   */
+  hdr_histogram snapshot() const;
+
+  /**
+   * \return The configuration of this histogram.
+   */
+  const hdr_histogram::config& configuration() const noexcept { return _config; }
+
+ private:
+  const hdr_histogram::config _config;
+  const internal::_hdr_histogram_layout _layout;
+
+  std::unique_ptr<std::atomic<std::uint64_t>[]> _counts_;
+};
+
+}  // namespace base
+}  // namespace derplib
@@ -1,34 +1,80 @@
 #pragma once
 
 #include <ctime>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
+#include <derplib/internal/eventcount.h>
+#include <derplib/internal/mpsc_ring.h>
 #include <derplib/stdext/memory.h>
 
+/**
+ * \brief Values of `DERPLIB_LOG_MIN_LEVEL`, corresponding to each `basic_logger::level`.
+ */
+#define DERPLIB_LOG_LEVEL_VERBOSE 0
+#define DERPLIB_LOG_LEVEL_DEBUG 1
+#define DERPLIB_LOG_LEVEL_INFO 2
+#define DERPLIB_LOG_LEVEL_WARN 3
+#define DERPLIB_LOG_LEVEL_ERROR 4
+
+#if !defined(DERPLIB_LOG_MIN_LEVEL)
+/**
+ * \brief Minimum level of messages which are compiled into the program.
+ *
+ * Messages below this level are discarded by every logger regardless of its minimum level, and `DERPLIB_LOG_*` call
+ * sites below this level compile to nothing.
+ */
+#define DERPLIB_LOG_MIN_LEVEL DERPLIB_LOG_LEVEL_VERBOSE
+#endif  // !defined(DERPLIB_LOG_MIN_LEVEL)
+
 namespace derplib {
 inline namespace base {
 
 /**
  * \brief Simple logger for logging information.
  *
+ * By default, messages are formatted and written to the `ostream` on the calling thread, and the logger must not be
+ * used by multiple threads concurrently. A logger constructed with an `async_config` instead moves each message into a
+ * bounded lock-free queue, and a background thread formats and writes the queued messages in batches, so that a slow
+ * `ostream` does not stall the logging threads. An asynchronous logger may be used by multiple threads concurrently,
+ * and the `ostream` must not be used by anything else while the logger exists.
+ *
+ * Each logging function also accepts a function which returns the message, which is only invoked if the message will
+ * be logged, so that building a message which is discarded costs nothing. The `DERPLIB_LOG_V` family of macros wraps
+ * the message expression in such a function.
+ *
  * \tparam CharT character type
  */
 template<typename CharT>
 class basic_logger {
- private:
-  using ostringstream = std::basic_ostringstream<CharT>;
-
  public:
   using char_type = CharT;
   using ostream = std::basic_ostream<char_type>;
   using string = std::basic_string<char_type>;
 
+ private:
+  /**
+   * \brief Enabled if `MessageFn` can be invoked without arguments to return a message.
+   */
+  template<typename MessageFn>
+  using _enable_if_message_fn =
+      typename std::enable_if<std::is_convertible<decltype(std::declval<MessageFn&>()()), string>::value>::type;
+
+ public:
   /**
    * \brief Reports errors that are caused by incorrect initialization of the logger, and subsequently leading to the
    * logger to be in an invalid state.
@@ -45,6 +91,42 @@ class basic_logger {
    */
   enum struct level { verbose, debug, info, warn, error };
 
+  static_assert(DERPLIB_LOG_MIN_LEVEL >= DERPLIB_LOG_LEVEL_VERBOSE && DERPLIB_LOG_MIN_LEVEL <= DERPLIB_LOG_LEVEL_ERROR,
+                "DERPLIB_LOG_MIN_LEVEL must be one of the DERPLIB_LOG_LEVEL_* values");
+
+  /**
+   * \brief Minimum level of messages which are compiled into the program, as set by `DERPLIB_LOG_MIN_LEVEL`.
+   */
+  static constexpr level MinLevel = static_cast<level>(DERPLIB_LOG_MIN_LEVEL);
+
+  /**
+   * \brief Action taken by an asynchronous logger when its queue is full.
+   */
+  enum struct overflow_policy {
+    /**
+     * \brief The logging thread waits until the background thread frees space in the queue.
+     */
+    block,
+    /**
+     * \brief The message is discarded, and counted by `dropped()`.
+     */
+    drop
+  };
+
+  /**
+   * \brief Configuration of an asynchronous logger.
+   */
+  struct async_config {
+    /**
+     * \brief Maximum number of messages waiting to be written. Rounded up to the next power of two.
+     */
+    std::size_t capacity = 8192;
+    /**
+     * \brief Action taken when `capacity` messages are already waiting to be written.
+     */
+    overflow_policy overflow = overflow_policy::block;
+  };
+
   /**
    * \brief Constructor.
    *
@@ -53,7 +135,24 @@ class basic_logger {
    * \param os destination of the logger
    * \param min_level minimum level of information that will be output to the logger
    */
-  basic_logger(ostream& os, level min_level) : _min_level_{min_level}, _ostream_{os} {}
+  basic_logger(ostream& os, level min_level) :
+      _min_level_{min_level}, _ostream_{os}, _buffer_{}, _time_cache_{}, _async_{} {}
+
+  /**
+   * \brief Constructor.
+   *
+   * Constructs a new asynchronous logger, and starts its background thread.
+   *
+   * \param os destination of the logger
+   * \param min_level minimum level of information that will be output to the logger
+   * \param cfg configuration of the asynchronous logger
+   */
+  basic_logger(ostream& os, level min_level, const async_config& cfg) :
+      _min_level_{min_level},
+      _ostream_{os},
+      _buffer_{},
+      _time_cache_{},
+      _async_{stdext::make_unique<_async_backend>(os, cfg)} {}
 
   /**
    * \brief Copy constructor.
@@ -71,40 +170,116 @@ class basic_logger {
   basic_logger& operator=(const basic_logger&) & = delete;
   basic_logger& operator=(basic_logger&&) & noexcept = default;
 
+  /**
+   * \brief Destructor.
+   *
+   * If this logger is asynchronous, waits for all queued messages to be written, and stops the background thread.
+   */
+  ~basic_logger() = default;
+
   /**
    * \brief Logs a verbose message.
    * \param message message to log
    */
   void v(const string& message) { _print_helper(message, level::verbose); }
 
+  /**
+   * \brief Logs a verbose message, which is only built if it will be logged.
+   * \param make_message function returning the message to log
+   */
+  template<typename MessageFn, typename = _enable_if_message_fn<MessageFn>>
+  void v(MessageFn&& make_message) {
+    _lazy_print_helper(std::forward<MessageFn>(make_message), level::verbose);
+  }
+
   /**
    * \brief Logs a debug message.
    * \param message message to log
    */
   void d(const string& message) { _print_helper(message, level::debug); }
 
+  /**
+   * \brief Logs a debug message, which is only built if it will be logged.
+   * \param make_message function returning the message to log
+   */
+  template<typename MessageFn, typename = _enable_if_message_fn<MessageFn>>
+  void d(MessageFn&& make_message) {
+    _lazy_print_helper(std::forward<MessageFn>(make_message), level::debug);
+  }
+
   /**
    * \brief Logs an information message.
    * \param message message to log
    */
   void i(const string& message) { _print_helper(message, level::info); }
 
+  /**
+   * \brief Logs an information message, which is only built if it will be logged.
+   * \param make_message function returning the message to log
+   */
+  template<typename MessageFn, typename = _enable_if_message_fn<MessageFn>>
+  void i(MessageFn&& make_message) {
+    _lazy_print_helper(std::forward<MessageFn>(make_message), level::info);
+  }
+
   /**
    * \brief Logs a warning message.
    * \param message message to log
    */
   void w(const string& message) { _print_helper(message, level::warn); }
 
+  /**
+   * \brief Logs a warning message, which is only built if it will be logged.
+   * \param make_message function returning the message to log
+   */
+  template<typename MessageFn, typename = _enable_if_message_fn<MessageFn>>
+  void w(MessageFn&& make_message) {
+    _lazy_print_helper(std::forward<MessageFn>(make_message), level::warn);
+  }
+
   /**
    * \brief Logs an error message.
    * \param message message to log
    */
   void e(const string& message) { _print_helper(message, level::error); }
 
+  /**
+   * \brief Logs an error message, which is only built if it will be logged.
+   * \param make_message function returning the message to log
+   */
+  template<typename MessageFn, typename = _enable_if_message_fn<MessageFn>>
+  void e(MessageFn&& make_message) {
+    _lazy_print_helper(std::forward<MessageFn>(make_message), level::error);
+  }
+
+  /**
+   * \param p_level level of a message
+   * \return Whether a message of `p_level` will be logged by this logger.
+   */
+  bool is_loggable(const level p_level) const noexcept { return p_level >= MinLevel && p_level >= _min_level_; }
+
   /**
    * \brief Flushes the `ostream` associated to this logger.
+   *
+   * If this logger is asynchronous, first waits until all messages logged before this call are written.
+   */
+  void flush() {
+    if (_async_ != nullptr) {
+      _async_->_flush();
+    } else {
+      _ostream_.flush();
+    }
+  }
+
+  /**
+   * \return Whether this logger writes messages on a background thread.
+   */
+  bool is_async() const noexcept { return _async_ != nullptr; }
+
+  /**
+   * \return Number of messages discarded because the queue was full under `overflow_policy::drop`.
    */
-  void flush() { _ostream_.flush(); }
+  std::uint64_t dropped() const noexcept { return _async_ != nullptr ? _async_->_dropped() : 0; }
 
   /**
    * \brief Creates a default logger.
@@ -120,6 +295,18 @@ class basic_logger {
    */
   static basic_logger<CharT>& make_default(ostream& os, level min_level = level::verbose);
 
+  /**
+   * \brief Creates an asynchronous default logger.
+   *
+   * \param os destination of the logger
+   * \param min_level minimum level of information that will be output to the logger
+   * \param cfg configuration of the asynchronous logger
+   * \return The default logger instance.
+   *
+   * \throws `invalid_state` if a default logger has already been created.
+   */
+  static basic_logger<CharT>& make_default(ostream& os, level min_level, const async_config& cfg);
+
   /**
    * \brief Replaces the default logger.
    *
@@ -132,6 +319,16 @@ class basic_logger {
    */
   static basic_logger<CharT>& replace_default(ostream& os, level min_level = level::verbose);
 
+  /**
+   * \brief Replaces the default logger with an asynchronous logger.
+   *
+   * \param os destination of the new logger
+   * \param min_level minimum level of information that will be output to the new logger
+   * \param cfg configuration of the new asynchronous logger
+   * \return The new default logger instance.
+   */
+  static basic_logger<CharT>& replace_default(ostream& os, level min_level, const async_config& cfg);
+
   /**
    * \brief Returns the default logger.
    *
@@ -141,25 +338,269 @@ class basic_logger {
   static basic_logger<CharT>& get_default();
 
  private:
+  using _clock = std::chrono::system_clock;
+
+  /**
+   * \brief Length of the `"%m-%d %H:%M:%S."` prefix of a formatted time.
+   */
+  static constexpr std::size_t TimePrefixLength = 15;
+
+  /**
+   * \brief Formatted prefix of the last second which a time was formatted in.
+   *
+   * Messages are usually logged many times per second, so only the milliseconds need to be formatted for most
+   * messages. Each cache must only be used by one thread at a time.
+   */
+  struct _time_cache {
+    _time_cache() noexcept : _second{std::numeric_limits<std::time_t>::min()}, _prefix{} {}
+
+    std::time_t _second;
+    /**
+     * \brief `_second` formatted as `"%m-%d %H:%M:%S."` in local time.
+     */
+    CharT _prefix[TimePrefixLength];
+  };
+
+  /**
+   * \brief A message waiting to be written by an asynchronous logger.
+   */
+  struct _record {
+    _clock::time_point _time;
+    level _level;
+    string _message;
+  };
+
+  /**
+   * \brief Queue and background thread of an asynchronous logger.
+   */
+  class _async_backend {
+   public:
+    _async_backend(ostream& os, const async_config& cfg);
+
+    _async_backend(const _async_backend&) = delete;
+    _async_backend& operator=(const _async_backend&) = delete;
+
+    ~_async_backend();
+
+    /**
+     * \brief Adds a message to the queue, or drops it if the queue is full under `overflow_policy::drop`.
+     */
+    void _push(_record&& record);
+
+    /**
+     * \brief Waits until all messages pushed before this call are written, and the `ostream` is flushed.
+     */
+    void _flush();
+
+    std::uint64_t _dropped() const noexcept { return _dropped_.load(std::memory_order_relaxed); }
+
+   private:
+    /**
+     * \brief Maximum number of messages which are formatted before being written to the `ostream` at once.
+     */
+    static constexpr std::size_t BatchSize = 256;
+
+    /**
+     * \brief Body of the background thread.
+     */
+    void _run();
+
+    /**
+     * \return Whether a call to `_flush()` is waiting for written messages to be flushed.
+     */
+    bool _is_flush_pending() const;
+
+    ostream& _ostream_;
+    const overflow_policy _overflow;
+    _time_cache _time_cache_;
+
+    internal::_mpsc_ring<_record> _ring_;
+    /**
+     * \brief Notified when a message is pushed, when a flush is requested, and when the logger is destroyed.
+     */
+    internal::_eventcount _not_empty_;
+    /**
+     * \brief Notified when the background thread frees space in the queue.
+     */
+    internal::_eventcount _not_full_;
+    std::atomic<std::uint64_t> _dropped_;
+    std::atomic<bool> _keep_alive_;
+
+    /**
+     * \brief Number of messages written to the `ostream` by the background thread.
+     */
+    std::size_t _written_;
+    std::atomic_size_t _flush_waiters_;
+    std::mutex _flush_mutex_;
+    std::condition_variable _flush_cv_;
+    /**
+     * \brief Number of messages which were written before the `ostream` was last flushed. Guarded by `_flush_mutex_`.
+     */
+    std::size_t _flushed_;
+
+    std::thread _thread_;
+  };
+
   static std::unique_ptr<basic_logger<CharT>>& _instance();
 
   /**
-   * \return String representing the current time.
+   * \brief Appends `time` to `out`, formatted as `"%m-%d %H:%M:%S.mmm"` in local time.
+   *
+   * \param out string to append to
+   * \param cache cache of the formatted second, which is updated if `time` is in a different second
+   * \param time time to format
    */
-  static std::basic_string<CharT> _fmt_time();
+  static void _fmt_time(string& out, _time_cache& cache, _clock::time_point time);
+
+  /**
+   * \brief Formats a message and appends it to `out`.
+   *
+   * \param out string to append to
+   * \param cache cache of the formatted second
+   * \param time time at which the message was logged
+   * \param p_level level of the message
+   * \param message message to format
+   */
+  static void _format(string& out, _time_cache& cache, _clock::time_point time, level p_level, const string& message);
 
   /**
    * \brief Helper function for formatting and outputting messages.
    *
-   * \param message message to output
+   * \param message message to output, which is moved into the queue of an asynchronous logger if it is an rvalue
    * \param p_level level of the message
    */
-  void _print_helper(const string& message, level p_level);
+  template<typename String>
+  void _print_helper(String&& message, level p_level);
+
+  /**
+   * \brief Builds and logs a message if it will be logged.
+   *
+   * \param make_message function returning the message to log
+   * \param p_level level of the message
+   */
+  template<typename MessageFn>
+  void _lazy_print_helper(MessageFn&& make_message, level p_level);
 
   level _min_level_;
   ostream& _ostream_;
+  /**
+   * \brief Buffer which messages are formatted into before being written by a synchronous logger.
+   */
+  string _buffer_;
+  _time_cache _time_cache_;
+  std::unique_ptr<_async_backend> _async_;
 };
 
+template<typename CharT>
+basic_logger<CharT>::_async_backend::_async_backend(ostream& os, const async_config& cfg) :
+    _ostream_{os},
+    _overflow{cfg.overflow},
+    _time_cache_{},
+    _ring_{cfg.capacity},
+    _dropped_{0},
+    _keep_alive_{true},
+    _written_{0},
+    _flush_waiters_{0},
+    _flushed_{0},
+    _thread_{&_async_backend::_run, this} {}
+
+template<typename CharT>
+basic_logger<CharT>::_async_backend::~_async_backend() {
+  _keep_alive_ = false;
+  _not_empty_._notify_all();
+  _thread_.join();
+}
+
+template<typename CharT>
+void basic_logger<CharT>::_async_backend::_push(_record&& record) {
+  while (!_ring_._try_push(std::move(record))) {
+    if (_overflow == overflow_policy::drop) {
+      _dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+    const internal::_eventcount::_key_type key{_not_full_._prepare_wait()};
+    if (_ring_._try_push(std::move(record))) {
+      _not_full_._cancel_wait();
+      break;
+    }
+    _not_full_._wait(key);
+  }
+
+  _not_empty_._notify_all();
+}
+
+template<typename CharT>
+void basic_logger<CharT>::_async_backend::_flush() {
+  // Messages which have claimed a slot are published shortly after, so waiting for them does not block indefinitely.
+  const std::size_t target{_ring_._enqueued()};
+
+  ++_flush_waiters_;
+  _not_empty_._notify_all();
+  {
+    std::unique_lock<std::mutex> lk{_flush_mutex_};
+    _flush_cv_.wait(lk, [&] { return _flushed_ >= target; });
+  }
+  --_flush_waiters_;
+}
+
+template<typename CharT>
+bool basic_logger<CharT>::_async_backend::_is_flush_pending() const {
+  return _flush_waiters_ != 0 && _flushed_ != _written_;
+}
+
+template<typename CharT>
+void basic_logger<CharT>::_async_backend::_run() {
+  string batch{};
+
+  while (true) {
+    std::size_t count{0};
+    while (count < BatchSize) {
+      _record* const record{_ring_._front()};
+      if (record == nullptr) {
+        break;
+      }
+
+      _format(batch, _time_cache_, record->_time, record->_level, record->_message);
+      _ring_._pop();
+      ++count;
+    }
+
+    if (count != 0) {
+      _not_full_._notify_all();
+
+      _ostream_.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+      batch.clear();
+      _written_ += count;
+    }
+
+    if (_flush_waiters_ != 0) {
+      _ostream_.flush();
+
+      std::lock_guard<std::mutex> lk{_flush_mutex_};
+      _flushed_ = _written_;
+      _flush_cv_.notify_all();
+    }
+
+    if (count != 0) {
+      continue;
+    }
+
+    const internal::_eventcount::_key_type key{_not_empty_._prepare_wait()};
+    if (_ring_._front() != nullptr || _is_flush_pending()) {
+      _not_empty_._cancel_wait();
+      continue;
+    }
+    if (!_keep_alive_) {
+      _not_empty_._cancel_wait();
+      break;
+    }
+    _not_empty_._wait(key);
+  }
+
+  _ostream_.flush();
+}
+
 template<typename CharT>
 std::unique_ptr<basic_logger<CharT>>& basic_logger<CharT>::_instance() {
   static std::unique_ptr<basic_logger<CharT>> i{};
@@ -176,6 +617,18 @@ basic_logger<CharT>& basic_logger<CharT>::make_default(basic_logger::ostream& os
   return get_default();
 }
 
+template<typename CharT>
+basic_logger<CharT>& basic_logger<CharT>::make_default(basic_logger::ostream& os,
+                                                       basic_logger::level min_level,
+                                                       const basic_logger::async_config& cfg) {
+  if (_instance() != nullptr) {
+    throw basic_logger::invalid_state{"Default logger already initialized"};
+  }
+
+  _instance() = stdext::make_unique<basic_logger<CharT>>(os, min_level, cfg);
+  return get_default();
+}
+
 template<typename CharT>
 basic_logger<CharT>& basic_logger<CharT>::replace_default(basic_logger::ostream& os, basic_logger::level min_level) {
   if (_instance() != nullptr) {
@@ -186,6 +639,18 @@ basic_logger<CharT>& basic_logger<CharT>::replace_default(basic_logger::ostream&
   return get_default();
 }
 
+template<typename CharT>
+basic_logger<CharT>& basic_logger<CharT>::replace_default(basic_logger::ostream& os,
+                                                          basic_logger::level min_level,
+                                                          const basic_logger::async_config& cfg) {
+  if (_instance() != nullptr) {
+    _instance()->flush();
+  }
+  _instance() = stdext::make_unique<basic_logger<CharT>>(os, min_level, cfg);
+
+  return get_default();
+}
+
 template<typename CharT>
 basic_logger<CharT>& basic_logger<CharT>::get_default() {
   if (_instance() == nullptr) {
@@ -196,47 +661,111 @@ basic_logger<CharT>& basic_logger<CharT>::get_default() {
 }
 
 template<typename CharT>
-std::basic_string<CharT> basic_logger<CharT>::_fmt_time() {
-  // https://stackoverflow.com/questions/24686846/get-current-time-in-milliseconds-or-hhmmssmmm-format
+constexpr typename basic_logger<CharT>::level basic_logger<CharT>::MinLevel;
+
+template<typename CharT>
+constexpr std::size_t basic_logger<CharT>::TimePrefixLength;
 
-  const auto now{std::chrono::system_clock::now()};
-  const auto ms{std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000};
+template<typename CharT>
+void basic_logger<CharT>::_fmt_time(basic_logger::string& out,
+                                    basic_logger::_time_cache& cache,
+                                    const _clock::time_point time) {
+  const auto digit{[](const int value) { return static_cast<CharT>('0' + value); }};
+  const auto put_two_digits{[&](CharT* const dest, const int value) {
+    dest[0] = digit(value / 10 % 10);
+    dest[1] = digit(value % 10);
+  }};
+
+  const std::time_t second{_clock::to_time_t(time)};
+  if (second != cache._second) {
+    std::tm tm{};
+#if defined(_WIN32)
+    localtime_s(&tm, &second);
+#else
+    localtime_r(&second, &tm);
+#endif  // defined(_WIN32)
+
+    CharT* const prefix{cache._prefix};
+    put_two_digits(prefix, tm.tm_mon + 1);
+    prefix[2] = '-';
+    put_two_digits(prefix + 3, tm.tm_mday);
+    prefix[5] = ' ';
+    put_two_digits(prefix + 6, tm.tm_hour);
+    prefix[8] = ':';
+    put_two_digits(prefix + 9, tm.tm_min);
+    prefix[11] = ':';
+    put_two_digits(prefix + 12, tm.tm_sec);
+    prefix[14] = '.';
+    cache._second = second;
+  }
 
-  const auto time{std::chrono::system_clock::to_time_t(now)};
-  const std::tm tm{*std::localtime(&time)};
+  const auto ms_count{std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000};
+  const int ms{static_cast<int>(ms_count < 0 ? ms_count + 1000 : ms_count)};
 
-  basic_logger::ostringstream ss{};
-  ss << std::put_time(&tm, "%m-%d %H:%M:%S") << '.' << std::setfill('0') << std::setw(3) << ms.count();
-  return ss.str();
+  out.append(cache._prefix, TimePrefixLength);
+  out += digit(ms / 100);
+  out += digit(ms / 10 % 10);
+  out += digit(ms % 10);
 }
 
 template<typename CharT>
-void basic_logger<CharT>::_print_helper(const basic_logger::string& message, basic_logger::level p_level) {
-  if (p_level < _min_level_) {
-    return;
-  }
-
-  _ostream_ << _fmt_time() << '\t';
+void basic_logger<CharT>::_format(basic_logger::string& out,
+                                  basic_logger::_time_cache& cache,
+                                  const _clock::time_point time,
+                                  const basic_logger::level p_level,
+                                  const basic_logger::string& message) {
+  _fmt_time(out, cache, time);
+  out += '\t';
 
   switch (p_level) {
     case level::verbose:
-      _ostream_ << 'V';
+      out += 'V';
       break;
     case level::debug:
-      _ostream_ << 'D';
+      out += 'D';
       break;
     case level::info:
-      _ostream_ << 'I';
+      out += 'I';
       break;
     case level::warn:
-      _ostream_ << 'W';
+      out += 'W';
       break;
     case level::error:
-      _ostream_ << 'E';
+      out += 'E';
       break;
   }
 
-  _ostream_ << ": " << message << '\n';
+  out += ':';
+  out += ' ';
+  out += message;
+  out += '\n';
+}
+
+template<typename CharT>
+template<typename String>
+void basic_logger<CharT>::_print_helper(String&& message, basic_logger::level p_level) {
+  if (!is_loggable(p_level)) {
+    return;
+  }
+
+  if (_async_ != nullptr) {
+    _async_->_push(_record{_clock::now(), p_level, std::forward<String>(message)});
+    return;
+  }
+
+  _buffer_.clear();
+  _format(_buffer_, _time_cache_, _clock::now(), p_level, message);
+  _ostream_.write(_buffer_.data(), static_cast<std::streamsize>(_buffer_.size()));
+}
+
+template<typename CharT>
+template<typename MessageFn>
+void basic_logger<CharT>::_lazy_print_helper(MessageFn&& make_message, basic_logger::level p_level) {
+  if (!is_loggable(p_level)) {
+    return;
+  }
+
+  _print_helper(string{std::forward<MessageFn>(make_message)()}, p_level);
 }
 
 using logger = basic_logger<char>;
@@ -244,3 +773,54 @@ using wlogger = basic_logger<wchar_t>;
 
 }  // namespace base
 }  // namespace derplib
+
+#define DERPLIB_LOG_IMPL(logger, level_fn, ...) (logger).level_fn([&] { return __VA_ARGS__; })
+
+#if DERPLIB_LOG_MIN_LEVEL <= DERPLIB_LOG_LEVEL_VERBOSE
+/**
+ * \brief Logs a verbose message to `logger`, evaluating the message expression only if it will be logged.
+ *
+ * Compiles to nothing if `DERPLIB_LOG_MIN_LEVEL` is above `DERPLIB_LOG_LEVEL_VERBOSE`.
+ */
+#define DERPLIB_LOG_V(logger, ...) DERPLIB_LOG_IMPL(logger, v, __VA_ARGS__)
+#else
+#define DERPLIB_LOG_V(logger, ...) static_cast<void>(0)
+#endif  // DERPLIB_LOG_MIN_LEVEL <= DERPLIB_LOG_LEVEL_VERBOSE
+
+#if DERPLIB_LOG_MIN_LEVEL <= DERPLIB_LOG_LEVEL_DEBUG
+/**
+ * \brief Logs a debug message to `logger`, evaluating the message expression only if it will be logged.
+ *
+ * Compiles to nothing if `DERPLIB_LOG_MIN_LEVEL` is above `DERPLIB_LOG_LEVEL_DEBUG`.
+ */
+#define DERPLIB_LOG_D(logger, ...) DERPLIB_LOG_IMPL(logger, d, __VA_ARGS__)
+#else
+#define DERPLIB_LOG_D(logger, ...) static_cast<void>(0)
+#endif  // DERPLIB_LOG_MIN_LEVEL <= DERPLIB_LOG_LEVEL_DEBUG
+
+#if DERPLIB_LOG_MIN_LEVEL <= DERPLIB_LOG_LEVEL_INFO
+/**
+ * \brief Logs an information message to `logger`, evaluating the message expression only if it will be logged.
+ *
+ * Compiles to nothing if `DERPLIB_LOG_MIN_LEVEL` is above `DERPLIB_LOG_LEVEL_INFO`.
+ */
+#define DERPLIB_LOG_I(logger, ...) DERPLIB_LOG_IMPL(logger, i, __VA_ARGS__)
+#else
+#define DERPLIB_LOG_I(logger, ...) static_cast<void>(0)
+#endif  // DERPLIB_LOG_MIN_LEVEL <= DERPLIB_LOG_LEVEL_INFO
+
+#if DERPLIB_LOG_MIN_LEVEL <= DERPLIB_LOG_LEVEL_WARN
+/**
+ * \brief Logs a warning message to `logger`, evaluating the message expression only if it will be logged.
+ *
+ * Compiles to nothing if `DERPLIB_LOG_MIN_LEVEL` is above `DERPLIB_LOG_LEVEL_WARN`.
+ */
+#define DERPLIB_LOG_W(logger, ...) DERPLIB_LOG_IMPL(logger, w, __VA_ARGS__)
+#else
+#define DERPLIB_LOG_W(logger, ...) static_cast<void>(0)
+#endif  // DERPLIB_LOG_MIN_LEVEL <= DERPLIB_LOG_LEVEL_WARN
+
+/**
+ * \brief Logs an error message to `logger`, evaluating the message expression only if it will be logged.
+ */
+#define DERPLIB_LOG_E(logger, ...) DERPLIB_LOG_IMPL(logger, e, __VA_ARGS__)
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <derplib/base/stopwatch.h>
+
+namespace derplib {
+inline namespace base {
+
+/**
+ * \brief Events which can be counted by `perf_counters`.
+ */
+enum struct perf_event {
+  /**
+   * \brief CPU cycles. Hardware event.
+   */
+  cycles,
+  /**
+   * \brief Retired instructions. Hardware event.
+   */
+  instructions,
+  /**
+   * \brief Last-level cache misses. Hardware event.
+   */
+  cache_misses,
+  /**
+   * \brief Mispredicted branch instructions. Hardware event.
+   */
+  branch_misses,
+  /**
+   * \brief CPU time spent by the thread, in nanoseconds. Software event.
+   */
+  task_clock,
+  /**
+   * \brief Page faults. Software event.
+   */
+  page_faults,
+  /**
+   * \brief Context switches. Software event.
+   */
+  context_switches
+};
+
+/**
+ * \brief Which kinds of events `perf_counters` is able to count.
+ */
+enum struct perf_counter_mode {
+  /**
+   * \brief At least one hardware event can be counted, in addition to any available software events.
+   */
+  hardware,
+  /**
+   * \brief Only software events can be counted.
+   */
+  software,
+  /**
+   * \brief No events can be counted, and only the elapsed time is measured.
+   */
+  timing_only
+};
+
+/**
+ * \brief Counter deltas and elapsed time of a region measured by `perf_counters`.
+ *
+ * Counts of events which are not available are `0`.
+ */
+struct perf_sample {
+  /**
+   * \brief Wall time elapsed between `perf_counters::start()` and `perf_counters::stop()`.
+   */
+  std::chrono::nanoseconds elapsed;
+
+  std::uint64_t cycles;
+  std::uint64_t instructions;
+  std::uint64_t cache_misses;
+  std::uint64_t branch_misses;
+
+  std::uint64_t task_clock;
+  std::uint64_t page_faults;
+  std::uint64_t context_switches;
+
+  /**
+   * \brief Whether the kernel multiplexed the counters with other users, in which case the counts are estimates scaled
+   * by the fraction of time they were scheduled.
+   */
+  bool multiplexed;
+
+  /**
+   * \return Instructions retired per cycle, or `0` if cycles were not counted.
+   */
+  double ipc() const noexcept {
+    return cycles == 0 ? 0.0 : static_cast<double>(instructions) / static_cast<double>(cycles);
+  }
+};
+
+/**
+ * \brief A companion to `stopwatch` which also counts hardware events over a region of the calling thread, using
+ * `perf_event_open`.
+ *
+ * Hardware and software events are each opened as a group, so that the events within a group are counted over exactly
+ * the same instructions. Only events in user space are counted. If the kernel denies access to hardware events, e.g.
+ * because of `perf_event_paranoid` or because the CPU is virtualized, only software events are counted. If software
+ * events are denied as well, or the platform is not Linux, only the elapsed time is measured.
+ *
+ * Counters are bound to the thread which constructs this object, so `start()` and `stop()` must be called from that
+ * thread.
+ */
+class perf_counters {
+ public:
+  /**
+   * \brief Opens the counters.
+   */
+  perf_counters();
+
+  perf_counters(const perf_counters&) = delete;
+  perf_counters(perf_counters&&) noexcept = delete;
+
+  perf_counters& operator=(const perf_counters&) = delete;
+  perf_counters& operator=(perf_counters&&) noexcept = delete;
+
+  /**
+   * \brief Closes the counters.
+   */
+  ~perf_counters();
+
+  /**
+   * \brief Resets and starts the counters and the stopwatch.
+   */
+  void start();
+  /**
+   * \brief Stops the counters and the stopwatch, and reads the counters.
+   */
+  void stop();
+
+  /**
+   * \return The counter deltas and elapsed time between the last calls to `start()` and `stop()`.
+   */
+  perf_sample sample() const noexcept;
+
+  /**
+   * \return Which kinds of events can be counted.
+   */
+  perf_counter_mode mode() const noexcept;
+
+  /**
+   * \return Whether `event` can be counted.
+   */
+  bool available(perf_event event) const noexcept;
+
+ private:
+  static constexpr std::size_t EventCount = 7;
+  static constexpr std::size_t GroupCount = 2;
+
+  /**
+   * \brief Opens a group of events, leaving events which cannot be opened unavailable.
+   *
+   * \param group index of the group
+   * \param begin first event of the group
+   * \param end one past the last event of the group
+   */
+  void _open_group(std::size_t group, perf_event begin, perf_event end) noexcept;
+
+  /**
+   * \brief Reads a group of events, and stores their scaled counts into `_counts_`.
+   */
+  void _read_group(std::size_t group) noexcept;
+
+  /**
+   * \brief File descriptor of each event, or `-1` if the event is not available.
+   */
+  std::array<int, EventCount> _fds_;
+  /**
+   * \brief Position of each event within the values read from its group.
+   */
+  std::array<std::size_t, EventCount> _slots_;
+  /**
+   * \brief File descriptor of the leader of each group, or `-1` if no event in the group is available.
+   */
+  std::array<int, GroupCount> _leaders_;
+
+  std::array<std::uint64_t, EventCount> _counts_;
+  bool _multiplexed_ = false;
+
+  stopwatch _stopwatch_;
+};
+
+}  // namespace base
+}  // namespace derplib
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <derplib/base/timer_stats.h>
+#include <derplib/stdext/type_traits.h>
+
+namespace derplib {
+inline namespace base {
+
+#include <derplib/internal/common_macros_begin.h>
+
+/**
+ * \brief Policy for handling ticks which are missed because the callback or the system is running late.
+ */
+enum struct catch_up_policy {
+  /**
+   * \brief Invokes the callback once for every missed tick, without waiting in between.
+   */
+  fire_all,
+  /**
+   * \brief Drops the missed ticks, and continues with the next tick which is still in the future.
+   */
+  skip,
+  /**
+   * \brief Drops the missed ticks, and schedules the next tick one period after the time the lateness is detected.
+   */
+  reschedule
+};
+
+/**
+ * \brief A timer that repeatedly invokes a callback at a fixed period.
+ *
+ * Ticks are scheduled against absolute deadlines, i.e. the `k`-th tick is due at `start + k * period`, so that the
+ * latency of waking up and of invoking the callback does not accumulate over time. When a tick is missed, the timer
+ * catches up according to its `catch_up_policy`.
+ *
+ * \tparam Func function type. Must be `void f()`.
+ */
+template<typename Func = std::function<void()>, typename = stdext::enable_if_invocable<Func>>
+class periodic_timer;
+
+template<typename Func>
+class periodic_timer<Func> {
+ public:
+  /**
+   * \brief Clock used to measure deadlines.
+   */
+  using clock = std::chrono::steady_clock;
+
+  /**
+   * \brief Timer configuration.
+   */
+  struct config {
+    /**
+     * \brief Policy for handling missed ticks.
+     */
+    catch_up_policy policy = catch_up_policy::skip;
+    /**
+     * \brief Whether to record the lateness and execution time of each tick.
+     *
+     * Recording requires reading the clock once more per tick on the tick thread, in addition to the read needed to
+     * detect missed ticks.
+     */
+    bool record_stats = true;
+  };
+
+  /**
+   * \brief Constructs an instance of `periodic_timer`.
+   *
+   * \tparam Rep an arithmetic type representing the number of ticks
+   * \tparam Period a `std::ratio` representing the tick period
+   * \param period duration between two ticks
+   * \param callback callback function to run on every tick
+   * \param policy policy for handling missed ticks
+   * \throw std::invalid_argument if `period` is not positive.
+   */
+  template<typename Rep, typename Period>
+  periodic_timer(std::chrono::duration<Rep, Period> period,
+                 const Func& callback,
+                 catch_up_policy policy = catch_up_policy::skip);
+
+  /**
+   * \brief Constructs an instance of `periodic_timer`.
+   *
+   * \tparam Rep an arithmetic type representing the number of ticks
+   * \tparam Period a `std::ratio` representing the tick period
+   * \param period duration between two ticks
+   * \param callback callback function to run on every tick
+   * \param cfg configuration of the timer
+   * \throw std::invalid_argument if `period` is not positive.
+   */
+  template<typename Rep, typename Period>
+  periodic_timer(std::chrono::duration<Rep, Period> period, const Func& callback, const config& cfg);
+
+  periodic_timer(const periodic_timer&) = delete;
+  periodic_timer(periodic_timer&&) noexcept = delete;
+
+  periodic_timer& operator=(const periodic_timer&) = delete;
+  periodic_timer& operator=(periodic_timer&&) noexcept = delete;
+
+  ~periodic_timer();
+
+  /**
+   * \brief Starts the timer. The first tick is due one period after this call.
+   *
+   * \throw std::logic_error if the timer is already running.
+   */
+  void start();
+  /**
+   * \brief Stops the timer.
+   *
+   * Returns as soon as the tick thread is woken, unless the callback is being invoked, in which case this waits for
+   * the callback to return. Does nothing if the timer is not running.
+   */
+  void stop();
+
+  /**
+   * \brief Changes the period of the timer.
+   *
+   * The change takes effect from the next tick, which becomes due one new period after the previous tick. If that time
+   * has already passed, the tick is handled according to the catch-up policy of the timer, i.e. it is invoked
+   * immediately under `fire_all`, and dropped under `skip` and `reschedule`.
+   *
+   * \tparam Rep an arithmetic type representing the number of ticks
+   * \tparam Period a `std::ratio` representing the tick period
+   * \param period new duration between two ticks
+   * \throw std::invalid_argument if `period` is not positive.
+   */
+  template<typename Rep, typename Period>
+  void set_period(std::chrono::duration<Rep, Period> period);
+
+  /**
+   * \return The duration between two ticks.
+   */
+  DERPLIB_NODISCARD clock::duration period() const {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    return _period_;
+  }
+  /**
+   * \return Whether the timer is running.
+   */
+  DERPLIB_NODISCARD bool active() const { return _thread_.joinable(); }
+  /**
+   * \return Number of ticks which have been dropped by the `skip` and `reschedule` policies.
+   */
+  DERPLIB_NODISCARD std::uint64_t missed() const {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    return _missed_;
+  }
+  /**
+   * \return The statistics of the ticks invoked so far. Only populated if `config::record_stats` is `true`.
+   */
+  DERPLIB_NODISCARD timer_stats stats() const { return _stats_._snapshot(); }
+
+ private:
+  template<typename Rep, typename Period>
+  static clock::duration _checked_period(std::chrono::duration<Rep, Period> period);
+
+  /**
+   * \brief Daemon function which waits for and invokes each tick.
+   */
+  void _tick_daemon();
+
+  /**
+   * \brief Adjusts the last tick according to the catch-up policy if the next tick is already overdue. Must be called
+   * while holding `_mutex_`.
+   *
+   * \param now the current time
+   */
+  void _catch_up(clock::time_point now);
+
+  const catch_up_policy _policy;
+  const bool _record_stats;
+  Func _callback_;
+
+  mutable std::mutex _mutex_;
+  std::condition_variable _cv_;
+  /**
+   * \brief Whether the timer should continue ticking. Guarded by `_mutex_`.
+   */
+  bool _keep_alive_ = false;
+
+  /**
+   * \brief Duration between two ticks. Guarded by `_mutex_`.
+   */
+  clock::duration _period_;
+  /**
+   * \brief Deadline of the last tick, or the start time before the first tick. Guarded by `_mutex_`.
+   */
+  clock::time_point _last_ = {};
+  /**
+   * \brief Number of dropped ticks. Guarded by `_mutex_`.
+   */
+  std::uint64_t _missed_ = 0;
+
+  internal::_timer_stats_recorder _stats_;
+
+  std::thread _thread_;
+};
+
+template<typename Func>
+template<typename Rep, typename Period>
+periodic_timer<Func>::periodic_timer(std::chrono::duration<Rep, Period> period,
+                                     const Func& callback,
+                                     const catch_up_policy policy) :
+    _policy{policy}, _record_stats{true}, _callback_{callback}, _period_{_checked_period(period)} {}
+
+template<typename Func>
+template<typename Rep, typename Period>
+periodic_timer<Func>::periodic_timer(std::chrono::duration<Rep, Period> period,
+                                     const Func& callback,
+                                     const config& cfg) :
+    _policy{cfg.policy}, _record_stats{cfg.record_stats}, _callback_{callback}, _period_{_checked_period(period)} {}
+
+template<typename Func>
+periodic_timer<Func>::~periodic_timer() {
+  stop();
+}
+
+template<typename Func>
+void periodic_timer<Func>::start() {
+  if (_thread_.joinable()) {
+    throw std::logic_error{"Attempted to start a running timer"};
+  }
+
+  {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    _keep_alive_ = true;
+    _last_ = clock::now();
+  }
+  _thread_ = std::thread{&periodic_timer::_tick_daemon, this};
+}
+
+template<typename Func>
+void periodic_timer<Func>::stop() {
+  if (!_thread_.joinable()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    _keep_alive_ = false;
+  }
+  _cv_.notify_one();
+
+  _thread_.join();
+}
+
+template<typename Func>
+template<typename Rep, typename Period>
+void periodic_timer<Func>::set_period(std::chrono::duration<Rep, Period> period) {
+  const clock::duration new_period{_checked_period(period)};
+
+  {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    _period_ = new_period;
+    if (_keep_alive_) {
+      _catch_up(clock::now());
+    }
+  }
+  _cv_.notify_one();
+}
+
+template<typename Func>
+template<typename Rep, typename Period>
+typename periodic_timer<Func>::clock::duration periodic_timer<Func>::_checked_period(
+    std::chrono::duration<Rep, Period> period) {
+  const auto converted{std::chrono::duration_cast<clock::duration>(period)};
+  if (converted <= clock::duration::zero()) {
+    throw std::invalid_argument{"Period of a periodic timer must be positive"};
+  }
+
+  return converted;
+}
+
+template<typename Func>
+void periodic_timer<Func>::_tick_daemon() {
+  std::unique_lock<std::mutex> lk{_mutex_};
+  while (_keep_alive_) {
+    // Wait again if the period is changed, as the deadline of the next tick changes with it.
+    const clock::time_point deadline{_last_ + _period_};
+    if (_cv_.wait_until(lk, deadline, [&] { return !_keep_alive_ || _last_ + _period_ != deadline; })) {
+      continue;
+    }
+
+    _last_ = deadline;
+
+    lk.unlock();
+    const clock::time_point start{_record_stats ? clock::now() : clock::time_point{}};
+    if (_callback_) {
+      _callback_();
+    }
+    const clock::time_point end{clock::now()};
+    if (_record_stats) {
+      _stats_._record(deadline, start, end);
+    }
+    lk.lock();
+
+    _catch_up(end);
+  }
+}
+
+template<typename Func>
+void periodic_timer<Func>::_catch_up(const clock::time_point now) {
+  if (now < _last_ + _period_) {
+    return;
+  }
+
+  switch (_policy) {
+    case catch_up_policy::fire_all:
+      break;
+    case catch_up_policy::skip: {
+      const auto missed{(now - _last_) / _period_};
+      _last_ += _period_ * missed;
+      _missed_ += static_cast<std::uint64_t>(missed);
+      break;
+    }
+    case catch_up_policy::reschedule:
+      _missed_ += static_cast<std::uint64_t>((now - _last_) / _period_);
+      _last_ = now;
+      break;
+    default:
+      break;
+  }
+}
+
+#include <derplib/internal/common_macros_end.h>
+
+}  // namespace base
+}  // namespace derplib
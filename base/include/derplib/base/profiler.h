@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <derplib/base/stopwatch.h>
+#include <derplib/base/tsc_clock.h>
+
+namespace derplib {
+namespace internal {
+struct _profile_thread_data;
+}  // namespace internal
+
+inline namespace base {
+
+/**
+ * \brief Aggregated timings of a profiling zone, and of the zones nested within it.
+ */
+struct profile_node {
+  /**
+   * \brief Name of the zone. Empty for the root of a report.
+   */
+  std::string name;
+  /**
+   * \brief Number of times the zone has been exited.
+   */
+  std::uint64_t count;
+  /**
+   * \brief Total time spent in the zone, including nested zones.
+   */
+  std::chrono::nanoseconds total_time;
+  /**
+   * \brief Total time spent in the zone, excluding nested zones.
+   */
+  std::chrono::nanoseconds self_time;
+  /**
+   * \brief Shortest time spent in a single entry of the zone.
+   */
+  std::chrono::nanoseconds min_time;
+  /**
+   * \brief Longest time spent in a single entry of the zone.
+   */
+  std::chrono::nanoseconds max_time;
+  /**
+   * \brief Zones entered while this zone is active, ordered by descending total time.
+   */
+  std::vector<profile_node> children;
+};
+
+/**
+ * \brief Aggregates the timings recorded by `profile_zone`s.
+ */
+class profiler {
+ public:
+  profiler() = delete;
+
+  /**
+   * \brief Merges the timings recorded by all threads into a call tree.
+   *
+   * Zones are merged by their path from the root, so a zone which is entered from different parents appears once under
+   * each parent. Threads which have exited are included.
+   *
+   * \return The root of the call tree, whose children are the outermost zones.
+   */
+  static profile_node collect();
+
+  /**
+   * \brief Clears the timings recorded by all threads, and releases the call trees of threads which have exited.
+   *
+   * Timings of zones which are active during the reset may be partially retained.
+   */
+  static void reset();
+
+  /**
+   * \brief Writes a call tree as an indented report, with one line per zone.
+   *
+   * \param os stream to write to
+   * \param root root of the call tree, as returned by `collect()`
+   */
+  static void print(std::ostream& os, const profile_node& root);
+};
+
+/**
+ * \brief A scoped profiling zone, which records the time between its construction and destruction.
+ *
+ * Timings are recorded into a call tree owned by the current thread, where a zone is nested under the zone which is
+ * active when it is entered. Use `profiler` to aggregate the call trees of all threads.
+ *
+ * Prefer `DERPLIB_PROFILE_ZONE`, which compiles to nothing unless profiling is enabled.
+ */
+class profile_zone {
+ public:
+  /**
+   * \param name name of the zone. Must have static storage duration, such as a string literal.
+   */
+  explicit profile_zone(const char* name);
+
+  profile_zone(const profile_zone&) = delete;
+  profile_zone(profile_zone&&) noexcept = delete;
+
+  profile_zone& operator=(const profile_zone&) = delete;
+  profile_zone& operator=(profile_zone&&) noexcept = delete;
+
+  ~profile_zone();
+
+ private:
+  internal::_profile_thread_data& _thread;
+  const std::size_t _node;
+
+  basic_stopwatch<tsc_clock> _stopwatch_;
+};
+
+}  // namespace base
+}  // namespace derplib
+
+#define DERPLIB_PROFILE_CONCAT_IMPL(a, b) a##b
+#define DERPLIB_PROFILE_CONCAT(a, b) DERPLIB_PROFILE_CONCAT_IMPL(a, b)
+
+#if defined(DERPLIB_ENABLE_PROFILING)
+/**
+ * \brief Profiles the remainder of the enclosing scope as a zone named `name`.
+ *
+ * Compiles to nothing unless `DERPLIB_ENABLE_PROFILING` is defined, in which case `name` must have static storage
+ * duration.
+ */
+#define DERPLIB_PROFILE_ZONE(name) \
+  ::derplib::profile_zone DERPLIB_PROFILE_CONCAT(_derplib_profile_zone_, __LINE__) { name }
+#else
+#define DERPLIB_PROFILE_ZONE(name) static_cast<void>(0)
+#endif  // defined(DERPLIB_ENABLE_PROFILING)
@@ -5,26 +5,40 @@
 namespace derplib {
 inline namespace base {
 /**
- * \brief A basic stopwatch, utilizing `std::chrono::steady_clock`.
+ * \brief A basic stopwatch.
+ *
+ * \tparam Clock Clock used to measure time. Must satisfy the requirements of `TrivialClock`, and should be steady.
  */
-class stopwatch {
+template<typename Clock>
+class basic_stopwatch {
  public:
-  stopwatch() = default;
+  /**
+   * \brief Clock used to measure time.
+   */
+  using clock = Clock;
 
-  stopwatch(const stopwatch& other) = delete;
-  stopwatch(stopwatch&& other) noexcept = default;
+  basic_stopwatch() = default;
 
-  stopwatch& operator=(const stopwatch& other) & = delete;
-  stopwatch& operator=(stopwatch&& other) & noexcept = default;
+  basic_stopwatch(const basic_stopwatch& other) = delete;
+  basic_stopwatch(basic_stopwatch&& other) noexcept = default;
+
+  basic_stopwatch& operator=(const basic_stopwatch& other) & = delete;
+  basic_stopwatch& operator=(basic_stopwatch&& other) & noexcept = default;
 
   /**
    * \brief Starts the stopwatch.
    */
-  void start();
+  void start() {
+    _is_active_ = true;
+    _start_ = clock::now();
+  }
   /**
    * \brief Stops the stopwatch.
    */
-  void stop();
+  void stop() {
+    _end_ = clock::now();
+    _is_active_ = false;
+  }
 
   /**
    * \brief Retrieves either the time elapsed since the stopwatch started, or the duration of the
@@ -46,14 +60,19 @@ class stopwatch {
    */
   template<typename ToDuration = std::chrono::nanoseconds>
   ToDuration duration() const {
-    return std::chrono::duration_cast<ToDuration>((_is_active_ ? std::chrono::steady_clock::now() : _end_) - _start_);
+    return std::chrono::duration_cast<ToDuration>((_is_active_ ? clock::now() : _end_) - _start_);
   }
 
  private:
-  std::chrono::time_point<std::chrono::steady_clock> _start_;
-  std::chrono::time_point<std::chrono::steady_clock> _end_;
+  typename clock::time_point _start_;
+  typename clock::time_point _end_;
 
   bool _is_active_ = false;
 };
+
+/**
+ * \brief A basic stopwatch, utilizing `std::chrono::steady_clock`.
+ */
+using stopwatch = basic_stopwatch<std::chrono::steady_clock>;
 }  // namespace base
 }  // namespace derplib
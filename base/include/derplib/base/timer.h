@@ -2,9 +2,11 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
-#include <iostream>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
 
 #include <derplib/stdext/type_traits.h>
@@ -15,6 +17,9 @@ inline namespace base {
 /**
  * \brief A simple timer that invokes a callback after a fixed amount of time.
  *
+ * The countdown thread blocks until either the deadline is reached or the timer is stopped, so an idle timer does not
+ * consume any CPU time, and stopping a timer returns without waiting for the deadline.
+ *
  * \tparam Func function type. Must be `void f()`.
  */
 template<typename Func = std::function<void()>, typename = stdext::enable_if_invocable<Func>>
@@ -32,30 +37,30 @@ class timer<Func> {
    * \param callback callback function to run when the timer expires
    */
   template<typename Rep, typename Period>
-  timer(std::chrono::duration<Rep, Period> duration, const Func& callback) :
-      timer(duration, std::move(callback), duration) {}
+  timer(std::chrono::duration<Rep, Period> duration, const Func& callback);
 
   /**
    * \brief Constructs an instance of `timer`.
    *
+   * \deprecated The timer no longer polls for termination, so `poll_rate` is ignored.
+   *
    * \tparam Rep an arithmetic type representing the number of ticks
    * \tparam Period a `std::ratio` representing the tick period
    * \param duration duration of the timer
    * \param callback callback function to run when the timer expires
-   * \param poll_rate rate at which the timer checks whether it should terminate
    */
   template<typename Rep, typename Period>
-  timer(std::chrono::duration<Rep, Period> duration,
-        const Func& callback,
-        std::chrono::duration<Rep, Period> poll_rate);
+  timer(std::chrono::duration<Rep, Period> duration, const Func& callback, std::chrono::duration<Rep, Period>) :
+      timer(duration, callback) {}
 
-  timer(const timer& other) : timer(other._duration, other._callback, other._poll_rate) {}
+  timer(const timer& other) : timer(other._duration_, other._callback_) {}
   timer(timer&& other) noexcept = default;
 
   /**
    * \brief Copy-assignment operator.
    *
-   * Copies `duration`, `callback` and `poll_rate` from the `other` timer, but does not start it.
+   * Stops this timer if it is running, then copies `duration` and `callback` from the `other` timer, but does not
+   * start it.
    *
    * \param other `timer` to copy from.
    * \return `*this`.
@@ -71,6 +76,9 @@ class timer<Func> {
   void start();
   /**
    * \brief Stops the timer.
+   *
+   * Returns as soon as the countdown thread is woken, unless the callback is being invoked, in which case this waits
+   * for the callback to return.
    */
   void stop();
   /**
@@ -86,15 +94,25 @@ class timer<Func> {
   enum struct State { Halted = -1, NotStarted, Active, Expired };
 
   /**
-   * \brief Daemon function for polling the timer.
+   * \brief Daemon function which waits for the timer to expire or be stopped.
    */
   void _countdown_daemon();
 
+  /**
+   * \brief Wakes and joins the countdown thread.
+   */
+  void _halt();
+
   std::atomic<State> _state_;
-  std::atomic<bool> _keep_alive_;
 
-  const std::chrono::nanoseconds _duration;
-  const std::chrono::nanoseconds _poll_rate;
+  std::mutex _mutex_;
+  std::condition_variable _cv_;
+  /**
+   * \brief Whether the countdown should continue. Guarded by `_mutex_`.
+   */
+  bool _keep_alive_;
+
+  std::chrono::nanoseconds _duration_;
 
   Func _callback_;
   std::thread _thread_;
@@ -104,23 +122,21 @@ class timer<Func> {
 
 template<typename Func>
 template<typename Rep, typename Period>
-timer<Func>::timer(std::chrono::duration<Rep, Period> duration,
-                   const Func& callback,
-                   std::chrono::duration<Rep, Period> poll_rate) :
+timer<Func>::timer(std::chrono::duration<Rep, Period> duration, const Func& callback) :
     _state_{State::NotStarted},
     _keep_alive_{true},
-    _duration{std::chrono::nanoseconds(duration)},
-    _poll_rate{std::chrono::nanoseconds(poll_rate)},
+    _duration_{std::chrono::duration_cast<std::chrono::nanoseconds>(duration)},
     _callback_{callback} {}
 
 template<typename Func>
 timer<Func>& timer<Func>::operator=(const timer& other) & {
   if (this != &other) {
+    _halt();
+
     _state_ = State::NotStarted;
     _keep_alive_ = true;
-    _duration = other._duration;
-    _poll_rate = other._poll_rate;
-    _callback_ = other._callback;
+    _duration_ = other._duration_;
+    _callback_ = other._callback_;
   }
 
   return *this;
@@ -128,11 +144,7 @@ timer<Func>& timer<Func>::operator=(const timer& other) & {
 
 template<typename Func>
 timer<Func>::~timer() {
-  _keep_alive_ = false;
-
-  if (_thread_.joinable()) {
-    _thread_.join();
-  }
+  _halt();
 }
 
 template<typename Func>
@@ -144,7 +156,8 @@ void timer<Func>::start() {
   }
 
   _state_ = State::Active;
-  _end_time_ = std::chrono::steady_clock::now() + _duration;
+  _keep_alive_ = true;
+  _end_time_ = std::chrono::steady_clock::now() + _duration_;
   _thread_ = std::thread{&timer::_countdown_daemon, this};
 }
 
@@ -157,28 +170,18 @@ void timer<Func>::stop() {
     throw std::logic_error{"Attempted to stop a halted timer"};
   }
 
-  _keep_alive_ = false;
-
-  if (_thread_.joinable()) {
-    _thread_.join();
-  }
-
-  _thread_ = std::thread{};
+  _halt();
 }
 
 template<typename Func>
 void timer<Func>::_countdown_daemon() {
-  _state_ = State::Active;
+  std::unique_lock<std::mutex> lk{_mutex_};
+  if (_cv_.wait_until(lk, _end_time_, [this] { return !_keep_alive_; })) {
+    _state_ = State::Halted;
 
-  while (std::chrono::steady_clock::now() < _end_time_) {
-    if (!_keep_alive_) {
-      _state_ = State::Halted;
-
-      return;
-    }
-
-    std::this_thread::sleep_for(_poll_rate);
+    return;
   }
+  lk.unlock();
 
   _state_ = State::Expired;
   if (_callback_) {
@@ -186,5 +189,18 @@ void timer<Func>::_countdown_daemon() {
   }
 }
 
+template<typename Func>
+void timer<Func>::_halt() {
+  {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    _keep_alive_ = false;
+  }
+  _cv_.notify_one();
+
+  if (_thread_.joinable()) {
+    _thread_.join();
+  }
+}
+
 }  // namespace base
 }  // namespace derplib
@@ -0,0 +1,283 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <derplib/base/timer_stats.h>
+
+namespace derplib {
+inline namespace base {
+
+#include <derplib/internal/common_macros_begin.h>
+
+/**
+ * \brief A service which invokes callbacks at given times, using a single driver thread.
+ *
+ * Timers are kept in a hierarchical timing wheel of four levels with 256 slots each. Scheduling and cancelling a timer
+ * take constant time regardless of the number of pending timers. Timers are rounded up to the next multiple of
+ * `config::resolution`, so a callback is never invoked before its deadline.
+ *
+ * Callbacks are invoked on the driver thread by default, and should therefore be short and must not throw. Set
+ * `config::executor` to dispatch callbacks onto another thread, such as a worker pool.
+ */
+class timer_service {
+ public:
+  /**
+   * \brief Clock used to measure deadlines.
+   */
+  using clock = std::chrono::steady_clock;
+  /**
+   * \brief Type of a timer callback.
+   */
+  using callback_type = std::function<void()>;
+  /**
+   * \brief Type of a function which invokes a timer callback.
+   */
+  using executor_type = std::function<void(callback_type)>;
+
+  /**
+   * \brief Service configuration.
+   */
+  struct config {
+    /**
+     * \brief Duration of a tick of the timing wheel. Deadlines are rounded up to a multiple of this duration.
+     */
+    std::chrono::nanoseconds resolution{std::chrono::milliseconds{1}};
+    /**
+     * \brief Function used to dispatch expired callbacks. If empty, callbacks are invoked on the driver thread.
+     */
+    executor_type executor;
+    /**
+     * \brief Whether to record the lateness and execution time of each callback.
+     *
+     * Recording requires reading the clock twice per callback on the driver thread. If `executor` is set, the
+     * execution time only covers dispatching the callback.
+     */
+    bool record_stats = true;
+  };
+
+  /**
+   * \brief Handle to a scheduled timer.
+   *
+   * A handle must not be used after the service which created it has been destroyed.
+   */
+  class handle {
+   public:
+    /**
+     * \brief Constructs a handle which does not refer to any timer.
+     */
+    handle() noexcept = default;
+
+    /**
+     * \brief Cancels the timer.
+     *
+     * \return `true` if the timer is cancelled, `false` if the timer has already expired or been cancelled, or if
+     * this handle does not refer to any timer.
+     */
+    bool cancel();
+
+   private:
+    friend class timer_service;
+
+    handle(timer_service* service, std::size_t index, std::uint32_t generation) noexcept :
+        _service_{service}, _index_{index}, _generation_{generation} {}
+
+    timer_service* _service_ = nullptr;
+    std::size_t _index_ = 0;
+    std::uint32_t _generation_ = 0;
+  };
+
+  /**
+   * \brief Constructs a service with the default configuration.
+   */
+  timer_service();
+
+  /**
+   * \param cfg Configuration of the service.
+   * \throw std::invalid_argument if `cfg.resolution` is not positive.
+   */
+  explicit timer_service(const config& cfg);
+
+  timer_service(const timer_service&) = delete;
+  timer_service(timer_service&&) noexcept = delete;
+
+  timer_service& operator=(const timer_service&) = delete;
+  timer_service& operator=(timer_service&&) noexcept = delete;
+
+  /**
+   * \brief Destructor.
+   *
+   * Stops the driver thread. Pending timers are discarded without being invoked.
+   */
+  ~timer_service();
+
+  /**
+   * \brief Schedules a callback to be invoked after a duration.
+   *
+   * \tparam Rep an arithmetic type representing the number of ticks
+   * \tparam Period a `std::ratio` representing the tick period
+   * \param delay duration after which `callback` is invoked
+   * \param callback function to invoke
+   * \return Handle which can be used to cancel the timer.
+   */
+  template<typename Rep, typename Period>
+  handle schedule_after(std::chrono::duration<Rep, Period> delay, callback_type callback) {
+    return schedule_at(clock::now() + std::chrono::duration_cast<clock::duration>(delay), std::move(callback));
+  }
+
+  /**
+   * \brief Schedules a callback to be invoked at a point in time.
+   *
+   * \param deadline time at which `callback` is invoked
+   * \param callback function to invoke
+   * \return Handle which can be used to cancel the timer.
+   */
+  handle schedule_at(clock::time_point deadline, callback_type callback);
+
+  /**
+   * \brief Cancels a timer.
+   *
+   * \param h handle of the timer
+   * \return `true` if the timer is cancelled, `false` if the timer has already expired or been cancelled, or if `h`
+   * does not refer to a timer of this service.
+   */
+  bool cancel(const handle& h);
+
+  /**
+   * \return Number of timers which are scheduled but have not expired.
+   */
+  DERPLIB_NODISCARD std::size_t pending() const;
+
+  /**
+   * \return The statistics of the callbacks invoked so far. Lateness is measured from the deadline rounded up to the
+   * resolution. Only populated if `config::record_stats` is `true`.
+   */
+  DERPLIB_NODISCARD timer_stats stats() const { return _stats_._snapshot(); }
+
+ private:
+  /**
+   * \brief Number of bits of the tick used to index the slots of each level.
+   */
+  static constexpr unsigned SlotBits = 8;
+  static constexpr std::size_t SlotsPerLevel = std::size_t{1} << SlotBits;
+  static constexpr std::size_t Levels = 4;
+  /**
+   * \brief Sentinel index for the end of a list.
+   */
+  static constexpr std::size_t NoNode = std::numeric_limits<std::size_t>::max();
+
+  /**
+   * \brief A timer, stored in `_nodes_` and linked into a slot of the wheel.
+   */
+  struct _node {
+    callback_type _callback;
+    /**
+     * \brief Tick at which the timer expires.
+     */
+    std::uint64_t _due;
+    /**
+     * \brief Incremented every time the node is released, so that stale handles can be detected.
+     */
+    std::uint32_t _generation;
+    /**
+     * \brief Index of the slot the node is linked into, or `NoNode` if the node is free.
+     */
+    std::size_t _slot;
+    std::size_t _prev;
+    std::size_t _next;
+  };
+
+  /**
+   * \brief A timer which has expired and is waiting to be invoked.
+   */
+  struct _expiry {
+    callback_type _callback;
+    clock::time_point _deadline;
+  };
+
+  /**
+   * \brief Daemon method of the driver thread.
+   */
+  void _driver();
+
+  /**
+   * \brief Advances the wheel to a tick, collecting the expired timers. Must be called while holding `_mutex_`.
+   *
+   * \param tick the tick to advance to
+   * \param expired receives the expired timers
+   */
+  void _advance(std::uint64_t tick, std::vector<_expiry>& expired);
+
+  /**
+   * \return The next tick at which the wheel needs to be advanced. Must be called while holding `_mutex_`.
+   */
+  std::uint64_t _next_event_tick() const;
+
+  /**
+   * \brief Links a node into the slot matching its due tick. Must be called while holding `_mutex_`.
+   */
+  void _insert(std::size_t index);
+
+  /**
+   * \brief Unlinks a node from its slot. Must be called while holding `_mutex_`.
+   */
+  void _unlink(std::size_t index);
+
+  /**
+   * \brief Returns a node to the free list. Must be called while holding `_mutex_`.
+   */
+  void _release(std::size_t index);
+
+  /**
+   * \return The first tick at or after `time_point`.
+   */
+  std::uint64_t _to_tick(clock::time_point time_point) const;
+
+  /**
+   * \return The time at which `tick` starts.
+   */
+  clock::time_point _to_time_point(std::uint64_t tick) const;
+
+  const std::chrono::nanoseconds _resolution;
+  const executor_type _executor;
+  const bool _record_stats;
+  const clock::time_point _epoch;
+
+  mutable std::mutex _mutex_;
+  std::condition_variable _cv_;
+  bool _keep_alive_ = true;
+
+  /**
+   * \brief The last tick which has been processed.
+   */
+  std::uint64_t _current_tick_ = 0;
+  /**
+   * \brief The tick the driver thread is sleeping until, or `0` if the driver thread is not sleeping.
+   */
+  std::uint64_t _wake_tick_ = 0;
+  std::size_t _size_ = 0;
+
+  std::vector<_node> _nodes_;
+  std::size_t _free_ = NoNode;
+  /**
+   * \brief Head of the list of each slot. Slot `s` of level `l` is at index `l * SlotsPerLevel + s`.
+   */
+  std::array<std::size_t, Levels * SlotsPerLevel> _slots_;
+
+  internal::_timer_stats_recorder _stats_;
+
+  std::thread _thread_;
+};
+
+#include <derplib/internal/common_macros_end.h>
+
+}  // namespace base
+}  // namespace derplib
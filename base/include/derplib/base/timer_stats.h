@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include <derplib/internal/log2_histogram.h>
+
+namespace derplib {
+inline namespace base {
+
+/**
+ * \brief Statistics of the callbacks invoked by a timer.
+ */
+struct timer_stats {
+  /**
+   * \brief Distribution of durations.
+   *
+   * Bucket `0` counts durations of zero nanoseconds, and bucket `i` counts durations in the range
+   * `[2^(i-1), 2^i)` nanoseconds.
+   */
+  using latency_histogram = std::array<std::uint64_t, 64>;
+
+  /**
+   * \brief Number of callbacks which have been invoked.
+   */
+  std::uint64_t fired;
+  /**
+   * \brief Distribution of the time between the deadline of a callback and the start of its invocation.
+   */
+  latency_histogram lateness;
+  /**
+   * \brief Distribution of the time spent invoking each callback.
+   */
+  latency_histogram callback_time;
+};
+
+}  // namespace base
+
+namespace internal {
+
+/**
+ * \brief Records the lateness and execution time of timer callbacks into histograms. Records may be taken concurrently
+ * with snapshots.
+ */
+class _timer_stats_recorder {
+ public:
+  using _clock = std::chrono::steady_clock;
+
+  /**
+   * \brief Records the invocation of a callback.
+   *
+   * \param deadline time at which the callback was due
+   * \param start time at which the invocation started
+   * \param end time at which the invocation returned
+   */
+  void _record(const _clock::time_point deadline,
+               const _clock::time_point start,
+               const _clock::time_point end) noexcept {
+    _lateness_._record(_elapsed_ns(deadline, start));
+    _callback_time_._record(_elapsed_ns(start, end));
+  }
+
+  /**
+   * \return The statistics recorded so far.
+   */
+  timer_stats _snapshot() const noexcept {
+    timer_stats stats{};
+    stats.lateness = _lateness_._snapshot();
+    stats.callback_time = _callback_time_._snapshot();
+    for (const std::uint64_t count : stats.lateness) {
+      stats.fired += count;
+    }
+    return stats;
+  }
+
+ private:
+  /**
+   * \return The number of nanoseconds from `begin` to `end`, or `0` if `end` is before `begin`.
+   */
+  static std::uint64_t _elapsed_ns(const _clock::time_point begin, const _clock::time_point end) noexcept {
+    const auto ns{std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()};
+    return ns > 0 ? static_cast<std::uint64_t>(ns) : 0;
+  }
+
+  _log2_histogram<std::tuple_size<timer_stats::latency_histogram>::value> _lateness_;
+  _log2_histogram<std::tuple_size<timer_stats::latency_histogram>::value> _callback_time_;
+};
+
+}  // namespace internal
+}  // namespace derplib
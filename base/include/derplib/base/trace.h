@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#include <derplib/base/tsc_clock.h>
+
+namespace derplib {
+inline namespace base {
+
+/**
+ * \brief Records timed events into per-thread buffers, and exports them as Chrome trace-event JSON.
+ *
+ * Each thread records into its own fixed-capacity buffer without taking a lock, and events which do not fit into the
+ * buffer are dropped. The exported JSON can be loaded by `chrome://tracing` or by the Perfetto UI to display a timeline
+ * of every thread.
+ */
+class tracer {
+ public:
+  tracer() = delete;
+
+  /**
+   * \brief Records an event which spans a duration of time on the current thread.
+   *
+   * \param name name of the event. Must have static storage duration, such as a string literal.
+   * \param begin time when the event began
+   * \param end time when the event ended
+   */
+  static void complete(const char* name, tsc_clock::time_point begin, tsc_clock::time_point end);
+
+  /**
+   * \brief Records an event which happens at the current time on the current thread.
+   *
+   * \param name name of the event. Must have static storage duration, such as a string literal.
+   */
+  static void instant(const char* name);
+
+  /**
+   * \brief Sets the name of the current thread, as shown in the exported trace.
+   *
+   * \param name name of the thread
+   */
+  static void set_thread_name(const std::string& name);
+
+  /**
+   * \brief Sets the number of events which can be recorded by each thread.
+   *
+   * Only applies to threads which record their first event after this call. Defaults to `65536`.
+   *
+   * \param events maximum number of events recorded by each thread. Must be positive.
+   * \throw std::invalid_argument if `events` is zero
+   */
+  static void set_buffer_capacity(std::size_t events);
+
+  /**
+   * \return Number of events which have been dropped since the last `clear()` because the buffer of the recording
+   * thread was full.
+   */
+  static std::uint64_t dropped();
+
+  /**
+   * \brief Discards the events recorded by all threads, and releases the buffers of threads which have exited.
+   */
+  static void clear();
+
+  /**
+   * \brief Writes the events recorded by all threads as a Chrome trace-event JSON object.
+   *
+   * Threads which have exited are included. Events recorded concurrently with this call may or may not be included.
+   *
+   * \param os stream to write to
+   */
+  static void write_json(std::ostream& os);
+};
+
+/**
+ * \brief A scoped trace event, which spans the time between its construction and destruction.
+ *
+ * Prefer `DERPLIB_TRACE_ZONE`, which compiles to nothing unless tracing is enabled.
+ */
+class trace_zone {
+ public:
+  /**
+   * \param name name of the event. Must have static storage duration, such as a string literal.
+   */
+  explicit trace_zone(const char* name) noexcept : _name{name}, _begin{tsc_clock::now()} {}
+
+  trace_zone(const trace_zone&) = delete;
+  trace_zone(trace_zone&&) noexcept = delete;
+
+  trace_zone& operator=(const trace_zone&) = delete;
+  trace_zone& operator=(trace_zone&&) noexcept = delete;
+
+  ~trace_zone() { tracer::complete(_name, _begin, tsc_clock::now()); }
+
+ private:
+  const char* const _name;
+  const tsc_clock::time_point _begin;
+};
+
+}  // namespace base
+}  // namespace derplib
+
+#define DERPLIB_TRACE_CONCAT_IMPL(a, b) a##b
+#define DERPLIB_TRACE_CONCAT(a, b) DERPLIB_TRACE_CONCAT_IMPL(a, b)
+
+#if defined(DERPLIB_ENABLE_TRACING)
+/**
+ * \brief Records the remainder of the enclosing scope as a trace event named `name`.
+ *
+ * Compiles to nothing unless `DERPLIB_ENABLE_TRACING` is defined, in which case `name` must have static storage
+ * duration.
+ */
+#define DERPLIB_TRACE_ZONE(name) \
+  ::derplib::trace_zone DERPLIB_TRACE_CONCAT(_derplib_trace_zone_, __LINE__) { name }
+/**
+ * \brief Records an instant trace event named `name`.
+ *
+ * Compiles to nothing unless `DERPLIB_ENABLE_TRACING` is defined, in which case `name` must have static storage
+ * duration.
+ */
+#define DERPLIB_TRACE_INSTANT(name) ::derplib::tracer::instant(name)
+#else
+#define DERPLIB_TRACE_ZONE(name) static_cast<void>(0)
+#define DERPLIB_TRACE_INSTANT(name) static_cast<void>(0)
+#endif  // defined(DERPLIB_ENABLE_TRACING)
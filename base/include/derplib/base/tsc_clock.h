@@ -0,0 +1,111 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DERPLIB_TSC_CLOCK_HAS_TSC 1
+#endif  // defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+namespace derplib {
+namespace internal {
+/**
+ * \brief Parameters for converting the time stamp counter into nanoseconds.
+ *
+ * The time in nanoseconds is `_base_ns + (((tsc - _base_tsc) * _multiplier) >> Shift)`.
+ */
+struct _tsc_calibration {
+  static constexpr unsigned Shift = 32;
+
+  bool _uses_tsc;
+  std::uint64_t _base_tsc;
+  std::int64_t _base_ns;
+  std::uint64_t _multiplier;
+  double _frequency;
+};
+
+/**
+ * \brief Calibrates the time stamp counter against `std::chrono::steady_clock`.
+ */
+_tsc_calibration _calibrate_tsc() noexcept;
+
+/**
+ * \return The calibration used by `tsc_clock`, which is measured on first use.
+ */
+inline const _tsc_calibration& _tsc_calibration_data() noexcept {
+  static const _tsc_calibration calibration{_calibrate_tsc()};
+  return calibration;
+}
+
+inline std::int64_t _steady_ns() noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+}  // namespace internal
+
+inline namespace base {
+
+/**
+ * \brief A steady clock which reads the time stamp counter of the CPU.
+ *
+ * Reading the time stamp counter is an order of magnitude cheaper than `std::chrono::steady_clock`, which makes this
+ * clock suitable for timing sections which take less than a microsecond. The counter is read using `rdtsc`, which is
+ * not ordered with respect to neighboring instructions, so time points may be off by the few cycles that the CPU
+ * executes out of order.
+ *
+ * The counter is only used if the CPU reports an invariant time stamp counter, i.e. one which ticks at a constant rate
+ * regardless of frequency scaling and sleep states. On first use, the rate of the counter is calibrated against
+ * `std::chrono::steady_clock`, which blocks the calling thread for about 10 milliseconds. If the counter is not
+ * invariant, or the platform is not x86-64 with a GCC-compatible compiler, this clock falls back to
+ * `std::chrono::steady_clock`.
+ *
+ * The epoch of this clock is unspecified, so its time points must not be compared with time points of other clocks.
+ */
+class tsc_clock {
+ public:
+  using rep = std::int64_t;
+  using period = std::nano;
+  using duration = std::chrono::duration<rep, period>;
+  using time_point = std::chrono::time_point<tsc_clock>;
+
+  static constexpr bool is_steady = true;
+
+  /**
+   * \return The current time.
+   */
+  static time_point now() noexcept;
+
+  /**
+   * \return Whether this clock reads the time stamp counter, as opposed to falling back to
+   * `std::chrono::steady_clock`.
+   */
+  static bool uses_tsc() noexcept;
+
+  /**
+   * \return The calibrated rate of the time stamp counter in ticks per second, or `0` if this clock does not read the
+   * time stamp counter.
+   */
+  static double tsc_frequency() noexcept;
+};
+
+inline tsc_clock::time_point tsc_clock::now() noexcept {
+#if defined(DERPLIB_TSC_CLOCK_HAS_TSC)
+  const internal::_tsc_calibration& calibration{internal::_tsc_calibration_data()};
+  if (calibration._uses_tsc) {
+    __extension__ using uint128 = unsigned __int128;
+
+    // The counter may be slightly behind the calibration base if this thread runs on another core.
+    const std::uint64_t tsc{__builtin_ia32_rdtsc()};
+    const auto delta{static_cast<uint128>(tsc > calibration._base_tsc ? tsc - calibration._base_tsc : 0)};
+    const auto delta_ns{
+        static_cast<std::int64_t>((delta * calibration._multiplier) >> internal::_tsc_calibration::Shift)};
+    return time_point{duration{calibration._base_ns + delta_ns}};
+  }
+#endif  // defined(DERPLIB_TSC_CLOCK_HAS_TSC)
+
+  return time_point{duration{internal::_steady_ns()}};
+}
+
+}  // namespace base
+}  // namespace derplib
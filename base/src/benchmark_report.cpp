@@ -0,0 +1,639 @@
+#include "derplib/base/benchmark_report.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include "derplib/internal/json_string.h"
+
+namespace derplib {
+inline namespace base {
+namespace {
+/**
+ * \brief Maximum nesting depth of JSON values, beyond which the input is rejected.
+ */
+constexpr unsigned MaxJsonDepth = 64;
+
+/**
+ * \return The model name of the CPU, or an empty string if it cannot be determined.
+ */
+std::string _cpu_model() {
+#if defined(__linux__)
+  std::ifstream cpuinfo{"/proc/cpuinfo"};
+  std::string line{};
+  while (std::getline(cpuinfo, line)) {
+    if (line.compare(0, 10, "model name") != 0) {
+      continue;
+    }
+
+    const auto colon{line.find(':')};
+    if (colon == std::string::npos) {
+      continue;
+    }
+    const auto begin{line.find_first_not_of(" \t", colon + 1)};
+    return begin == std::string::npos ? "" : line.substr(begin);
+  }
+#endif  // defined(__linux__)
+  return "";
+}
+
+/**
+ * \return The name and version of the compiler.
+ */
+std::string _compiler() {
+#if defined(__clang__)
+  return "clang " __clang_version__;
+#elif defined(__GNUC__)
+  return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+  return "msvc " + std::to_string(_MSC_VER);
+#else
+  return "unknown";
+#endif  // defined(__clang__)
+}
+
+void _write_json_string(std::ostream& os, const std::string& str) {
+  internal::_write_json_string(os, str.c_str());
+}
+
+void _write_json_number(std::ostream& os, const double value) {
+  // JSON has no representation for infinities and NaNs.
+  os << (std::isfinite(value) ? value : 0.0);
+}
+
+/**
+ * \brief Reads JSON values of an expected structure from a string.
+ */
+class _json_reader {
+ public:
+  explicit _json_reader(std::string text) : _text{std::move(text)} {}
+
+  /**
+   * \brief Reads an object, invoking `f` with each key. `f` must read the corresponding value.
+   */
+  template<typename F>
+  void read_object(F&& f) {
+    _enter();
+    _expect('{');
+    if (!_consume('}')) {
+      do {
+        const std::string key{read_string()};
+        _expect(':');
+        f(key);
+      } while (_consume(','));
+      _expect('}');
+    }
+    --_depth_;
+  }
+
+  /**
+   * \brief Reads an array, invoking `f` for each element. `f` must read the element.
+   */
+  template<typename F>
+  void read_array(F&& f) {
+    _enter();
+    _expect('[');
+    if (!_consume(']')) {
+      do {
+        f();
+      } while (_consume(','));
+      _expect(']');
+    }
+    --_depth_;
+  }
+
+  std::string read_string() {
+    _expect('"');
+
+    std::string str{};
+    for (;;) {
+      if (_pos_ >= _text.size()) {
+        throw benchmark_format_error{"Unterminated string"};
+      }
+
+      const char c{_text[_pos_++]};
+      if (c == '"') {
+        return str;
+      }
+      if (static_cast<unsigned char>(c) < 0x20) {
+        throw benchmark_format_error{"Control character in string"};
+      }
+      if (c != '\\') {
+        str += c;
+        continue;
+      }
+
+      if (_pos_ >= _text.size()) {
+        throw benchmark_format_error{"Unterminated string"};
+      }
+      const char escape{_text[_pos_++]};
+      switch (escape) {
+        case '"':
+        case '\\':
+        case '/':
+          str += escape;
+          break;
+        case 'b':
+          str += '\b';
+          break;
+        case 'f':
+          str += '\f';
+          break;
+        case 'n':
+          str += '\n';
+          break;
+        case 'r':
+          str += '\r';
+          break;
+        case 't':
+          str += '\t';
+          break;
+        case 'u':
+          _append_utf8(str, _read_code_point());
+          break;
+        default:
+          throw benchmark_format_error{"Invalid escape sequence in string"};
+      }
+    }
+  }
+
+  double read_number() {
+    _skip_whitespace();
+
+    const std::size_t begin{_pos_};
+    while (_pos_ < _text.size() && std::string{"+-.0123456789eE"}.find(_text[_pos_]) != std::string::npos) {
+      ++_pos_;
+    }
+    const std::string number{_text.substr(begin, _pos_ - begin)};
+
+    char* end{nullptr};
+    const double value{std::strtod(number.c_str(), &end)};
+    if (number.empty() || end != number.c_str() + number.size()) {
+      throw benchmark_format_error{"Expected a number"};
+    }
+    return value;
+  }
+
+  bool read_bool() {
+    if (_consume_literal("true")) {
+      return true;
+    }
+    if (_consume_literal("false")) {
+      return false;
+    }
+    throw benchmark_format_error{"Expected a boolean"};
+  }
+
+  /**
+   * \brief Reads and discards a value of any type.
+   */
+  void skip_value() {
+    _skip_whitespace();
+    if (_pos_ >= _text.size()) {
+      throw benchmark_format_error{"Unexpected end of input"};
+    }
+
+    switch (_text[_pos_]) {
+      case '{':
+        read_object([this](const std::string&) { skip_value(); });
+        break;
+      case '[':
+        read_array([this] { skip_value(); });
+        break;
+      case '"':
+        read_string();
+        break;
+      case 't':
+      case 'f':
+        read_bool();
+        break;
+      case 'n':
+        if (!_consume_literal("null")) {
+          throw benchmark_format_error{"Unexpected token"};
+        }
+        break;
+      default:
+        read_number();
+        break;
+    }
+  }
+
+  /**
+   * \brief Checks that there is nothing but whitespace remaining.
+   */
+  void finish() {
+    _skip_whitespace();
+    if (_pos_ != _text.size()) {
+      throw benchmark_format_error{"Unexpected trailing characters"};
+    }
+  }
+
+ private:
+  void _enter() {
+    if (++_depth_ > MaxJsonDepth) {
+      throw benchmark_format_error{"Values are nested too deeply"};
+    }
+  }
+
+  void _skip_whitespace() noexcept {
+    while (_pos_ < _text.size() &&
+           (_text[_pos_] == ' ' || _text[_pos_] == '\t' || _text[_pos_] == '\n' || _text[_pos_] == '\r')) {
+      ++_pos_;
+    }
+  }
+
+  bool _consume(const char c) noexcept {
+    _skip_whitespace();
+    if (_pos_ < _text.size() && _text[_pos_] == c) {
+      ++_pos_;
+      return true;
+    }
+    return false;
+  }
+
+  void _expect(const char c) {
+    if (!_consume(c)) {
+      throw benchmark_format_error{std::string{"Expected '"} + c + "'"};
+    }
+  }
+
+  bool _consume_literal(const std::string& literal) noexcept {
+    _skip_whitespace();
+    if (_text.compare(_pos_, literal.size(), literal) != 0) {
+      return false;
+    }
+    _pos_ += literal.size();
+    return true;
+  }
+
+  unsigned _read_hex4() {
+    if (_text.size() - _pos_ < 4) {
+      throw benchmark_format_error{"Invalid escape sequence in string"};
+    }
+
+    unsigned value{0};
+    for (std::size_t i{0}; i < 4; ++i) {
+      const char c{_text[_pos_++]};
+      value <<= 4;
+      if (c >= '0' && c <= '9') {
+        value |= static_cast<unsigned>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        value |= static_cast<unsigned>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        value |= static_cast<unsigned>(c - 'A' + 10);
+      } else {
+        throw benchmark_format_error{"Invalid escape sequence in string"};
+      }
+    }
+    return value;
+  }
+
+  /**
+   * \brief Reads the hexadecimal digits of a `\u` escape sequence, combining surrogate pairs.
+   */
+  unsigned _read_code_point() {
+    const unsigned high{_read_hex4()};
+    if (high < 0xD800 || high > 0xDBFF) {
+      return high;
+    }
+
+    if (_text.compare(_pos_, 2, "\\u") != 0) {
+      throw benchmark_format_error{"Unpaired surrogate in string"};
+    }
+    _pos_ += 2;
+    const unsigned low{_read_hex4()};
+    if (low < 0xDC00 || low > 0xDFFF) {
+      throw benchmark_format_error{"Unpaired surrogate in string"};
+    }
+    return 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+  }
+
+  static void _append_utf8(std::string& str, const unsigned code_point) {
+    if (code_point < 0x80) {
+      str += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+      str += static_cast<char>(0xC0 | (code_point >> 6));
+      str += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+      str += static_cast<char>(0xE0 | (code_point >> 12));
+      str += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+      str += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+      str += static_cast<char>(0xF0 | (code_point >> 18));
+      str += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+      str += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+      str += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+  }
+
+  const std::string _text;
+  std::size_t _pos_ = 0;
+  unsigned _depth_ = 0;
+};
+
+/**
+ * \return `value` as a non-negative integer.
+ * \throw benchmark_format_error if `value` is negative or too large
+ */
+std::uint64_t _to_uint(const double value) {
+  if (!(value >= 0.0 && value < 18446744073709551616.0)) {
+    throw benchmark_format_error{"Expected a non-negative integer"};
+  }
+  return static_cast<std::uint64_t>(value);
+}
+
+benchmark_context _read_context(_json_reader& reader) {
+  benchmark_context context{"", 0, "", "", false};
+  reader.read_object([&](const std::string& key) {
+    if (key == "cpu_model") {
+      context.cpu_model = reader.read_string();
+    } else if (key == "cpu_count") {
+      const std::uint64_t cpu_count{_to_uint(reader.read_number())};
+      context.cpu_count = cpu_count > std::numeric_limits<unsigned>::max() ? std::numeric_limits<unsigned>::max()
+                                                                           : static_cast<unsigned>(cpu_count);
+    } else if (key == "compiler") {
+      context.compiler = reader.read_string();
+    } else if (key == "build_type") {
+      context.build_type = reader.read_string();
+    } else if (key == "allocations_tracked") {
+      context.allocations_tracked = reader.read_bool();
+    } else {
+      reader.skip_value();
+    }
+  });
+  return context;
+}
+
+benchmark_result _read_result(_json_reader& reader) {
+  benchmark_result result{"", 0, {}, 0.0, 0.0, 0.0, 0.0};
+  bool has_name{false};
+  reader.read_object([&](const std::string& key) {
+    if (key == "name") {
+      result.name = reader.read_string();
+      has_name = true;
+    } else if (key == "iterations") {
+      result.iterations = _to_uint(reader.read_number());
+    } else if (key == "ns_per_op") {
+      result.median_ns = reader.read_number();
+    } else if (key == "mad_ns") {
+      result.mad_ns = reader.read_number();
+    } else if (key == "bytes_per_op") {
+      result.bytes_per_op = reader.read_number();
+    } else if (key == "allocations_per_op") {
+      result.allocations_per_op = reader.read_number();
+    } else if (key == "samples_ns") {
+      reader.read_array([&] { result.samples_ns.push_back(reader.read_number()); });
+    } else {
+      reader.skip_value();
+    }
+  });
+
+  if (!has_name) {
+    throw benchmark_format_error{"Benchmark result does not have a name"};
+  }
+  return result;
+}
+
+/**
+ * \return The rank of each value among all values, where tied values receive the mean of their ranks. Also sets
+ * `tie_correction` to the sum of `t^3 - t` over each group of `t` tied values.
+ */
+std::vector<double> _ranks(const std::vector<double>& values, double& tie_correction) {
+  std::vector<std::size_t> order(values.size());
+  for (std::size_t i{0}; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(),
+            [&](const std::size_t l, const std::size_t r) { return values[l] < values[r]; });
+
+  std::vector<double> ranks(values.size());
+  tie_correction = 0.0;
+  for (std::size_t begin{0}; begin < order.size();) {
+    std::size_t end{begin + 1};
+    while (end < order.size() && !(values[order[begin]] < values[order[end]])) {
+      ++end;
+    }
+
+    // Ranks are 1-based, so the tied values at [begin, end) share the mean of the ranks [begin + 1, end].
+    const double rank{static_cast<double>(begin + end + 1) / 2.0};
+    for (std::size_t i{begin}; i < end; ++i) {
+      ranks[order[i]] = rank;
+    }
+
+    const auto ties{static_cast<double>(end - begin)};
+    tie_correction += ties * ties * ties - ties;
+    begin = end;
+  }
+  return ranks;
+}
+
+const char* _to_string(const benchmark_verdict verdict) noexcept {
+  switch (verdict) {
+    case benchmark_verdict::improved:
+      return "improved";
+    case benchmark_verdict::regressed:
+      return "REGRESSED";
+    case benchmark_verdict::unchanged:
+    default:
+      return "unchanged";
+  }
+}
+}  // namespace
+
+benchmark_format_error::benchmark_format_error(const char* what_arg) : runtime_error(what_arg) {}
+benchmark_format_error::benchmark_format_error(const std::string& what_arg) : runtime_error(what_arg) {}
+
+benchmark_format_error::benchmark_format_error(const benchmark_format_error&) = default;
+benchmark_format_error::benchmark_format_error(benchmark_format_error&&) noexcept = default;
+
+benchmark_format_error& benchmark_format_error::operator=(const benchmark_format_error&) = default;
+benchmark_format_error& benchmark_format_error::operator=(benchmark_format_error&&) noexcept = default;
+
+benchmark_format_error::~benchmark_format_error() = default;
+
+benchmark_context current_benchmark_context() {
+#if defined(NDEBUG)
+  const char* const build_type{"release"};
+#else
+  const char* const build_type{"debug"};
+#endif  // defined(NDEBUG)
+
+  return {_cpu_model(), std::thread::hardware_concurrency(), _compiler(), build_type,
+          internal::_benchmark_allocations()._tracked.load()};
+}
+
+void write_benchmark_json(std::ostream& os, const benchmark_context& context,
+                          const std::vector<benchmark_result>& results) {
+  const auto flags{os.flags()};
+  const auto precision{os.precision()};
+  os << std::defaultfloat << std::setprecision(std::numeric_limits<double>::max_digits10);
+
+  os << "{\n  \"context\": {\n    \"cpu_model\": ";
+  _write_json_string(os, context.cpu_model);
+  os << ",\n    \"cpu_count\": " << context.cpu_count << ",\n    \"compiler\": ";
+  _write_json_string(os, context.compiler);
+  os << ",\n    \"build_type\": ";
+  _write_json_string(os, context.build_type);
+  os << ",\n    \"allocations_tracked\": " << (context.allocations_tracked ? "true" : "false") << "\n  },\n";
+
+  os << "  \"benchmarks\": [";
+  for (std::size_t i{0}; i < results.size(); ++i) {
+    const auto& result{results[i]};
+
+    os << (i == 0 ? "\n" : ",\n") << "    {\n      \"name\": ";
+    _write_json_string(os, result.name);
+    os << ",\n      \"iterations\": " << result.iterations << ",\n      \"ns_per_op\": ";
+    _write_json_number(os, result.median_ns);
+    os << ",\n      \"mad_ns\": ";
+    _write_json_number(os, result.mad_ns);
+    os << ",\n      \"bytes_per_op\": ";
+    _write_json_number(os, result.bytes_per_op);
+    os << ",\n      \"allocations_per_op\": ";
+    _write_json_number(os, result.allocations_per_op);
+    os << ",\n      \"samples_ns\": [";
+    for (std::size_t j{0}; j < result.samples_ns.size(); ++j) {
+      os << (j == 0 ? "" : ", ");
+      _write_json_number(os, result.samples_ns[j]);
+    }
+    os << "]\n    }";
+  }
+  os << (results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+
+  os.flags(flags);
+  os.precision(precision);
+}
+
+bool write_benchmark_json_file(const std::string& path, const std::vector<benchmark_result>& results) {
+  std::ofstream ofs{path};
+  write_benchmark_json(ofs, current_benchmark_context(), results);
+  return static_cast<bool>(ofs);
+}
+
+benchmark_report read_benchmark_json(std::istream& is) {
+  std::ostringstream text{};
+  text << is.rdbuf();
+  _json_reader reader{text.str()};
+
+  benchmark_report report{{"", 0, "", "", false}, {}};
+  bool has_benchmarks{false};
+  reader.read_object([&](const std::string& key) {
+    if (key == "context") {
+      report.context = _read_context(reader);
+    } else if (key == "benchmarks") {
+      reader.read_array([&] { report.results.push_back(_read_result(reader)); });
+      has_benchmarks = true;
+    } else {
+      reader.skip_value();
+    }
+  });
+  reader.finish();
+
+  if (!has_benchmarks) {
+    throw benchmark_format_error{"Missing benchmarks array"};
+  }
+  return report;
+}
+
+double mann_whitney_u_test(const std::vector<double>& a, const std::vector<double>& b) {
+  if (a.empty() || b.empty()) {
+    return 1.0;
+  }
+
+  std::vector<double> values{a};
+  values.insert(values.end(), b.begin(), b.end());
+
+  double tie_correction{0.0};
+  const std::vector<double> ranks{_ranks(values, tie_correction)};
+
+  double rank_sum_a{0.0};
+  for (std::size_t i{0}; i < a.size(); ++i) {
+    rank_sum_a += ranks[i];
+  }
+
+  const auto n_a{static_cast<double>(a.size())};
+  const auto n_b{static_cast<double>(b.size())};
+  const double n{n_a + n_b};
+
+  const double u{rank_sum_a - n_a * (n_a + 1.0) / 2.0};
+  const double mean{n_a * n_b / 2.0};
+  const double variance{n_a * n_b / 12.0 * ((n + 1.0) - tie_correction / (n * (n - 1.0)))};
+  if (!(variance > 0.0)) {
+    // All values are tied.
+    return 1.0;
+  }
+
+  const double z{std::max(std::abs(u - mean) - 0.5, 0.0) / std::sqrt(variance)};
+  return std::min(std::erfc(z / std::sqrt(2.0)), 1.0);
+}
+
+std::vector<benchmark_comparison> compare_benchmarks(const benchmark_report& baseline,
+                                                     const benchmark_report& contender,
+                                                     const benchmark_compare_config& cfg) {
+  std::map<std::string, const benchmark_result*> contender_results{};
+  for (const auto& result : contender.results) {
+    contender_results.emplace(result.name, &result);
+  }
+
+  std::vector<benchmark_comparison> comparisons{};
+  for (const auto& base_result : baseline.results) {
+    const auto it{contender_results.find(base_result.name)};
+    if (it == contender_results.end()) {
+      continue;
+    }
+    const benchmark_result& contender_result{*it->second};
+
+    benchmark_comparison comparison{base_result.name,
+                                    base_result.median_ns,
+                                    contender_result.median_ns,
+                                    0.0,
+                                    mann_whitney_u_test(base_result.samples_ns, contender_result.samples_ns),
+                                    benchmark_verdict::unchanged};
+    if (base_result.median_ns > 0.0) {
+      comparison.change = (contender_result.median_ns - base_result.median_ns) / base_result.median_ns;
+    }
+
+    if (comparison.p_value < cfg.alpha) {
+      if (comparison.change > cfg.threshold) {
+        comparison.verdict = benchmark_verdict::regressed;
+      } else if (comparison.change < -cfg.threshold) {
+        comparison.verdict = benchmark_verdict::improved;
+      }
+    }
+
+    comparisons.push_back(std::move(comparison));
+  }
+  return comparisons;
+}
+
+void print_benchmark_comparisons(std::ostream& os, const std::vector<benchmark_comparison>& comparisons) {
+  std::size_t name_width{9};
+  for (const auto& comparison : comparisons) {
+    name_width = std::max(name_width, comparison.name.size());
+  }
+
+  const auto flags{os.flags()};
+  const auto precision{os.precision()};
+  os << std::fixed;
+
+  os << std::left << std::setw(static_cast<int>(name_width)) << "Benchmark" << std::right << std::setw(16)
+     << "Baseline (ns)" << std::setw(16) << "Contender (ns)" << std::setw(10) << "Change" << std::setw(10)
+     << "p-value" << "  " << "Verdict" << '\n';
+  for (const auto& comparison : comparisons) {
+    os << std::left << std::setw(static_cast<int>(name_width)) << comparison.name << std::right << std::setprecision(3)
+       << std::setw(16) << comparison.baseline_ns << std::setw(16) << comparison.contender_ns << std::setprecision(1)
+       << std::setw(9) << std::showpos << comparison.change * 100.0 << std::noshowpos << '%' << std::setprecision(4)
+       << std::setw(10) << comparison.p_value << "  " << _to_string(comparison.verdict) << '\n';
+  }
+
+  os.flags(flags);
+  os.precision(precision);
+}
+
+}  // namespace base
+}  // namespace derplib
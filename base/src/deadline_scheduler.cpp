@@ -0,0 +1,276 @@
+#include "derplib/base/deadline_scheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace derplib {
+inline namespace base {
+
+constexpr std::size_t deadline_scheduler::Arity;
+constexpr std::size_t deadline_scheduler::NoNode;
+
+bool deadline_scheduler::handle::cancel() {
+  return _scheduler_ != nullptr && _scheduler_->cancel(*this);
+}
+
+deadline_scheduler::deadline_scheduler() : deadline_scheduler(config{}) {}
+
+deadline_scheduler::deadline_scheduler(const config& cfg) :
+    _executor{cfg.executor}, _slack{cfg.slack}, _record_stats{cfg.record_stats} {
+  if (_slack < clock::duration::zero()) {
+    throw std::invalid_argument{"deadline_scheduler slack must not be negative"};
+  }
+
+  _thread_ = std::thread{&deadline_scheduler::_driver, this};
+}
+
+deadline_scheduler::~deadline_scheduler() {
+  {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    _keep_alive_ = false;
+  }
+  _cv_.notify_all();
+
+  _thread_.join();
+}
+
+deadline_scheduler::handle deadline_scheduler::schedule_at(const clock::time_point deadline,
+                                                           const clock::duration slack,
+                                                           callback_type callback) {
+  if (slack < clock::duration::zero()) {
+    throw std::invalid_argument{"deadline_scheduler slack must not be negative"};
+  }
+  const clock::time_point latest{deadline < clock::time_point::max() - slack ? deadline + slack
+                                                                             : clock::time_point::max()};
+
+  std::unique_lock<std::mutex> lk{_mutex_};
+
+  std::size_t index{_free_};
+  if (index != NoNode) {
+    _free_ = _nodes_[index]._next_free;
+  } else {
+    index = _nodes_.size();
+    _nodes_.push_back(_node{{}, 0, NoNode});
+  }
+
+  _node& node{_nodes_[index]};
+  node._callback = std::move(callback);
+
+  const std::uint64_t sequence{_sequence_++};
+  const _entry entry{deadline, latest, sequence, index, node._generation};
+  _deadline_heap_.push_back(entry);
+  _sift_up(_deadline_heap_, _deadline_heap_.size() - 1, &_is_due_before);
+  _latest_heap_.push_back(entry);
+  _sift_up(_latest_heap_, _latest_heap_.size() - 1, &_is_latest_before);
+  ++_size_;
+
+  const handle h{this, index, node._generation};
+  // The driver thread only needs to be woken if it is sleeping until a later time.
+  const bool is_head{_latest_heap_.front()._sequence == sequence};
+  lk.unlock();
+
+  if (is_head) {
+    _cv_.notify_one();
+  }
+  return h;
+}
+
+bool deadline_scheduler::cancel(const handle& h) {
+  if (h._scheduler_ != this) {
+    return false;
+  }
+
+  callback_type callback{};
+  {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    if (h._index_ >= _nodes_.size() || _nodes_[h._index_]._generation != h._generation_) {
+      return false;
+    }
+
+    // Destroy the callback outside of the lock, in case its destructor interacts with this scheduler.
+    callback = std::move(_nodes_[h._index_]._callback);
+    _release(h._index_);
+    --_size_;
+
+    _discard_tombstones(_deadline_heap_, &_is_due_before);
+    _discard_tombstones(_latest_heap_, &_is_latest_before);
+  }
+
+  return true;
+}
+
+std::size_t deadline_scheduler::pending() const {
+  std::lock_guard<std::mutex> lk{_mutex_};
+  return _size_;
+}
+
+deadline_scheduler::clock::time_point deadline_scheduler::next_deadline() const {
+  std::lock_guard<std::mutex> lk{_mutex_};
+  return _latest_heap_.empty() ? clock::time_point::max() : _latest_heap_.front()._latest;
+}
+
+void deadline_scheduler::_driver() {
+  std::vector<_expiry> expired{};
+
+  std::unique_lock<std::mutex> lk{_mutex_};
+  while (_keep_alive_) {
+    _pop_expired(clock::now(), expired);
+
+    if (!expired.empty()) {
+      lk.unlock();
+      for (auto& e : expired) {
+        const clock::time_point start{_record_stats ? clock::now() : clock::time_point{}};
+        if (_executor) {
+          _executor(std::move(e._callback));
+        } else {
+          e._callback();
+        }
+        if (_record_stats) {
+          _stats_._record(e._deadline, start, clock::now());
+        }
+      }
+      expired.clear();
+      lk.lock();
+      continue;
+    }
+
+    if (_latest_heap_.empty()) {
+      _cv_.wait(lk);
+    } else {
+      // Copy the time, as the heap may be reallocated while waiting.
+      const clock::time_point latest{_latest_heap_.front()._latest};
+      _cv_.wait_until(lk, latest);
+    }
+  }
+}
+
+void deadline_scheduler::_pop_expired(const clock::time_point now, std::vector<_expiry>& expired) {
+  // Tasks are taken in deadline order, so that each wakeup only visits the tasks it invokes. Their entries in
+  // `_latest_heap_` become tombstones, which are discarded like those of cancelled tasks.
+  while (!_deadline_heap_.empty()) {
+    const _entry& head{_deadline_heap_.front()};
+    if (_is_tombstone(head)) {
+      _pop_heap(_deadline_heap_, &_is_due_before);
+      continue;
+    }
+    if (head._deadline > now) {
+      break;
+    }
+
+    const std::size_t index{head._index};
+    expired.push_back(_expiry{std::move(_nodes_[index]._callback), head._deadline});
+    _release(index);
+    --_size_;
+    _pop_heap(_deadline_heap_, &_is_due_before);
+  }
+
+  _discard_tombstones(_deadline_heap_, &_is_due_before);
+  _discard_tombstones(_latest_heap_, &_is_latest_before);
+}
+
+bool deadline_scheduler::_is_due_before(const _entry& lhs, const _entry& rhs) {
+  if (lhs._deadline != rhs._deadline) {
+    return lhs._deadline < rhs._deadline;
+  }
+  return lhs._sequence < rhs._sequence;
+}
+
+bool deadline_scheduler::_is_latest_before(const _entry& lhs, const _entry& rhs) {
+  if (lhs._latest != rhs._latest) {
+    return lhs._latest < rhs._latest;
+  }
+  return lhs._sequence < rhs._sequence;
+}
+
+bool deadline_scheduler::_is_tombstone(const _entry& e) const {
+  return _nodes_[e._index]._generation != e._generation;
+}
+
+template<typename Before>
+void deadline_scheduler::_sift_up(std::vector<_entry>& heap, std::size_t pos, const Before is_before) {
+  _entry e{std::move(heap[pos])};
+
+  while (pos > 0) {
+    const std::size_t parent{(pos - 1) / Arity};
+    if (!is_before(e, heap[parent])) {
+      break;
+    }
+
+    heap[pos] = std::move(heap[parent]);
+    pos = parent;
+  }
+
+  heap[pos] = std::move(e);
+}
+
+template<typename Before>
+void deadline_scheduler::_sift_down(std::vector<_entry>& heap, std::size_t pos, const Before is_before) {
+  const std::size_t size{heap.size()};
+  _entry e{std::move(heap[pos])};
+
+  while (true) {
+    const std::size_t first_child{pos * Arity + 1};
+    if (first_child >= size) {
+      break;
+    }
+
+    std::size_t min_child{first_child};
+    const std::size_t last_child{std::min(first_child + Arity, size)};
+    for (std::size_t child{first_child + 1}; child < last_child; ++child) {
+      if (is_before(heap[child], heap[min_child])) {
+        min_child = child;
+      }
+    }
+
+    if (!is_before(heap[min_child], e)) {
+      break;
+    }
+
+    heap[pos] = std::move(heap[min_child]);
+    pos = min_child;
+  }
+
+  heap[pos] = std::move(e);
+}
+
+template<typename Before>
+void deadline_scheduler::_pop_heap(std::vector<_entry>& heap, const Before is_before) {
+  heap.front() = std::move(heap.back());
+  heap.pop_back();
+
+  if (!heap.empty()) {
+    _sift_down(heap, 0, is_before);
+  }
+}
+
+template<typename Before>
+void deadline_scheduler::_discard_tombstones(std::vector<_entry>& heap, const Before is_before) {
+  while (!heap.empty() && _is_tombstone(heap.front())) {
+    _pop_heap(heap, is_before);
+  }
+  if (heap.size() - _size_ <= _size_) {
+    return;
+  }
+
+  heap.erase(std::remove_if(heap.begin(), heap.end(), [this](const _entry& e) { return _is_tombstone(e); }),
+             heap.end());
+  if (heap.size() < 2) {
+    return;
+  }
+  for (std::size_t pos{(heap.size() - 2) / Arity + 1}; pos > 0; --pos) {
+    _sift_down(heap, pos - 1, is_before);
+  }
+}
+
+void deadline_scheduler::_release(const std::size_t index) {
+  _node& node{_nodes_[index]};
+
+  node._callback = nullptr;
+  ++node._generation;
+  node._next_free = _free_;
+  _free_ = index;
+}
+
+}  // namespace base
+}  // namespace derplib
@@ -0,0 +1,196 @@
+#include "derplib/base/hdr_histogram.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace derplib {
+namespace internal {
+namespace {
+constexpr unsigned MaxSignificantDigits = 5;
+
+void _validate(const std::uint64_t highest_trackable_value, const unsigned significant_digits) {
+  if (highest_trackable_value < 2) {
+    throw std::invalid_argument("Highest trackable value must be at least 2");
+  }
+  if (significant_digits > MaxSignificantDigits) {
+    throw std::invalid_argument("Number of significant digits must be at most 5");
+  }
+}
+
+/**
+ * \return Base-2 logarithm of half the number of sub-buckets required to maintain `significant_digits` digits.
+ */
+unsigned _half_count_magnitude_of(const std::uint64_t highest_trackable_value, const unsigned significant_digits) {
+  _validate(highest_trackable_value, significant_digits);
+
+  // A value of 2 * 10^digits must be representable within a single bucket.
+  std::uint64_t largest_single_unit_resolution{2};
+  for (unsigned i{0}; i < significant_digits; ++i) {
+    largest_single_unit_resolution *= 10;
+  }
+
+  unsigned magnitude{0};
+  while ((std::uint64_t{1} << magnitude) < largest_single_unit_resolution) {
+    ++magnitude;
+  }
+  return magnitude > 1 ? magnitude - 1 : 0;
+}
+
+/**
+ * \return Number of sub-buckets required to track values up to `highest_trackable_value`.
+ */
+std::size_t _counts_length_of(const std::uint64_t highest_trackable_value,
+                              const unsigned sub_bucket_half_count_magnitude) {
+  const std::uint64_t sub_bucket_count{std::uint64_t{1} << (sub_bucket_half_count_magnitude + 1)};
+
+  std::uint64_t smallest_untrackable_value{sub_bucket_count};
+  std::size_t buckets{1};
+  while (smallest_untrackable_value <= highest_trackable_value) {
+    if (smallest_untrackable_value > std::numeric_limits<std::uint64_t>::max() / 2) {
+      ++buckets;
+      break;
+    }
+    smallest_untrackable_value <<= 1;
+    ++buckets;
+  }
+
+  return (buckets + 1) * (sub_bucket_count / 2);
+}
+}  // namespace
+
+_hdr_histogram_layout::_hdr_histogram_layout(const std::uint64_t highest_trackable_value,
+                                             const unsigned significant_digits) :
+    _highest_trackable_value{highest_trackable_value},
+    _significant_digits{significant_digits},
+    _sub_bucket_half_count_magnitude{_half_count_magnitude_of(highest_trackable_value, significant_digits)},
+    _sub_bucket_half_count{std::size_t{1} << _sub_bucket_half_count_magnitude},
+    _sub_bucket_mask{(std::uint64_t{1} << (_sub_bucket_half_count_magnitude + 1)) - 1},
+    _counts_length{_counts_length_of(highest_trackable_value, _sub_bucket_half_count_magnitude)} {}
+
+std::uint64_t _hdr_histogram_layout::_lowest_equivalent_value(const std::size_t index) const noexcept {
+  std::size_t bucket{index >> _sub_bucket_half_count_magnitude};
+  std::uint64_t sub_bucket{(index & (_sub_bucket_half_count - 1)) + _sub_bucket_half_count};
+  if (bucket == 0) {
+    sub_bucket -= _sub_bucket_half_count;
+  } else {
+    --bucket;
+  }
+  return sub_bucket << bucket;
+}
+
+std::uint64_t _hdr_histogram_layout::_highest_equivalent_value(const std::size_t index) const noexcept {
+  const std::size_t bucket{index >> _sub_bucket_half_count_magnitude};
+  const std::uint64_t width{std::uint64_t{1} << (bucket == 0 ? 0 : bucket - 1)};
+  return _lowest_equivalent_value(index) + width - 1;
+}
+
+std::uint64_t _hdr_histogram_layout::_median_equivalent_value(const std::size_t index) const noexcept {
+  const std::size_t bucket{index >> _sub_bucket_half_count_magnitude};
+  const std::uint64_t width{std::uint64_t{1} << (bucket == 0 ? 0 : bucket - 1)};
+  return _lowest_equivalent_value(index) + width / 2;
+}
+}  // namespace internal
+
+inline namespace base {
+
+hdr_histogram::hdr_histogram() : hdr_histogram(config{}) {}
+
+hdr_histogram::hdr_histogram(const config& cfg) :
+    _config{cfg},
+    _layout{cfg.highest_trackable_value, cfg.significant_digits},
+    _counts_(_layout._counts_length, 0) {}
+
+void hdr_histogram::merge(const hdr_histogram& other) {
+  if (!_layout._same_as(other._layout)) {
+    throw std::invalid_argument("Histograms must have the same configuration to be merged");
+  }
+
+  for (std::size_t i{0}; i < _counts_.size(); ++i) {
+    _counts_[i] += other._counts_[i];
+  }
+  _total_count_ += other._total_count_;
+}
+
+void hdr_histogram::reset() noexcept {
+  std::fill(_counts_.begin(), _counts_.end(), 0);
+  _total_count_ = 0;
+}
+
+std::uint64_t hdr_histogram::min() const noexcept {
+  const auto it{std::find_if(_counts_.begin(), _counts_.end(), [](const std::uint64_t c) { return c != 0; })};
+  if (it == _counts_.end()) {
+    return 0;
+  }
+  return _layout._lowest_equivalent_value(static_cast<std::size_t>(it - _counts_.begin()));
+}
+
+std::uint64_t hdr_histogram::max() const noexcept {
+  const auto it{std::find_if(_counts_.rbegin(), _counts_.rend(), [](const std::uint64_t c) { return c != 0; })};
+  if (it == _counts_.rend()) {
+    return 0;
+  }
+  return _layout._highest_equivalent_value(static_cast<std::size_t>(_counts_.rend() - it) - 1);
+}
+
+double hdr_histogram::mean() const noexcept {
+  if (_total_count_ == 0) {
+    return 0.0;
+  }
+
+  double total{0.0};
+  for (std::size_t i{0}; i < _counts_.size(); ++i) {
+    if (_counts_[i] != 0) {
+      total += static_cast<double>(_counts_[i]) * static_cast<double>(_layout._median_equivalent_value(i));
+    }
+  }
+  return total / static_cast<double>(_total_count_);
+}
+
+std::uint64_t hdr_histogram::value_at_percentile(const double percentile) const noexcept {
+  if (_total_count_ == 0) {
+    return 0;
+  }
+
+  // Round to the nearest count, so that e.g. the 99.9th percentile of 1000 values is the 999th value despite rounding
+  // errors in the multiplication.
+  const double clamped{std::min(std::max(percentile, 0.0), 100.0)};
+  const auto target{std::max(
+      static_cast<std::uint64_t>(clamped / 100.0 * static_cast<double>(_total_count_) + 0.5), std::uint64_t{1})};
+
+  std::uint64_t seen{0};
+  for (std::size_t i{0}; i < _counts_.size(); ++i) {
+    seen += _counts_[i];
+    if (seen >= target) {
+      return _layout._highest_equivalent_value(i);
+    }
+  }
+  return max();
+}
+
+concurrent_hdr_histogram::concurrent_hdr_histogram() : concurrent_hdr_histogram(hdr_histogram::config{}) {}
+
+concurrent_hdr_histogram::concurrent_hdr_histogram(const hdr_histogram::config& cfg) :
+    _config{cfg},
+    _layout{cfg.highest_trackable_value, cfg.significant_digits},
+    _counts_{new std::atomic<std::uint64_t>[_layout._counts_length]} {
+  reset();
+}
+
+void concurrent_hdr_histogram::reset() noexcept {
+  for (std::size_t i{0}; i < _layout._counts_length; ++i) {
+    _counts_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+hdr_histogram concurrent_hdr_histogram::snapshot() const {
+  hdr_histogram snapshot{_config};
+  for (std::size_t i{0}; i < _layout._counts_length; ++i) {
+    snapshot._counts_[i] = _counts_[i].load(std::memory_order_relaxed);
+    snapshot._total_count_ += snapshot._counts_[i];
+  }
+  return snapshot;
+}
+
+}  // namespace base
+}  // namespace derplib
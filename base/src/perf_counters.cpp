@@ -0,0 +1,226 @@
+#include "derplib/base/perf_counters.h"
+
+#include <utility>
+
+#if defined(__linux__)
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif  // defined(__linux__)
+
+namespace derplib {
+inline namespace base {
+namespace {
+constexpr std::size_t HardwareGroup = 0;
+constexpr std::size_t SoftwareGroup = 1;
+
+std::size_t _index_of(const perf_event event) noexcept {
+  return static_cast<std::size_t>(event);
+}
+
+/**
+ * \return Index of the group which `event` is opened in.
+ */
+std::size_t _group_of(const std::size_t event) noexcept {
+  return event < _index_of(perf_event::task_clock) ? HardwareGroup : SoftwareGroup;
+}
+
+#if defined(__linux__)
+/**
+ * \return The `perf_event_attr::type` and `perf_event_attr::config` of an event.
+ */
+std::pair<std::uint32_t, std::uint64_t> _attr_of(const perf_event event) noexcept {
+  switch (event) {
+    case perf_event::cycles:
+      return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES};
+    case perf_event::instructions:
+      return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS};
+    case perf_event::cache_misses:
+      return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES};
+    case perf_event::branch_misses:
+      return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES};
+    case perf_event::task_clock:
+      return {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK};
+    case perf_event::page_faults:
+      return {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS};
+    case perf_event::context_switches:
+    default:
+      return {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES};
+  }
+}
+
+/**
+ * \return File descriptor of the opened event, or `-1` if the event cannot be opened.
+ */
+int _open_event(const perf_event event, const int group_fd) noexcept {
+  const auto attr_of_event{_attr_of(event)};
+
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = attr_of_event.first;
+  attr.config = attr_of_event.second;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // Only the leader is disabled, so that the whole group is started and stopped by the leader.
+  attr.disabled = group_fd == -1 ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+#endif  // defined(__linux__)
+}  // namespace
+
+constexpr std::size_t perf_counters::EventCount;
+constexpr std::size_t perf_counters::GroupCount;
+
+perf_counters::perf_counters() : _fds_{}, _slots_{}, _leaders_{}, _counts_{} {
+  _fds_.fill(-1);
+  _leaders_.fill(-1);
+
+  _open_group(HardwareGroup, perf_event::cycles, perf_event::task_clock);
+  _open_group(SoftwareGroup, perf_event::task_clock, static_cast<perf_event>(EventCount));
+}
+
+perf_counters::~perf_counters() {
+#if defined(__linux__)
+  // Members are closed before the leader of their group.
+  for (std::size_t i{EventCount}; i > 0; --i) {
+    if (_fds_[i - 1] != -1) {
+      close(_fds_[i - 1]);
+    }
+  }
+#endif  // defined(__linux__)
+}
+
+void perf_counters::start() {
+  _counts_.fill(0);
+  _multiplexed_ = false;
+
+  // The stopwatch brackets the counters, so that the elapsed time covers the whole counted region.
+  _stopwatch_.start();
+
+#if defined(__linux__)
+  for (const int leader : _leaders_) {
+    if (leader != -1) {
+      ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    }
+  }
+  for (const int leader : _leaders_) {
+    if (leader != -1) {
+      ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+#endif  // defined(__linux__)
+}
+
+void perf_counters::stop() {
+#if defined(__linux__)
+  for (const int leader : _leaders_) {
+    if (leader != -1) {
+      ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+  }
+#endif  // defined(__linux__)
+
+  _stopwatch_.stop();
+
+  for (std::size_t group{0}; group < GroupCount; ++group) {
+    _read_group(group);
+  }
+}
+
+perf_sample perf_counters::sample() const noexcept {
+  perf_sample sample{};
+  sample.elapsed = _stopwatch_.duration();
+  sample.cycles = _counts_[_index_of(perf_event::cycles)];
+  sample.instructions = _counts_[_index_of(perf_event::instructions)];
+  sample.cache_misses = _counts_[_index_of(perf_event::cache_misses)];
+  sample.branch_misses = _counts_[_index_of(perf_event::branch_misses)];
+  sample.task_clock = _counts_[_index_of(perf_event::task_clock)];
+  sample.page_faults = _counts_[_index_of(perf_event::page_faults)];
+  sample.context_switches = _counts_[_index_of(perf_event::context_switches)];
+  sample.multiplexed = _multiplexed_;
+  return sample;
+}
+
+perf_counter_mode perf_counters::mode() const noexcept {
+  if (_leaders_[HardwareGroup] != -1) {
+    return perf_counter_mode::hardware;
+  }
+  if (_leaders_[SoftwareGroup] != -1) {
+    return perf_counter_mode::software;
+  }
+  return perf_counter_mode::timing_only;
+}
+
+bool perf_counters::available(const perf_event event) const noexcept {
+  return _fds_[_index_of(event)] != -1;
+}
+
+void perf_counters::_open_group(const std::size_t group, const perf_event begin, const perf_event end) noexcept {
+#if defined(__linux__)
+  std::size_t slot{0};
+  for (std::size_t i{_index_of(begin)}; i < _index_of(end); ++i) {
+    // The first event which can be opened becomes the leader of the group.
+    const int fd{_open_event(static_cast<perf_event>(i), _leaders_[group])};
+    if (fd == -1) {
+      continue;
+    }
+
+    if (_leaders_[group] == -1) {
+      _leaders_[group] = fd;
+    }
+    _fds_[i] = fd;
+    _slots_[i] = slot++;
+  }
+#else
+  static_cast<void>(group);
+  static_cast<void>(begin);
+  static_cast<void>(end);
+#endif  // defined(__linux__)
+}
+
+void perf_counters::_read_group(const std::size_t group) noexcept {
+#if defined(__linux__)
+  const int leader{_leaders_[group]};
+  if (leader == -1) {
+    return;
+  }
+
+  // The values are preceded by the number of events, the time enabled, and the time running.
+  std::array<std::uint64_t, 3 + EventCount> values{};
+  const ssize_t size{read(leader, values.data(), sizeof(values))};
+  if (size < static_cast<ssize_t>(3 * sizeof(std::uint64_t))) {
+    return;
+  }
+
+  const std::uint64_t enabled{values[1]};
+  const std::uint64_t running{values[2]};
+  if (running == 0) {
+    return;
+  }
+
+  const bool multiplexed{running < enabled};
+  _multiplexed_ = _multiplexed_ || multiplexed;
+
+  for (std::size_t i{0}; i < EventCount; ++i) {
+    if (_fds_[i] == -1 || _group_of(i) != group || _slots_[i] >= values[0]) {
+      continue;
+    }
+
+    const std::uint64_t value{values[3 + _slots_[i]]};
+    _counts_[i] = multiplexed ? static_cast<std::uint64_t>(static_cast<double>(value) * static_cast<double>(enabled) /
+                                                           static_cast<double>(running))
+                              : value;
+  }
+#else
+  static_cast<void>(group);
+#endif  // defined(__linux__)
+}
+
+}  // namespace base
+}  // namespace derplib
@@ -0,0 +1,281 @@
+#include "derplib/base/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+
+namespace derplib {
+namespace internal {
+/**
+ * \brief A zone in the call tree of a thread.
+ *
+ * The links between nodes are only modified by the owning thread while holding `_profile_thread_data::_mutex`. The
+ * timings are only modified by the owning thread, but may be read and reset concurrently.
+ */
+struct _profile_node {
+  static constexpr std::size_t NoNode = std::numeric_limits<std::size_t>::max();
+
+  _profile_node(const char* name, const std::size_t parent) noexcept : _name{name}, _parent{parent} {}
+
+  const char* const _name;
+  const std::size_t _parent;
+  std::size_t _first_child = NoNode;
+  std::size_t _next_sibling = NoNode;
+
+  std::atomic<std::uint64_t> _count{0};
+  std::atomic<std::uint64_t> _total_ns{0};
+  std::atomic<std::uint64_t> _min_ns{std::numeric_limits<std::uint64_t>::max()};
+  std::atomic<std::uint64_t> _max_ns{0};
+};
+
+constexpr std::size_t _profile_node::NoNode;
+
+/**
+ * \brief The call tree of a thread.
+ */
+struct _profile_thread_data {
+  _profile_thread_data() { _nodes.emplace_back("", _profile_node::NoNode); }
+
+  /**
+   * \brief Guards the structure of `_nodes`.
+   */
+  std::mutex _mutex;
+  /**
+   * \brief Nodes of the call tree, with the root at index `0`. A deque is used so that nodes are never moved.
+   */
+  std::deque<_profile_node> _nodes;
+  /**
+   * \brief Index of the innermost active zone. Only accessed by the owning thread.
+   */
+  std::size_t _current = 0;
+  /**
+   * \brief Whether the owning thread has exited, after which the call tree is discarded by the next
+   * `profiler::reset()`.
+   */
+  std::atomic<bool> _exited{false};
+};
+}  // namespace internal
+
+inline namespace base {
+namespace {
+using internal::_profile_node;
+using internal::_profile_thread_data;
+
+/**
+ * \brief The call trees of all threads which have entered a zone.
+ */
+struct _profile_registry {
+  std::mutex _mutex;
+  std::vector<std::shared_ptr<_profile_thread_data>> _threads;
+};
+
+_profile_registry& _registry() {
+  static _profile_registry registry{};
+  return registry;
+}
+
+std::shared_ptr<_profile_thread_data> _register_thread() {
+  auto data{std::make_shared<_profile_thread_data>()};
+
+  _profile_registry& registry{_registry()};
+  std::lock_guard<std::mutex> lk{registry._mutex};
+  registry._threads.push_back(data);
+  return data;
+}
+
+/**
+ * \brief Registers the call tree of the calling thread, and marks it as exited when the thread exits.
+ */
+struct _profile_thread_handle {
+  _profile_thread_handle() : _data{_register_thread()} {}
+  _profile_thread_handle(const _profile_thread_handle&) = delete;
+  _profile_thread_handle& operator=(const _profile_thread_handle&) = delete;
+  ~_profile_thread_handle() { _data->_exited.store(true, std::memory_order_release); }
+
+  const std::shared_ptr<_profile_thread_data> _data;
+};
+
+_profile_thread_data& _this_thread() {
+  // The registry shares ownership of the data, so that timings of exited threads are retained until the next reset.
+  thread_local const _profile_thread_handle handle{};
+  return *handle._data;
+}
+
+std::vector<std::shared_ptr<_profile_thread_data>> _registered_threads() {
+  _profile_registry& registry{_registry()};
+  std::lock_guard<std::mutex> lk{registry._mutex};
+  return registry._threads;
+}
+
+/**
+ * \return Index of the child of `parent` named `name`, creating it if it does not exist. Must be called by the owning
+ * thread.
+ */
+std::size_t _find_or_add_child(_profile_thread_data& thread, const std::size_t parent, const char* name) {
+  std::size_t child{thread._nodes[parent]._first_child};
+  while (child != _profile_node::NoNode) {
+    const char* child_name{thread._nodes[child]._name};
+    if (child_name == name || std::strcmp(child_name, name) == 0) {
+      return child;
+    }
+    child = thread._nodes[child]._next_sibling;
+  }
+
+  std::lock_guard<std::mutex> lk{thread._mutex};
+  child = thread._nodes.size();
+  thread._nodes.emplace_back(name, parent);
+  thread._nodes[child]._next_sibling = thread._nodes[parent]._first_child;
+  thread._nodes[parent]._first_child = child;
+  return child;
+}
+
+std::chrono::nanoseconds _load_ns(const std::atomic<std::uint64_t>& ns) {
+  return std::chrono::nanoseconds{static_cast<std::int64_t>(ns.load(std::memory_order_relaxed))};
+}
+
+/**
+ * \brief Merges the timings of the children of a node of a thread into the children of `out`. Must be called while
+ * holding the mutex of `thread`.
+ */
+void _merge_children(profile_node& out, const _profile_thread_data& thread, const std::size_t index) {
+  for (std::size_t child{thread._nodes[index]._first_child}; child != _profile_node::NoNode;
+       child = thread._nodes[child]._next_sibling) {
+    const _profile_node& node{thread._nodes[child]};
+    const std::uint64_t count{node._count.load(std::memory_order_relaxed)};
+
+    auto it{std::find_if(out.children.begin(), out.children.end(),
+                         [&](const profile_node& n) { return n.name == node._name; })};
+    if (it == out.children.end()) {
+      out.children.push_back(profile_node{node._name, 0, {}, {}, std::chrono::nanoseconds::max(), {}, {}});
+      it = std::prev(out.children.end());
+    }
+
+    if (count != 0) {
+      it->count += count;
+      it->total_time += _load_ns(node._total_ns);
+      it->min_time = std::min(it->min_time, _load_ns(node._min_ns));
+      it->max_time = std::max(it->max_time, _load_ns(node._max_ns));
+    }
+
+    _merge_children(*it, thread, child);
+  }
+}
+
+/**
+ * \brief Computes the self time and normalizes the minimum time of a merged node and its descendants, and sorts the
+ * children by descending total time.
+ */
+void _finalize(profile_node& node) {
+  std::chrono::nanoseconds children_time{0};
+  for (auto& child : node.children) {
+    _finalize(child);
+    children_time += child.total_time;
+  }
+
+  node.self_time = std::max(node.total_time - children_time, std::chrono::nanoseconds{0});
+  if (node.count == 0) {
+    node.min_time = std::chrono::nanoseconds{0};
+  }
+
+  std::sort(node.children.begin(), node.children.end(),
+            [](const profile_node& lhs, const profile_node& rhs) { return lhs.total_time > rhs.total_time; });
+}
+
+void _print(std::ostream& os, const profile_node& node, const std::size_t depth) {
+  const auto us = [](const std::chrono::nanoseconds ns) { return static_cast<double>(ns.count()) / 1000.0; };
+
+  os << std::string(depth * 2, ' ') << node.name << ": count=" << node.count << " total=" << us(node.total_time)
+     << "us self=" << us(node.self_time) << "us min=" << us(node.min_time) << "us max=" << us(node.max_time) << "us\n";
+
+  for (const auto& child : node.children) {
+    _print(os, child, depth + 1);
+  }
+}
+}  // namespace
+
+profile_node profiler::collect() {
+  profile_node root{"", 0, {}, {}, {}, {}, {}};
+
+  for (const auto& thread : _registered_threads()) {
+    std::lock_guard<std::mutex> lk{thread->_mutex};
+    _merge_children(root, *thread, 0);
+  }
+
+  for (const auto& child : root.children) {
+    root.total_time += child.total_time;
+  }
+  _finalize(root);
+  root.self_time = std::chrono::nanoseconds{0};
+
+  return root;
+}
+
+void profiler::reset() {
+  {
+    // Exited threads will never record again, so their call trees can be released instead of only being cleared.
+    _profile_registry& registry{_registry()};
+    std::lock_guard<std::mutex> lk{registry._mutex};
+    registry._threads.erase(std::remove_if(registry._threads.begin(), registry._threads.end(),
+                                           [](const std::shared_ptr<_profile_thread_data>& thread) {
+                                             return thread->_exited.load(std::memory_order_acquire);
+                                           }),
+                            registry._threads.end());
+  }
+
+  for (const auto& thread : _registered_threads()) {
+    std::lock_guard<std::mutex> lk{thread->_mutex};
+    for (auto& node : thread->_nodes) {
+      node._count.store(0, std::memory_order_relaxed);
+      node._total_ns.store(0, std::memory_order_relaxed);
+      node._min_ns.store(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+      node._max_ns.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+void profiler::print(std::ostream& os, const profile_node& root) {
+  const auto flags{os.flags()};
+  const auto precision{os.precision()};
+  os << std::fixed << std::setprecision(3);
+
+  for (const auto& child : root.children) {
+    _print(os, child, 0);
+  }
+
+  os.flags(flags);
+  os.precision(precision);
+}
+
+profile_zone::profile_zone(const char* name) :
+    _thread{_this_thread()}, _node{_find_or_add_child(_thread, _thread._current, name)} {
+  _thread._current = _node;
+  _stopwatch_.start();
+}
+
+profile_zone::~profile_zone() {
+  _stopwatch_.stop();
+  const auto ns{static_cast<std::uint64_t>(_stopwatch_.count())};
+
+  _profile_node& node{_thread._nodes[_node]};
+  node._count.fetch_add(1, std::memory_order_relaxed);
+  node._total_ns.fetch_add(ns, std::memory_order_relaxed);
+  // Only the owning thread records into the node, so the minimum and maximum do not need to be updated atomically.
+  if (ns < node._min_ns.load(std::memory_order_relaxed)) {
+    node._min_ns.store(ns, std::memory_order_relaxed);
+  }
+  if (ns > node._max_ns.load(std::memory_order_relaxed)) {
+    node._max_ns.store(ns, std::memory_order_relaxed);
+  }
+
+  _thread._current = node._parent;
+}
+
+}  // namespace base
+}  // namespace derplib
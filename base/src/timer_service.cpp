@@ -0,0 +1,256 @@
+#include "derplib/base/timer_service.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace derplib {
+inline namespace base {
+
+constexpr unsigned timer_service::SlotBits;
+constexpr std::size_t timer_service::SlotsPerLevel;
+constexpr std::size_t timer_service::Levels;
+constexpr std::size_t timer_service::NoNode;
+
+bool timer_service::handle::cancel() {
+  return _service_ != nullptr && _service_->cancel(*this);
+}
+
+timer_service::timer_service() : timer_service(config{}) {}
+
+timer_service::timer_service(const config& cfg) :
+    _resolution{cfg.resolution}, _executor{cfg.executor}, _record_stats{cfg.record_stats}, _epoch{clock::now()} {
+  if (_resolution.count() <= 0) {
+    throw std::invalid_argument{"timer_service resolution must be positive"};
+  }
+
+  _slots_.fill(NoNode);
+  _thread_ = std::thread{&timer_service::_driver, this};
+}
+
+timer_service::~timer_service() {
+  {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    _keep_alive_ = false;
+  }
+  _cv_.notify_all();
+
+  _thread_.join();
+}
+
+timer_service::handle timer_service::schedule_at(const clock::time_point deadline, callback_type callback) {
+  std::unique_lock<std::mutex> lk{_mutex_};
+
+  std::size_t index{_free_};
+  if (index != NoNode) {
+    _free_ = _nodes_[index]._next;
+  } else {
+    index = _nodes_.size();
+    _nodes_.push_back(_node{{}, 0, 0, NoNode, NoNode, NoNode});
+  }
+
+  _node& node{_nodes_[index]};
+  node._callback = std::move(callback);
+  node._due = std::max(_to_tick(deadline), _current_tick_ + 1);
+  _insert(index);
+  ++_size_;
+
+  const handle h{this, index, node._generation};
+  const bool is_earlier{node._due < _wake_tick_};
+  lk.unlock();
+
+  if (is_earlier) {
+    _cv_.notify_one();
+  }
+  return h;
+}
+
+bool timer_service::cancel(const handle& h) {
+  if (h._service_ != this) {
+    return false;
+  }
+
+  callback_type callback{};
+  {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    if (h._index_ >= _nodes_.size()) {
+      return false;
+    }
+
+    _node& node{_nodes_[h._index_]};
+    if (node._generation != h._generation_ || node._slot == NoNode) {
+      return false;
+    }
+
+    // Destroy the callback outside of the lock, in case its destructor interacts with this service.
+    callback = std::move(node._callback);
+    _unlink(h._index_);
+    _release(h._index_);
+    --_size_;
+  }
+
+  return true;
+}
+
+std::size_t timer_service::pending() const {
+  std::lock_guard<std::mutex> lk{_mutex_};
+  return _size_;
+}
+
+void timer_service::_driver() {
+  std::vector<_expiry> expired{};
+
+  std::unique_lock<std::mutex> lk{_mutex_};
+  while (_keep_alive_) {
+    const auto elapsed{std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - _epoch)};
+    _advance(static_cast<std::uint64_t>(elapsed / _resolution), expired);
+
+    if (!expired.empty()) {
+      lk.unlock();
+      for (auto& e : expired) {
+        const clock::time_point start{_record_stats ? clock::now() : clock::time_point{}};
+        if (_executor) {
+          _executor(std::move(e._callback));
+        } else {
+          e._callback();
+        }
+        if (_record_stats) {
+          _stats_._record(e._deadline, start, clock::now());
+        }
+      }
+      expired.clear();
+      lk.lock();
+      continue;
+    }
+
+    _wake_tick_ = _next_event_tick();
+    if (_wake_tick_ == std::numeric_limits<std::uint64_t>::max()) {
+      _cv_.wait(lk);
+    } else {
+      _cv_.wait_until(lk, _to_time_point(_wake_tick_));
+    }
+    _wake_tick_ = 0;
+  }
+}
+
+void timer_service::_advance(const std::uint64_t tick, std::vector<_expiry>& expired) {
+  constexpr std::uint64_t slot_mask{SlotsPerLevel - 1};
+
+  while (_current_tick_ < tick) {
+    if (_size_ == 0) {
+      _current_tick_ = tick;
+      return;
+    }
+
+    const std::uint64_t t{++_current_tick_};
+
+    // Move the timers of each higher level whose lower levels have completed a rotation down the wheel, starting from
+    // the highest level so that the timers can cascade through multiple levels.
+    std::size_t level{0};
+    while (level + 1 < Levels && (t & ((std::uint64_t{1} << (SlotBits * (level + 1))) - 1)) == 0) {
+      ++level;
+    }
+    for (; level > 0; --level) {
+      std::size_t& head{_slots_[level * SlotsPerLevel + ((t >> (SlotBits * level)) & slot_mask)]};
+      std::size_t index{head};
+      head = NoNode;
+
+      while (index != NoNode) {
+        const std::size_t next{_nodes_[index]._next};
+        _insert(index);
+        index = next;
+      }
+    }
+
+    std::size_t& head{_slots_[t & slot_mask]};
+    std::size_t index{head};
+    head = NoNode;
+
+    while (index != NoNode) {
+      const std::size_t next{_nodes_[index]._next};
+      expired.push_back(_expiry{std::move(_nodes_[index]._callback), _to_time_point(_nodes_[index]._due)});
+      _release(index);
+      --_size_;
+      index = next;
+    }
+  }
+}
+
+std::uint64_t timer_service::_next_event_tick() const {
+  if (_size_ == 0) {
+    return std::numeric_limits<std::uint64_t>::max();
+  }
+
+  // Either a timer in the first level expires, or the first level completes its rotation and the higher levels need to
+  // be cascaded.
+  std::uint64_t t{_current_tick_ + 1};
+  while (_slots_[t % SlotsPerLevel] == NoNode && t % SlotsPerLevel != 0) {
+    ++t;
+  }
+  return t;
+}
+
+void timer_service::_insert(const std::size_t index) {
+  constexpr std::uint64_t max_delta{(std::uint64_t{1} << (SlotBits * Levels)) - 1};
+
+  _node& node{_nodes_[index]};
+  const std::uint64_t delta{node._due > _current_tick_ ? node._due - _current_tick_ : 0};
+
+  std::size_t level{0};
+  while (level + 1 < Levels && delta >= (std::uint64_t{1} << (SlotBits * (level + 1)))) {
+    ++level;
+  }
+
+  // Timers beyond the range of the wheel are parked in the last level, and re-inserted when their slot is cascaded.
+  const std::uint64_t due{delta > max_delta ? _current_tick_ + max_delta : node._due};
+  const std::size_t slot{level * SlotsPerLevel + ((due >> (SlotBits * level)) % SlotsPerLevel)};
+
+  node._slot = slot;
+  node._prev = NoNode;
+  node._next = _slots_[slot];
+  if (node._next != NoNode) {
+    _nodes_[node._next]._prev = index;
+  }
+  _slots_[slot] = index;
+}
+
+void timer_service::_unlink(const std::size_t index) {
+  _node& node{_nodes_[index]};
+
+  if (node._prev != NoNode) {
+    _nodes_[node._prev]._next = node._next;
+  } else {
+    _slots_[node._slot] = node._next;
+  }
+  if (node._next != NoNode) {
+    _nodes_[node._next]._prev = node._prev;
+  }
+}
+
+void timer_service::_release(const std::size_t index) {
+  _node& node{_nodes_[index]};
+
+  node._callback = nullptr;
+  node._slot = NoNode;
+  ++node._generation;
+  node._prev = NoNode;
+  node._next = _free_;
+  _free_ = index;
+}
+
+std::uint64_t timer_service::_to_tick(const clock::time_point time_point) const {
+  const auto ns{std::chrono::duration_cast<std::chrono::nanoseconds>(time_point - _epoch).count()};
+  if (ns <= 0) {
+    return 0;
+  }
+
+  const auto resolution{static_cast<std::uint64_t>(_resolution.count())};
+  return (static_cast<std::uint64_t>(ns) + resolution - 1) / resolution;
+}
+
+timer_service::clock::time_point timer_service::_to_time_point(const std::uint64_t tick) const {
+  return _epoch + std::chrono::duration_cast<clock::duration>(_resolution * tick);
+}
+
+}  // namespace base
+}  // namespace derplib
@@ -0,0 +1,266 @@
+#include "derplib/base/trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+#include "derplib/internal/json_string.h"
+
+namespace derplib {
+inline namespace base {
+namespace {
+using internal::_write_json_string;
+
+/**
+ * \brief Phase of a trace event, as defined by the trace-event format.
+ */
+enum struct _trace_phase : char { complete = 'X', instant = 'i' };
+
+struct _trace_event {
+  const char* _name;
+  std::int64_t _begin_ns;
+  std::int64_t _duration_ns;
+  _trace_phase _phase;
+};
+
+/**
+ * \brief The events recorded by a thread.
+ *
+ * Events are only written by the owning thread. A slot is published by a release store to `_size`, after which it is
+ * never modified until the buffer is discarded, so readers may access published events while the owning thread keeps
+ * recording.
+ */
+struct _trace_thread_data {
+  _trace_thread_data(const std::size_t id, const std::size_t capacity, const std::uint64_t generation) :
+      _id{id}, _capacity{capacity}, _events{new _trace_event[capacity]}, _generation{generation} {}
+
+  const std::size_t _id;
+  const std::size_t _capacity;
+  const std::unique_ptr<_trace_event[]> _events;
+
+  /**
+   * \brief Guards `_name` and `_generation`, and the discarding of events.
+   */
+  std::mutex _mutex;
+  std::string _name;
+  /**
+   * \brief Value of `_trace_registry::_generation` when the events of this thread were last discarded.
+   */
+  std::uint64_t _generation;
+
+  std::atomic<std::size_t> _size{0};
+  std::atomic<std::uint64_t> _dropped{0};
+  /**
+   * \brief Whether the owning thread has exited, after which the buffer is discarded by the next `tracer::clear()`.
+   */
+  std::atomic<bool> _exited{false};
+};
+
+/**
+ * \brief The buffers of all threads which have recorded an event.
+ */
+struct _trace_registry {
+  std::mutex _mutex;
+  std::vector<std::shared_ptr<_trace_thread_data>> _threads;
+  /**
+   * \brief ID of the next registered thread. Guarded by `_mutex`.
+   */
+  std::size_t _next_id = 0;
+
+  std::atomic<std::size_t> _capacity{65536};
+  /**
+   * \brief Incremented by every `tracer::clear()`. Threads discard their events when they observe a new value.
+   */
+  std::atomic<std::uint64_t> _generation{0};
+};
+
+_trace_registry& _registry() {
+  static _trace_registry registry{};
+  return registry;
+}
+
+std::shared_ptr<_trace_thread_data> _register_thread() {
+  _trace_registry& registry{_registry()};
+  std::lock_guard<std::mutex> lk{registry._mutex};
+  auto data{std::make_shared<_trace_thread_data>(registry._next_id++,
+                                                 registry._capacity.load(std::memory_order_relaxed),
+                                                 registry._generation.load(std::memory_order_acquire))};
+  registry._threads.push_back(data);
+  return data;
+}
+
+/**
+ * \brief Registers the data of the calling thread, and marks it as exited when the thread exits.
+ */
+struct _trace_thread_handle {
+  _trace_thread_handle() : _data{_register_thread()} {}
+  _trace_thread_handle(const _trace_thread_handle&) = delete;
+  _trace_thread_handle& operator=(const _trace_thread_handle&) = delete;
+  ~_trace_thread_handle() { _data->_exited.store(true, std::memory_order_release); }
+
+  const std::shared_ptr<_trace_thread_data> _data;
+};
+
+_trace_thread_data& _this_thread() {
+  // The registry shares ownership of the data, so that events of exited threads are retained until the next clear.
+  thread_local const _trace_thread_handle handle{};
+  return *handle._data;
+}
+
+std::vector<std::shared_ptr<_trace_thread_data>> _registered_threads() {
+  _trace_registry& registry{_registry()};
+  std::lock_guard<std::mutex> lk{registry._mutex};
+  return registry._threads;
+}
+
+void _record(const _trace_event& event) {
+  _trace_thread_data& thread{_this_thread()};
+
+  const std::uint64_t generation{_registry()._generation.load(std::memory_order_acquire)};
+  if (generation != thread._generation) {
+    std::lock_guard<std::mutex> lk{thread._mutex};
+    thread._size.store(0, std::memory_order_relaxed);
+    thread._dropped.store(0, std::memory_order_relaxed);
+    thread._generation = generation;
+  }
+
+  const std::size_t size{thread._size.load(std::memory_order_relaxed)};
+  if (size == thread._capacity) {
+    thread._dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  thread._events[size] = event;
+  thread._size.store(size + 1, std::memory_order_release);
+}
+
+std::int64_t _to_ns(const tsc_clock::time_point time) noexcept {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+/**
+ * \brief Writes a time in nanoseconds as microseconds, which is the unit of times in the trace-event format. Negative
+ * times are written as zero.
+ */
+void _write_us(std::ostream& os, const std::int64_t ns) {
+  const auto clamped_ns{static_cast<std::uint64_t>(std::max(ns, std::int64_t{0}))};
+  os << clamped_ns / 1000 << '.' << std::setw(3) << std::setfill('0') << clamped_ns % 1000;
+}
+
+void _write_event(std::ostream& os, const _trace_event& event, const std::size_t tid) {
+  os << "{\"name\":";
+  _write_json_string(os, event._name);
+  os << ",\"ph\":\"" << static_cast<char>(event._phase) << "\",\"ts\":";
+  _write_us(os, event._begin_ns);
+  switch (event._phase) {
+    case _trace_phase::complete:
+      os << ",\"dur\":";
+      _write_us(os, event._duration_ns);
+      break;
+    case _trace_phase::instant:
+      os << ",\"s\":\"t\"";
+      break;
+    default:
+      break;
+  }
+  os << ",\"pid\":1,\"tid\":" << tid << '}';
+}
+}  // namespace
+
+void tracer::complete(const char* name, const tsc_clock::time_point begin, const tsc_clock::time_point end) {
+  _record(_trace_event{name, _to_ns(begin), _to_ns(end) - _to_ns(begin), _trace_phase::complete});
+}
+
+void tracer::instant(const char* name) {
+  _record(_trace_event{name, _to_ns(tsc_clock::now()), 0, _trace_phase::instant});
+}
+
+void tracer::set_thread_name(const std::string& name) {
+  _trace_thread_data& thread{_this_thread()};
+  std::lock_guard<std::mutex> lk{thread._mutex};
+  thread._name = name;
+}
+
+void tracer::set_buffer_capacity(const std::size_t events) {
+  if (events == 0) {
+    throw std::invalid_argument("Buffer capacity must be positive");
+  }
+
+  _registry()._capacity.store(events, std::memory_order_relaxed);
+}
+
+std::uint64_t tracer::dropped() {
+  const std::uint64_t generation{_registry()._generation.load(std::memory_order_acquire)};
+
+  std::uint64_t dropped{0};
+  for (const auto& thread : _registered_threads()) {
+    std::lock_guard<std::mutex> lk{thread->_mutex};
+    if (thread->_generation == generation) {
+      dropped += thread->_dropped.load(std::memory_order_relaxed);
+    }
+  }
+  return dropped;
+}
+
+void tracer::clear() {
+  _trace_registry& registry{_registry()};
+  registry._generation.fetch_add(1, std::memory_order_acq_rel);
+
+  // Exited threads will never record again, so their buffers can be released instead of only being discarded.
+  std::lock_guard<std::mutex> lk{registry._mutex};
+  registry._threads.erase(std::remove_if(registry._threads.begin(), registry._threads.end(),
+                                         [](const std::shared_ptr<_trace_thread_data>& thread) {
+                                           return thread->_exited.load(std::memory_order_acquire);
+                                         }),
+                          registry._threads.end());
+}
+
+void tracer::write_json(std::ostream& os) {
+  const std::uint64_t generation{_registry()._generation.load(std::memory_order_acquire)};
+
+  const auto flags{os.flags()};
+  const auto fill{os.fill()};
+  os << std::dec << "{\"traceEvents\":[";
+
+  bool first{true};
+  const auto separate = [&] {
+    if (!first) {
+      os << ',';
+    }
+    first = false;
+  };
+
+  for (const auto& thread : _registered_threads()) {
+    std::lock_guard<std::mutex> lk{thread->_mutex};
+
+    if (!thread->_name.empty()) {
+      separate();
+      os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->_id << ",\"args\":{\"name\":";
+      _write_json_string(os, thread->_name.c_str());
+      os << "}}";
+    }
+
+    // Events of a thread which has not observed the latest clear have been discarded, but are not yet overwritten.
+    if (thread->_generation != generation) {
+      continue;
+    }
+
+    const std::size_t size{thread->_size.load(std::memory_order_acquire)};
+    for (std::size_t i{0}; i < size; ++i) {
+      separate();
+      _write_event(os, thread->_events[i], thread->_id);
+    }
+  }
+
+  os << "],\"displayTimeUnit\":\"ns\"}";
+  os.flags(flags);
+  os.fill(fill);
+}
+
+}  // namespace base
+}  // namespace derplib
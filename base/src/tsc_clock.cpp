@@ -0,0 +1,75 @@
+#include "derplib/base/tsc_clock.h"
+
+#include <thread>
+
+#if defined(DERPLIB_TSC_CLOCK_HAS_TSC)
+#include <cpuid.h>
+#endif  // defined(DERPLIB_TSC_CLOCK_HAS_TSC)
+
+namespace derplib {
+namespace internal {
+namespace {
+#if defined(DERPLIB_TSC_CLOCK_HAS_TSC)
+/**
+ * \return Whether the CPU has an invariant time stamp counter.
+ */
+bool _has_invariant_tsc() noexcept {
+  unsigned eax{0};
+  unsigned ebx{0};
+  unsigned ecx{0};
+  unsigned edx{0};
+
+  if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+    return false;
+  }
+
+  // CPUID.80000007H:EDX[8] reports the invariant TSC.
+  return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) != 0 && (edx & (1U << 8)) != 0;
+}
+#endif  // defined(DERPLIB_TSC_CLOCK_HAS_TSC)
+}  // namespace
+
+_tsc_calibration _calibrate_tsc() noexcept {
+  _tsc_calibration calibration{false, 0, 0, 0, 0.0};
+
+#if defined(DERPLIB_TSC_CLOCK_HAS_TSC)
+  if (!_has_invariant_tsc()) {
+    return calibration;
+  }
+
+  const std::int64_t begin_ns{_steady_ns()};
+  const std::uint64_t begin_tsc{__builtin_ia32_rdtsc()};
+  std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  const std::int64_t end_ns{_steady_ns()};
+  const std::uint64_t end_tsc{__builtin_ia32_rdtsc()};
+
+  if (end_ns <= begin_ns || end_tsc <= begin_tsc) {
+    return calibration;
+  }
+
+  const double ns_per_tick{static_cast<double>(end_ns - begin_ns) / static_cast<double>(end_tsc - begin_tsc)};
+  calibration._uses_tsc = true;
+  calibration._base_tsc = end_tsc;
+  calibration._base_ns = end_ns;
+  calibration._multiplier =
+      static_cast<std::uint64_t>(ns_per_tick * static_cast<double>(std::uint64_t{1} << _tsc_calibration::Shift));
+  calibration._frequency = 1e9 / ns_per_tick;
+#endif  // defined(DERPLIB_TSC_CLOCK_HAS_TSC)
+
+  return calibration;
+}
+}  // namespace internal
+
+inline namespace base {
+constexpr bool tsc_clock::is_steady;
+
+bool tsc_clock::uses_tsc() noexcept {
+  return internal::_tsc_calibration_data()._uses_tsc;
+}
+
+double tsc_clock::tsc_frequency() noexcept {
+  return internal::_tsc_calibration_data()._frequency;
+}
+
+}  // namespace base
+}  // namespace derplib
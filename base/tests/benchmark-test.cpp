@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/benchmark.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+using derplib::benchmark_config;
+using derplib::benchmark_state;
+
+benchmark_config fast_config() {
+  benchmark_config cfg{};
+  cfg.warmup_time = std::chrono::milliseconds{1};
+  cfg.min_sample_time = std::chrono::milliseconds{1};
+  cfg.samples = 5;
+  return cfg;
+}
+
+DERPLIB_BENCHMARK(benchmark_test_registered) {
+  int value{0};
+  state.measure([&] { derplib::do_not_optimize(++value); });
+}
+
+DERPLIB_BENCHMARK(benchmark_test_not_measured) {}
+
+TEST(BenchmarkTest, ScalesIterations) {
+  benchmark_state state{"spin", fast_config()};
+  EXPECT_FALSE(state.has_result());
+
+  // Spins instead of sleeping, since a sleep may take longer than a whole sample.
+  int invocations{0};
+  state.measure([&] {
+    ++invocations;
+    const auto end{std::chrono::steady_clock::now() + std::chrono::microseconds{20}};
+    while (std::chrono::steady_clock::now() < end) {
+    }
+  });
+
+  ASSERT_TRUE(state.has_result());
+  const auto& result{state.result()};
+  EXPECT_EQ("spin", result.name);
+  EXPECT_GT(result.iterations, 1U);
+  EXPECT_EQ(5U, result.samples_ns.size());
+  EXPECT_GE(result.median_ns, 20000.0);
+  EXPECT_GE(result.mad_ns, 0.0);
+  EXPECT_GE(static_cast<std::uint64_t>(invocations), result.iterations * 6);
+}
+
+TEST(BenchmarkTest, AllocationsNotTracked) {
+  benchmark_state state{"allocate", fast_config()};
+  state.measure([] {
+    std::vector<int> v(16);
+    derplib::do_not_optimize(v.data());
+  });
+
+  // This executable does not replace the global operator new, so allocations are not reported.
+  ASSERT_TRUE(state.has_result());
+  EXPECT_DOUBLE_EQ(0.0, state.result().allocations_per_op);
+  EXPECT_DOUBLE_EQ(0.0, state.result().bytes_per_op);
+}
+
+TEST(BenchmarkTest, RunRegistered) {
+  const auto results{derplib::run_benchmarks(fast_config(), "benchmark_test_")};
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ("benchmark_test_registered", results[0].name);
+  EXPECT_GT(results[0].median_ns, 0.0);
+
+  EXPECT_TRUE(derplib::run_benchmarks(fast_config(), "no_such_benchmark").empty());
+
+  std::ostringstream oss{};
+  derplib::print_benchmark_results(oss, results);
+  EXPECT_EQ(0U, oss.str().find("Benchmark"));
+  EXPECT_NE(std::string::npos, oss.str().find("\nbenchmark_test_registered "));
+}
+
+TEST(BenchmarkTest, MainRejectsUnknownArguments) {
+  char program[]{"benchmark"};
+  char unknown[]{"--unknown"};
+  char* argv[]{program, unknown};
+  EXPECT_EQ(1, derplib::benchmark_main(2, argv));
+}
+
+TEST(BenchmarkTest, MainRejectsJsonWithoutWriter) {
+  char program[]{"benchmark"};
+  char json[]{"--json=results.json"};
+  char* argv[]{program, json};
+  EXPECT_EQ(1, derplib::benchmark_main(2, argv));
+}
+}  // namespace
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/benchmark.h>
+#include <derplib/base/benchmark_report.h>
+
+#include <chrono>
+#include <vector>
+
+// Replaces the global operator new for the whole executable, which is why these tests are not part of
+// derplib_base-test.
+DERPLIB_BENCHMARK_TRACK_ALLOCATIONS();
+
+namespace {
+using derplib::benchmark_config;
+using derplib::benchmark_state;
+
+benchmark_config fast_config() {
+  benchmark_config cfg{};
+  cfg.warmup_time = std::chrono::milliseconds{1};
+  cfg.min_sample_time = std::chrono::milliseconds{1};
+  cfg.samples = 5;
+  return cfg;
+}
+
+TEST(BenchmarkAllocationsTest, CountsAllocations) {
+  benchmark_state state{"allocate", fast_config()};
+  state.measure([] {
+    std::vector<int> v(16);
+    derplib::do_not_optimize(v.data());
+  });
+
+  ASSERT_TRUE(state.has_result());
+  EXPECT_DOUBLE_EQ(1.0, state.result().allocations_per_op);
+  EXPECT_DOUBLE_EQ(static_cast<double>(16 * sizeof(int)), state.result().bytes_per_op);
+
+  benchmark_state no_allocation_state{"no_allocation", fast_config()};
+  int value{0};
+  no_allocation_state.measure([&] { derplib::do_not_optimize(++value); });
+  EXPECT_DOUBLE_EQ(0.0, no_allocation_state.result().allocations_per_op);
+}
+
+TEST(BenchmarkAllocationsTest, ContextReportsTracking) {
+  EXPECT_TRUE(derplib::current_benchmark_context().allocations_tracked);
+}
+}  // namespace
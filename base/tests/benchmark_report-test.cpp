@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/benchmark_report.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+using derplib::benchmark_context;
+using derplib::benchmark_format_error;
+using derplib::benchmark_report;
+using derplib::benchmark_result;
+using derplib::benchmark_verdict;
+
+benchmark_result make_result(const std::string& name, const double base_ns) {
+  benchmark_result result{name, 1024, {}, base_ns + 4.5, 2.5, 64.0, 1.0};
+  for (int i{0}; i < 10; ++i) {
+    result.samples_ns.push_back(base_ns + i);
+  }
+  return result;
+}
+
+benchmark_report make_report(const std::vector<benchmark_result>& results) {
+  return {{"Test CPU", 4, "gcc", "release", true}, results};
+}
+
+TEST(BenchmarkReportTest, JsonRoundTrip) {
+  const benchmark_context context{"Test \"CPU\"\t@ 3.00GHz", 8, "gcc 9.4.0", "release", true};
+  const std::vector<benchmark_result> results{make_result("first", 10.0), make_result("second", 0.125)};
+
+  std::stringstream ss{};
+  derplib::write_benchmark_json(ss, context, results);
+  const auto report{derplib::read_benchmark_json(ss)};
+
+  EXPECT_EQ(context.cpu_model, report.context.cpu_model);
+  EXPECT_EQ(context.cpu_count, report.context.cpu_count);
+  EXPECT_EQ(context.compiler, report.context.compiler);
+  EXPECT_EQ(context.build_type, report.context.build_type);
+  EXPECT_TRUE(report.context.allocations_tracked);
+
+  ASSERT_EQ(2U, report.results.size());
+  for (std::size_t i{0}; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].name, report.results[i].name);
+    EXPECT_EQ(results[i].iterations, report.results[i].iterations);
+    EXPECT_DOUBLE_EQ(results[i].median_ns, report.results[i].median_ns);
+    EXPECT_DOUBLE_EQ(results[i].mad_ns, report.results[i].mad_ns);
+    EXPECT_DOUBLE_EQ(results[i].bytes_per_op, report.results[i].bytes_per_op);
+    EXPECT_DOUBLE_EQ(results[i].allocations_per_op, report.results[i].allocations_per_op);
+    EXPECT_EQ(results[i].samples_ns, report.results[i].samples_ns);
+  }
+}
+
+TEST(BenchmarkReportTest, JsonEmptyResults) {
+  std::stringstream ss{};
+  derplib::write_benchmark_json(ss, derplib::current_benchmark_context(), {});
+  EXPECT_TRUE(derplib::read_benchmark_json(ss).results.empty());
+}
+
+TEST(BenchmarkReportTest, JsonIgnoresUnknownMembers) {
+  std::istringstream iss{
+      R"({"version": [1, {"a": null}], "benchmarks": [{"name": "caf\u00e9 \ud83d\ude00", "extra": -1.5e3}]})"};
+  const auto report{derplib::read_benchmark_json(iss)};
+  ASSERT_EQ(1U, report.results.size());
+  EXPECT_EQ("caf\xc3\xa9 \xf0\x9f\x98\x80", report.results[0].name);
+}
+
+TEST(BenchmarkReportTest, JsonRejectsMalformedInput) {
+  const std::vector<std::string> inputs{
+      "",
+      "[]",
+      "{}",
+      R"({"benchmarks": [})",
+      R"({"benchmarks": [{"iterations": 1}]})",
+      R"({"benchmarks": [{"name": "a", "iterations": -1}]})",
+      R"({"benchmarks": [{"name": "a", "ns_per_op": "fast"}]})",
+      R"({"benchmarks": []} trailing)",
+      R"({"benchmarks": [{"name": "unterminated}]})",
+      std::string(100, '[')};
+  for (const auto& input : inputs) {
+    std::istringstream iss{input};
+    EXPECT_THROW(derplib::read_benchmark_json(iss), benchmark_format_error) << input;
+  }
+}
+
+TEST(BenchmarkReportTest, MannWhitneyUTest) {
+  const std::vector<double> low{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  const std::vector<double> high{11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+  const std::vector<double> interleaved{1.5, 2.5, 3.5, 4.5, 5.5, 6.5, 7.5, 8.5, 9.5, 10.5};
+
+  // U = 0 for completely separated samples of 10, which has a two-sided p-value of about 0.0002.
+  EXPECT_LT(derplib::mann_whitney_u_test(low, high), 0.001);
+  EXPECT_LT(derplib::mann_whitney_u_test(high, low), 0.001);
+  EXPECT_GT(derplib::mann_whitney_u_test(low, interleaved), 0.5);
+
+  EXPECT_DOUBLE_EQ(1.0, derplib::mann_whitney_u_test(low, low));
+  EXPECT_DOUBLE_EQ(1.0, derplib::mann_whitney_u_test({5, 5, 5}, {5, 5, 5}));
+  EXPECT_DOUBLE_EQ(1.0, derplib::mann_whitney_u_test({}, low));
+}
+
+TEST(BenchmarkReportTest, CompareBenchmarks) {
+  const auto baseline{make_report(
+      {make_result("unchanged", 100.0), make_result("regressed", 100.0), make_result("improved", 100.0),
+       make_result("insignificant", 100.0), make_result("removed", 100.0)})};
+  const auto contender{make_report(
+      {make_result("added", 100.0), make_result("improved", 50.0), make_result("regressed", 150.0),
+       make_result("unchanged", 100.0), make_result("insignificant", 101.0)})};
+
+  derplib::benchmark_compare_config cfg{};
+  cfg.threshold = 0.001;
+  const auto comparisons{derplib::compare_benchmarks(baseline, contender, cfg)};
+
+  ASSERT_EQ(4U, comparisons.size());
+  EXPECT_EQ("unchanged", comparisons[0].name);
+  EXPECT_EQ(benchmark_verdict::unchanged, comparisons[0].verdict);
+  EXPECT_DOUBLE_EQ(0.0, comparisons[0].change);
+
+  EXPECT_EQ("regressed", comparisons[1].name);
+  EXPECT_EQ(benchmark_verdict::regressed, comparisons[1].verdict);
+  EXPECT_DOUBLE_EQ(50.0 / 104.5, comparisons[1].change);
+  EXPECT_LT(comparisons[1].p_value, 0.05);
+
+  EXPECT_EQ("improved", comparisons[2].name);
+  EXPECT_EQ(benchmark_verdict::improved, comparisons[2].verdict);
+
+  // The change is above the threshold, but the samples overlap too much for the difference to be significant.
+  EXPECT_EQ("insignificant", comparisons[3].name);
+  EXPECT_EQ(benchmark_verdict::unchanged, comparisons[3].verdict);
+  EXPECT_GT(comparisons[3].p_value, 0.05);
+
+  std::ostringstream oss{};
+  derplib::print_benchmark_comparisons(oss, comparisons);
+  EXPECT_EQ(0U, oss.str().find("Benchmark"));
+  EXPECT_NE(std::string::npos, oss.str().find("REGRESSED"));
+}
+}  // namespace
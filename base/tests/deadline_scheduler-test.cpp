@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/deadline_scheduler.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+using derplib::deadline_scheduler;
+
+TEST(DeadlineSchedulerTest, InvokesTasksInDeadlineOrder) {
+  deadline_scheduler scheduler{};
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  std::vector<int> order{};
+
+  const auto start{deadline_scheduler::clock::now() + std::chrono::milliseconds{20}};
+  for (const int ms : {30, 10, 20, 0, 10}) {
+    scheduler.schedule_at(start + std::chrono::milliseconds{ms}, [&, ms] {
+      std::lock_guard<std::mutex> lk{mutex};
+      order.push_back(ms);
+      cv.notify_one();
+    });
+  }
+  EXPECT_EQ(5U, scheduler.pending());
+  EXPECT_EQ(start, scheduler.next_deadline());
+
+  std::unique_lock<std::mutex> lk{mutex};
+  ASSERT_TRUE(cv.wait_for(lk, std::chrono::seconds{5}, [&] { return order.size() == 5; }));
+  EXPECT_GE(deadline_scheduler::clock::now(), start + std::chrono::milliseconds{30});
+
+  const std::vector<int> expected{0, 10, 10, 20, 30};
+  EXPECT_EQ(expected, order);
+  EXPECT_EQ(0U, scheduler.pending());
+  EXPECT_EQ(deadline_scheduler::clock::time_point::max(), scheduler.next_deadline());
+}
+
+TEST(DeadlineSchedulerTest, InvokesExpiredTasksInBatch) {
+  constexpr int tasks{100};
+
+  deadline_scheduler scheduler{};
+  std::atomic_int fired{0};
+
+  const auto deadline{deadline_scheduler::clock::now()};
+  for (int i{0}; i < tasks; ++i) {
+    scheduler.schedule_at(deadline, [&] { ++fired; });
+  }
+
+  const auto timeout{std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+  while (fired < tasks && std::chrono::steady_clock::now() < timeout) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  EXPECT_EQ(tasks, fired);
+}
+
+TEST(DeadlineSchedulerTest, CoalesceTasksWithinSlack) {
+  constexpr int tasks{1000};
+
+  deadline_scheduler scheduler{};
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  std::vector<deadline_scheduler::clock::time_point> fired_at{};
+
+  // The deadlines span 20ms, and every task allows a slack of 50ms, so all tasks can be invoked in one wakeup after the
+  // last deadline.
+  const auto start{deadline_scheduler::clock::now() + std::chrono::milliseconds{20}};
+  for (int i{0}; i < tasks; ++i) {
+    const auto deadline{start + std::chrono::microseconds{20 * i}};
+    scheduler.schedule_at(deadline, std::chrono::milliseconds{50}, [&] {
+      std::lock_guard<std::mutex> lk{mutex};
+      fired_at.push_back(deadline_scheduler::clock::now());
+      cv.notify_one();
+    });
+  }
+  EXPECT_EQ(start + std::chrono::milliseconds{50}, scheduler.next_deadline());
+
+  std::unique_lock<std::mutex> lk{mutex};
+  ASSERT_TRUE(cv.wait_for(lk, std::chrono::seconds{5}, [&] { return fired_at.size() == tasks; }));
+  EXPECT_GE(fired_at.front(), start + std::chrono::milliseconds{20});
+}
+
+TEST(DeadlineSchedulerTest, InvokesDueTasksBelowPendingHead) {
+  deadline_scheduler scheduler{};
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  std::vector<std::pair<int, deadline_scheduler::clock::time_point>> fired{};
+  const auto record{[&](const int id) {
+    std::lock_guard<std::mutex> lk{mutex};
+    fired.emplace_back(id, deadline_scheduler::clock::now());
+    cv.notify_one();
+  }};
+
+  // The driver thread wakes up at the end of the slack of task 0. Task 2 is due by then, but the heap places it below
+  // task 1, which is not due until much later, as its slack window ends even later.
+  const auto start{deadline_scheduler::clock::now() + std::chrono::milliseconds{20}};
+  scheduler.schedule_at(start, std::chrono::milliseconds{20}, [&] { record(0); });
+  scheduler.schedule_at(start + std::chrono::milliseconds{500}, std::chrono::milliseconds{0}, [&] { record(1); });
+  scheduler.schedule_at(start + std::chrono::milliseconds{5}, std::chrono::seconds{10}, [&] { record(2); });
+
+  std::unique_lock<std::mutex> lk{mutex};
+  ASSERT_TRUE(cv.wait_for(lk, std::chrono::seconds{5}, [&] { return fired.size() == 3; }));
+
+  EXPECT_EQ(0, fired[0].first);
+  EXPECT_EQ(2, fired[1].first);
+  EXPECT_EQ(1, fired[2].first);
+  EXPECT_LT(fired[1].second, start + std::chrono::milliseconds{500});
+  EXPECT_GE(fired[2].second, start + std::chrono::milliseconds{500});
+}
+
+TEST(DeadlineSchedulerTest, InvalidSlack) {
+  deadline_scheduler scheduler{};
+  EXPECT_THROW(scheduler.schedule_after(std::chrono::milliseconds{1}, std::chrono::milliseconds{-1}, [] {}),
+               std::invalid_argument);
+
+  deadline_scheduler::config config{};
+  config.slack = std::chrono::milliseconds{-1};
+  EXPECT_THROW(deadline_scheduler{config}, std::invalid_argument);
+}
+
+TEST(DeadlineSchedulerTest, RecordsStats) {
+  deadline_scheduler::config config{};
+  config.slack = std::chrono::milliseconds{10};
+  deadline_scheduler scheduler{config};
+
+  std::atomic_int fired{0};
+  scheduler.schedule_after(std::chrono::milliseconds{1}, [&] { ++fired; });
+
+  const auto timeout{std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+  while (fired < 1 && std::chrono::steady_clock::now() < timeout) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  ASSERT_EQ(1, fired);
+
+  // The stats of the task are recorded after it returns.
+  std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  const auto stats{scheduler.stats()};
+  EXPECT_EQ(1U, stats.fired);
+
+  // The task is coalesced at the end of its slack, so it is at least 8.4ms late, i.e. in bucket 24 or above.
+  std::uint64_t late{0};
+  for (std::size_t i{24}; i < stats.lateness.size(); ++i) {
+    late += stats.lateness[i];
+  }
+  EXPECT_EQ(1U, late);
+}
+
+TEST(DeadlineSchedulerTest, CancelTask) {
+  deadline_scheduler scheduler{};
+  std::atomic_int fired{0};
+
+  auto h{scheduler.schedule_after(std::chrono::milliseconds{10}, [&] { ++fired; })};
+  scheduler.schedule_after(std::chrono::milliseconds{20}, [&] { fired += 10; });
+
+  EXPECT_TRUE(h.cancel());
+  EXPECT_FALSE(h.cancel());
+  EXPECT_FALSE(deadline_scheduler::handle{}.cancel());
+  EXPECT_EQ(1U, scheduler.pending());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  EXPECT_EQ(10, fired);
+}
+
+TEST(DeadlineSchedulerTest, HandleOfExpiredTaskDoesNotCancelReusedNode) {
+  deadline_scheduler scheduler{};
+  std::atomic_int fired{0};
+
+  auto h{scheduler.schedule_after(std::chrono::milliseconds{1}, [&] { ++fired; })};
+  while (fired == 0) {
+    std::this_thread::yield();
+  }
+
+  scheduler.schedule_after(std::chrono::milliseconds{10}, [&] { ++fired; });
+  EXPECT_FALSE(h.cancel());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  EXPECT_EQ(2, fired);
+}
+
+TEST(DeadlineSchedulerTest, MillionPendingTasks) {
+  constexpr int tasks{1000000};
+
+  deadline_scheduler scheduler{};
+  std::vector<deadline_scheduler::handle> handles{};
+  handles.reserve(tasks);
+
+  const auto start{deadline_scheduler::clock::now() + std::chrono::hours{1}};
+  for (int i{0}; i < tasks; ++i) {
+    handles.push_back(scheduler.schedule_at(start + std::chrono::milliseconds{i % 1000}, [] {}));
+  }
+  EXPECT_EQ(static_cast<std::size_t>(tasks), scheduler.pending());
+  EXPECT_EQ(start, scheduler.next_deadline());
+
+  for (int i{0}; i < tasks; i += 2) {
+    EXPECT_TRUE(handles[static_cast<std::size_t>(i)].cancel());
+  }
+  EXPECT_EQ(static_cast<std::size_t>(tasks / 2), scheduler.pending());
+
+  // A task with an earlier deadline wakes the driver thread, which is sleeping until the earliest existing deadline.
+  std::atomic_bool fired{false};
+  scheduler.schedule_after(std::chrono::milliseconds{1}, [&] { fired = true; });
+
+  const auto timeout{std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+  while (!fired && std::chrono::steady_clock::now() < timeout) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  EXPECT_TRUE(fired);
+  EXPECT_EQ(static_cast<std::size_t>(tasks / 2), scheduler.pending());
+}
+
+TEST(DeadlineSchedulerTest, LargeSlackDoesNotSlowDownWakeups) {
+  constexpr int tasks{1000000};
+  constexpr std::size_t probes{21};
+
+  deadline_scheduler::config config{};
+  config.record_stats = false;
+  deadline_scheduler scheduler{config};
+
+  // A task with a slack of an hour is pending among many tasks without slack, which must not make every wakeup visit
+  // all pending tasks.
+  const auto now{deadline_scheduler::clock::now()};
+  scheduler.schedule_at(now + std::chrono::minutes{30}, std::chrono::hours{1}, [] {});
+  for (int i{0}; i < tasks; ++i) {
+    scheduler.schedule_at(now + std::chrono::minutes{30} + std::chrono::milliseconds{i % 1000}, [] {});
+  }
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  std::vector<deadline_scheduler::clock::duration> lateness{};
+  for (std::size_t i{0}; i < probes; ++i) {
+    const auto deadline{deadline_scheduler::clock::now() + std::chrono::milliseconds{1}};
+    scheduler.schedule_at(deadline, [&, deadline] {
+      std::lock_guard<std::mutex> lk{mutex};
+      lateness.push_back(deadline_scheduler::clock::now() - deadline);
+      cv.notify_one();
+    });
+
+    std::unique_lock<std::mutex> lk{mutex};
+    ASSERT_TRUE(cv.wait_for(lk, std::chrono::seconds{5}, [&] { return lateness.size() == i + 1; }));
+  }
+
+  // Each wakeup only visits the expired tasks, so the typical wakeup is far faster than scanning a million tasks.
+  std::sort(lateness.begin(), lateness.end());
+  EXPECT_LT(lateness[probes / 2], std::chrono::milliseconds{2});
+}
+
+TEST(DeadlineSchedulerTest, DispatchesOntoExecutor) {
+  std::atomic_int dispatched{0};
+  std::atomic_int fired{0};
+
+  deadline_scheduler::config config{};
+  config.executor = [&](deadline_scheduler::callback_type callback) {
+    ++dispatched;
+    callback();
+  };
+  deadline_scheduler scheduler{config};
+
+  scheduler.schedule_after(std::chrono::milliseconds{1}, [&] { ++fired; });
+  scheduler.schedule_after(std::chrono::milliseconds{2}, [&] { ++fired; });
+
+  const auto timeout{std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+  while (fired < 2 && std::chrono::steady_clock::now() < timeout) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  EXPECT_EQ(2, dispatched);
+  EXPECT_EQ(2, fired);
+}
+}  // namespace
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/hdr_histogram.h>
+#include <derplib/base/stopwatch.h>
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+using derplib::concurrent_hdr_histogram;
+using derplib::hdr_histogram;
+
+TEST(HdrHistogramTest, Empty) {
+  const hdr_histogram h{};
+  EXPECT_EQ(0U, h.count());
+  EXPECT_EQ(0U, h.min());
+  EXPECT_EQ(0U, h.max());
+  EXPECT_EQ(0U, h.value_at_percentile(50.0));
+}
+
+TEST(HdrHistogramTest, ExactBelowSubBucketCount) {
+  hdr_histogram h{};
+  for (std::uint64_t i{0}; i < 1000; ++i) {
+    h.record(i);
+  }
+
+  EXPECT_EQ(1000U, h.count());
+  EXPECT_EQ(0U, h.min());
+  EXPECT_EQ(999U, h.max());
+  EXPECT_EQ(499U, h.value_at_percentile(50.0));
+  EXPECT_EQ(989U, h.value_at_percentile(99.0));
+  EXPECT_EQ(998U, h.value_at_percentile(99.9));
+  EXPECT_DOUBLE_EQ(499.5, h.mean());
+}
+
+TEST(HdrHistogramTest, PercentilesWithinPrecision) {
+  hdr_histogram h{};
+  for (std::uint64_t i{1}; i <= 100000; ++i) {
+    h.record(i * 1000);
+  }
+
+  const auto expect_near_relative = [](const std::uint64_t expected, const std::uint64_t actual) {
+    EXPECT_GE(actual, expected);
+    EXPECT_LE(static_cast<double>(actual - expected), static_cast<double>(expected) * 0.001);
+  };
+  expect_near_relative(50000000, h.value_at_percentile(50.0));
+  expect_near_relative(99000000, h.value_at_percentile(99.0));
+  expect_near_relative(99900000, h.value_at_percentile(99.9));
+  expect_near_relative(100000000, h.value_at_percentile(100.0));
+  expect_near_relative(100000000, h.max());
+  EXPECT_LE(h.min(), 1000U);
+}
+
+TEST(HdrHistogramTest, ClampsToHighestTrackableValue) {
+  hdr_histogram::config cfg{};
+  cfg.highest_trackable_value = 1000000;
+  cfg.significant_digits = 2;
+
+  hdr_histogram h{cfg};
+  h.record(std::uint64_t{1} << 40);
+  h.record(cfg.highest_trackable_value);
+  EXPECT_EQ(2U, h.count());
+  EXPECT_GE(h.max(), cfg.highest_trackable_value);
+  EXPECT_LE(static_cast<double>(h.max()), static_cast<double>(cfg.highest_trackable_value) * 1.01);
+}
+
+TEST(HdrHistogramTest, InvalidConfig) {
+  hdr_histogram::config cfg{};
+  cfg.significant_digits = 6;
+  EXPECT_THROW(hdr_histogram{cfg}, std::invalid_argument);
+
+  cfg.significant_digits = 0;
+  cfg.highest_trackable_value = 1;
+  EXPECT_THROW(hdr_histogram{cfg}, std::invalid_argument);
+}
+
+TEST(HdrHistogramTest, RecordDurations) {
+  hdr_histogram h{};
+  h.record(std::chrono::microseconds{5});
+  h.record(std::chrono::nanoseconds{-1});
+
+  derplib::stopwatch sw{};
+  sw.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  sw.stop();
+  h.record(sw.duration());
+
+  EXPECT_EQ(3U, h.count());
+  EXPECT_EQ(0U, h.min());
+  EXPECT_GE(h.value_at_percentile(50.0), 5000U);
+  EXPECT_LE(h.value_at_percentile(50.0), 5005U);
+  EXPECT_GE(h.max(), 1000000U);
+}
+
+TEST(HdrHistogramTest, Merge) {
+  hdr_histogram lhs{};
+  hdr_histogram rhs{};
+  lhs.record(10, 3);
+  rhs.record(20, 1);
+
+  lhs.merge(rhs);
+  EXPECT_EQ(4U, lhs.count());
+  EXPECT_EQ(10U, lhs.value_at_percentile(75.0));
+  EXPECT_EQ(20U, lhs.value_at_percentile(100.0));
+
+  lhs.reset();
+  EXPECT_EQ(0U, lhs.count());
+  EXPECT_EQ(0U, lhs.max());
+
+  hdr_histogram::config cfg{};
+  cfg.significant_digits = 2;
+  EXPECT_THROW(lhs.merge(hdr_histogram{cfg}), std::invalid_argument);
+}
+
+TEST(HdrHistogramTest, ConcurrentRecord) {
+  constexpr std::uint64_t per_thread{10000};
+  concurrent_hdr_histogram h{};
+
+  std::vector<std::thread> threads{};
+  for (std::uint64_t t{0}; t < 4; ++t) {
+    threads.emplace_back([&h] {
+      for (std::uint64_t i{0}; i < per_thread; ++i) {
+        h.record(i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const auto snapshot{h.snapshot()};
+  EXPECT_EQ(4 * per_thread, snapshot.count());
+  EXPECT_EQ(0U, snapshot.min());
+  EXPECT_GE(snapshot.max(), per_thread - 1);
+
+  h.reset();
+  EXPECT_EQ(0U, h.snapshot().count());
+}
+}  // namespace
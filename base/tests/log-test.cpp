@@ -2,9 +2,57 @@
 
 #include <derplib/base/log.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
 namespace {
 using derplib::logger;
 
+/**
+ * \brief A string buffer which blocks writes until it is released.
+ */
+class blocking_stringbuf : public std::stringbuf {
+ public:
+  /**
+   * \brief Waits until a write is blocked.
+   */
+  void wait_until_blocked() {
+    std::unique_lock<std::mutex> lk{_mutex_};
+    _cv_.wait(lk, [&] { return _blocked_; });
+  }
+
+  void release() {
+    std::lock_guard<std::mutex> lk{_mutex_};
+    _released_ = true;
+    _cv_.notify_all();
+  }
+
+ protected:
+  std::streamsize xsputn(const char* s, const std::streamsize count) override {
+    std::unique_lock<std::mutex> lk{_mutex_};
+    _blocked_ = true;
+    _cv_.notify_all();
+    _cv_.wait(lk, [&] { return _released_; });
+    return std::stringbuf::xsputn(s, count);
+  }
+
+ private:
+  std::mutex _mutex_;
+  std::condition_variable _cv_;
+  bool _blocked_ = false;
+  bool _released_ = false;
+};
+
+std::size_t count_lines(const std::string& str) {
+  return static_cast<std::size_t>(std::count(str.begin(), str.end(), '\n'));
+}
+
 TEST(LogTest, OutputError) {
   std::ostringstream oss{};
 
@@ -29,4 +77,153 @@ TEST(LogTest, OutputError) {
   ASSERT_TRUE(oss_str.find("Error") != std::string::npos);
 }
 
+TEST(LogTest, LazyMessage) {
+  std::ostringstream oss{};
+
+  logger l{oss, logger::level::info};
+  EXPECT_FALSE(l.is_loggable(logger::level::debug));
+  EXPECT_TRUE(l.is_loggable(logger::level::info));
+
+  int evaluations{0};
+  const auto make_message{[&](const char* message) {
+    ++evaluations;
+    return std::string{message};
+  }};
+
+  l.d([&] { return make_message("Debug"); });
+  DERPLIB_LOG_D(l, make_message("Debug") + " from macro");
+  EXPECT_EQ(0, evaluations);
+  EXPECT_TRUE(oss.str().empty());
+
+  l.i([&] { return make_message("Info"); });
+  DERPLIB_LOG_W(l, make_message("Warning") + " from macro");
+  DERPLIB_LOG_E(l, "Error");
+  EXPECT_EQ(2, evaluations);
+
+  const std::string oss_str{oss.str()};
+  EXPECT_EQ(3U, count_lines(oss_str));
+  EXPECT_NE(std::string::npos, oss_str.find("\tI: Info\n"));
+  EXPECT_NE(std::string::npos, oss_str.find("\tW: Warning from macro\n"));
+  EXPECT_NE(std::string::npos, oss_str.find("\tE: Error\n"));
+}
+
+TEST(LogTest, TimestampFormat) {
+  std::ostringstream oss{};
+
+  logger l{oss, logger::level::info};
+  l.i("First");
+  l.w("Second");
+
+  // "%m-%d %H:%M:%S.mmm", followed by the level and the message
+  const std::string line_format{R"(\d\d-\d\d \d\d:\d\d:\d\d\.\d{3}\t)"};
+  const std::regex output_format{line_format + R"(I: First\n)" + line_format + R"(W: Second\n)"};
+  EXPECT_TRUE(std::regex_match(oss.str(), output_format)) << oss.str();
+}
+
+TEST(LogTest, WideOutput) {
+  std::wostringstream woss{};
+
+  derplib::wlogger l{woss, derplib::wlogger::level::info};
+  l.d(L"Debug");
+  l.i(L"Info");
+
+  const std::wstring woss_str{woss.str()};
+  EXPECT_EQ(std::wstring::npos, woss_str.find(L"Debug"));
+  EXPECT_NE(std::wstring::npos, woss_str.find(L"\tI: Info\n"));
+}
+
+TEST(LogTest, AsyncFlush) {
+  std::ostringstream oss{};
+
+  logger l{oss, logger::level::info, logger::async_config{}};
+  ASSERT_TRUE(l.is_async());
+
+  l.d("Debug");
+  l.i("Info");
+  l.e("Error");
+  l.flush();
+
+  const std::string oss_str{oss.str()};
+  ASSERT_EQ(2U, count_lines(oss_str));
+  ASSERT_EQ(std::string::npos, oss_str.find("Debug"));
+  ASSERT_LT(oss_str.find("\tI: Info\n"), oss_str.find("\tE: Error\n"));
+  ASSERT_NE(std::string::npos, oss_str.find("\tE: Error\n"));
+}
+
+TEST(LogTest, AsyncLazyMessage) {
+  std::ostringstream oss{};
+
+  {
+    logger l{oss, logger::level::info, logger::async_config{}};
+    DERPLIB_LOG_D(l, std::string{"Debug"});
+    DERPLIB_LOG_I(l, std::string{"Info"} + " from macro");
+  }
+
+  EXPECT_EQ(1U, count_lines(oss.str()));
+  EXPECT_NE(std::string::npos, oss.str().find("\tI: Info from macro\n"));
+}
+
+TEST(LogTest, AsyncMultipleProducers) {
+  constexpr int ThreadCount = 4;
+  constexpr int MessageCount = 1000;
+
+  std::ostringstream oss{};
+  {
+    logger::async_config cfg{};
+    cfg.capacity = 16;
+    logger l{oss, logger::level::verbose, cfg};
+
+    std::vector<std::thread> threads{};
+    for (int t{0}; t < ThreadCount; ++t) {
+      threads.emplace_back([&l, t] {
+        for (int i{0}; i < MessageCount; ++i) {
+          l.i(std::to_string(t) + ":" + std::to_string(i));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    EXPECT_EQ(0U, l.dropped());
+  }
+
+  // The destructor writes all queued messages.
+  const std::string oss_str{oss.str()};
+  ASSERT_EQ(static_cast<std::size_t>(ThreadCount * MessageCount), count_lines(oss_str));
+
+  // Messages of each thread are written in the order they are logged.
+  for (int t{0}; t < ThreadCount; ++t) {
+    std::size_t pos{0};
+    for (int i{0}; i < MessageCount; ++i) {
+      pos = oss_str.find(": " + std::to_string(t) + ":" + std::to_string(i) + "\n", pos);
+      ASSERT_NE(std::string::npos, pos);
+    }
+  }
+}
+
+TEST(LogTest, AsyncDropWhenFull) {
+  constexpr std::size_t MessageCount = 10;
+
+  blocking_stringbuf buf{};
+  std::ostream os{&buf};
+
+  logger::async_config cfg{};
+  cfg.capacity = 2;
+  cfg.overflow = logger::overflow_policy::drop;
+  logger l{os, logger::level::verbose, cfg};
+
+  // Once the background thread is blocked writing the first message, only two more messages can be queued.
+  l.i("First");
+  buf.wait_until_blocked();
+  for (std::size_t i{0}; i < MessageCount; ++i) {
+    l.i("Message");
+  }
+  EXPECT_EQ(MessageCount - 2, l.dropped());
+
+  buf.release();
+  l.flush();
+  EXPECT_EQ(3U, count_lines(buf.str()));
+}
+
 }  // namespace
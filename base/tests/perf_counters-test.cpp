@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/perf_counters.h>
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace {
+using derplib::perf_counter_mode;
+using derplib::perf_counters;
+using derplib::perf_event;
+
+std::uint64_t busy_loop(const std::uint64_t iterations) {
+  volatile std::uint64_t sum{0};
+  for (std::uint64_t i{0}; i < iterations; ++i) {
+    sum = sum + i;
+  }
+  return sum;
+}
+
+TEST(PerfCountersTest, MeasuresRegion) {
+  perf_counters counters{};
+  counters.start();
+  busy_loop(1000000);
+  std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  counters.stop();
+
+  const auto sample{counters.sample()};
+  EXPECT_GE(sample.elapsed, std::chrono::milliseconds{1});
+
+  switch (counters.mode()) {
+    case perf_counter_mode::hardware:
+      if (counters.available(perf_event::instructions)) {
+        EXPECT_GE(sample.instructions, 1000000U);
+      }
+      if (counters.available(perf_event::cycles) && counters.available(perf_event::instructions)) {
+        EXPECT_GT(sample.ipc(), 0.0);
+      }
+      break;
+    case perf_counter_mode::software:
+      EXPECT_FALSE(counters.available(perf_event::cycles));
+      EXPECT_EQ(0U, sample.cycles);
+      EXPECT_EQ(0.0, sample.ipc());
+      break;
+    case perf_counter_mode::timing_only:
+      for (const auto event : {perf_event::cycles, perf_event::task_clock, perf_event::context_switches}) {
+        EXPECT_FALSE(counters.available(event));
+      }
+      break;
+    default:
+      FAIL();
+  }
+
+  if (counters.available(perf_event::task_clock)) {
+    EXPECT_GT(sample.task_clock, 0U);
+  }
+}
+
+TEST(PerfCountersTest, RestartResetsCounts) {
+  perf_counters counters{};
+  counters.start();
+  busy_loop(1000000);
+  counters.stop();
+  const auto first{counters.sample()};
+
+  counters.start();
+  counters.stop();
+  const auto second{counters.sample()};
+
+  EXPECT_LE(second.elapsed, first.elapsed);
+  EXPECT_LE(second.instructions, first.instructions);
+  EXPECT_LE(second.task_clock, first.task_clock);
+}
+}  // namespace
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/periodic_timer.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+using derplib::catch_up_policy;
+using derplib::periodic_timer;
+
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * \brief Records the time of every tick, and stalls on the first tick to force subsequent ticks to be missed.
+ */
+class tick_recorder {
+ public:
+  explicit tick_recorder(const std::chrono::milliseconds first_tick_delay) : _first_tick_delay{first_tick_delay} {}
+
+  void operator()() {
+    std::unique_lock<std::mutex> lk{_mutex_};
+    _ticks_.push_back(clock_type::now());
+    if (_ticks_.size() == 1) {
+      lk.unlock();
+      std::this_thread::sleep_for(_first_tick_delay);
+      lk.lock();
+    }
+    _cv_.notify_one();
+  }
+
+  std::vector<clock_type::time_point> wait_for(const std::size_t ticks) {
+    std::unique_lock<std::mutex> lk{_mutex_};
+    _cv_.wait(lk, [&] { return _ticks_.size() >= ticks; });
+    return _ticks_;
+  }
+
+ private:
+  const std::chrono::milliseconds _first_tick_delay;
+
+  std::mutex _mutex_;
+  std::condition_variable _cv_;
+  std::vector<clock_type::time_point> _ticks_;
+};
+
+TEST(PeriodicTimerTest, TicksAgainstAbsoluteDeadlines) {
+  constexpr std::chrono::milliseconds period{10};
+  tick_recorder recorder{std::chrono::milliseconds{0}};
+
+  periodic_timer<> t{period, [&] { recorder(); }};
+  const auto start{clock_type::now()};
+  t.start();
+  const auto ticks{recorder.wait_for(20)};
+  t.stop();
+
+  for (std::size_t i{0}; i < ticks.size(); ++i) {
+    EXPECT_GE(ticks[i] - start, period * static_cast<int>(i + 1));
+  }
+  EXPECT_EQ(0U, t.missed());
+  EXPECT_GE(t.stats().fired, 20U);
+}
+
+TEST(PeriodicTimerTest, StatsDisabled) {
+  tick_recorder recorder{std::chrono::milliseconds{0}};
+
+  periodic_timer<>::config config{};
+  config.record_stats = false;
+
+  periodic_timer<> t{std::chrono::milliseconds{5}, [&] { recorder(); }, config};
+  t.start();
+  recorder.wait_for(3);
+  t.stop();
+
+  EXPECT_EQ(0U, t.stats().fired);
+}
+
+TEST(PeriodicTimerTest, SkipMissedTicks) {
+  constexpr std::chrono::milliseconds period{50};
+  tick_recorder recorder{std::chrono::milliseconds{175}};
+
+  periodic_timer<> t{period, [&] { recorder(); }, catch_up_policy::skip};
+  const auto start{clock_type::now()};
+  t.start();
+  const auto ticks{recorder.wait_for(2)};
+  t.stop();
+
+  // The first tick ends after 225ms, so the ticks at 100ms, 150ms and 200ms are dropped.
+  EXPECT_GE(ticks[1] - start, std::chrono::milliseconds{250});
+  EXPECT_GE(t.missed(), 3U);
+}
+
+TEST(PeriodicTimerTest, FireAllMissedTicks) {
+  constexpr std::chrono::milliseconds period{50};
+  tick_recorder recorder{std::chrono::milliseconds{175}};
+
+  periodic_timer<> t{period, [&] { recorder(); }, catch_up_policy::fire_all};
+  const auto start{clock_type::now()};
+  t.start();
+  const auto ticks{recorder.wait_for(5)};
+  t.stop();
+
+  // The ticks at 100ms, 150ms and 200ms are invoked as soon as the first tick ends, without waiting for the next one.
+  EXPECT_LT(ticks[3] - ticks[0], std::chrono::milliseconds{200});
+  EXPECT_GE(ticks[4] - start, std::chrono::milliseconds{250});
+  EXPECT_EQ(0U, t.missed());
+}
+
+TEST(PeriodicTimerTest, RescheduleMissedTicks) {
+  constexpr std::chrono::milliseconds period{50};
+  tick_recorder recorder{std::chrono::milliseconds{175}};
+
+  periodic_timer<> t{period, [&] { recorder(); }, catch_up_policy::reschedule};
+  t.start();
+  const auto ticks{recorder.wait_for(2)};
+  t.stop();
+
+  // The next tick is scheduled one period after the first tick ends.
+  EXPECT_GE(ticks[1] - ticks[0], std::chrono::milliseconds{225});
+  EXPECT_GE(t.missed(), 3U);
+}
+
+TEST(PeriodicTimerTest, SetPeriodWhileRunning) {
+  tick_recorder recorder{std::chrono::milliseconds{0}};
+
+  periodic_timer<> t{std::chrono::hours{1}, [&] { recorder(); }};
+  t.start();
+
+  const auto start{clock_type::now()};
+  t.set_period(std::chrono::milliseconds{10});
+  EXPECT_EQ(std::chrono::milliseconds{10}, t.period());
+  recorder.wait_for(3);
+  EXPECT_LT(clock_type::now() - start, std::chrono::seconds{5});
+
+  EXPECT_THROW(t.set_period(std::chrono::milliseconds{0}), std::invalid_argument);
+}
+
+TEST(PeriodicTimerTest, SetPeriodSkipsOverdueTicks) {
+  tick_recorder recorder{std::chrono::milliseconds{0}};
+
+  periodic_timer<> t{std::chrono::hours{1}, [&] { recorder(); }, catch_up_policy::skip};
+  const auto start{clock_type::now()};
+  t.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds{60});
+
+  // The ticks at 20ms, 40ms and 60ms are already overdue, so they are dropped instead of being invoked late.
+  t.set_period(std::chrono::milliseconds{20});
+  EXPECT_GE(t.missed(), 3U);
+  const auto ticks{recorder.wait_for(1)};
+  t.stop();
+
+  EXPECT_GE(ticks[0] - start, std::chrono::milliseconds{80});
+}
+
+TEST(PeriodicTimerTest, StopAndRestart) {
+  tick_recorder recorder{std::chrono::milliseconds{0}};
+
+  periodic_timer<> t{std::chrono::milliseconds{10}, [&] { recorder(); }};
+  EXPECT_FALSE(t.active());
+  t.start();
+  EXPECT_TRUE(t.active());
+  EXPECT_THROW(t.start(), std::logic_error);
+
+  recorder.wait_for(1);
+  t.stop();
+  EXPECT_FALSE(t.active());
+
+  t.start();
+  recorder.wait_for(2);
+}
+}  // namespace
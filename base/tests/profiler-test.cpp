@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/profiler.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+using derplib::profile_node;
+using derplib::profile_zone;
+using derplib::profiler;
+
+const profile_node* find_child(const profile_node& node, const std::string& name) {
+  for (const auto& child : node.children) {
+    if (child.name == name) {
+      return &child;
+    }
+  }
+  return nullptr;
+}
+
+void leaf() {
+  profile_zone zone{"leaf"};
+  std::this_thread::sleep_for(std::chrono::milliseconds{2});
+}
+
+void outer() {
+  profile_zone zone{"outer"};
+  leaf();
+  leaf();
+}
+
+TEST(ProfilerTest, RecordsNestedZones) {
+  profiler::reset();
+
+  std::thread t{[] { outer(); }};
+  outer();
+  t.join();
+
+  const auto root{profiler::collect()};
+  const auto* outer_node{find_child(root, "outer")};
+  ASSERT_NE(nullptr, outer_node);
+  EXPECT_EQ(2U, outer_node->count);
+
+  const auto* leaf_node{find_child(*outer_node, "leaf")};
+  ASSERT_NE(nullptr, leaf_node);
+  EXPECT_EQ(4U, leaf_node->count);
+  const auto* root_leaf_node{find_child(root, "leaf")};
+  EXPECT_TRUE(root_leaf_node == nullptr || root_leaf_node->count == 0);
+
+  EXPECT_GE(leaf_node->min_time, std::chrono::milliseconds{2});
+  EXPECT_LE(leaf_node->min_time, leaf_node->max_time);
+  EXPECT_GE(leaf_node->total_time, std::chrono::milliseconds{8});
+  EXPECT_EQ(leaf_node->total_time, leaf_node->self_time);
+  EXPECT_EQ(outer_node->total_time - leaf_node->total_time, outer_node->self_time);
+
+  std::ostringstream oss{};
+  profiler::print(oss, root);
+  EXPECT_NE(std::string::npos, oss.str().find("outer: count=2"));
+  EXPECT_NE(std::string::npos, oss.str().find("\n  leaf: count=4"));
+}
+
+TEST(ProfilerTest, Reset) {
+  leaf();
+  profiler::reset();
+
+  const auto root{profiler::collect()};
+  const auto* leaf_node{find_child(root, "leaf")};
+  ASSERT_NE(nullptr, leaf_node);
+  EXPECT_EQ(0U, leaf_node->count);
+  EXPECT_EQ(std::chrono::nanoseconds{0}, leaf_node->total_time);
+}
+
+TEST(ProfilerTest, ResetReleasesExitedThreads) {
+  profiler::reset();
+
+  std::thread t{[] { profile_zone zone{"exited_zone"}; }};
+  t.join();
+
+  // Timings of exited threads are retained until the next reset.
+  const auto root{profiler::collect()};
+  const auto* node{find_child(root, "exited_zone")};
+  ASSERT_NE(nullptr, node);
+  EXPECT_EQ(1U, node->count);
+
+  profiler::reset();
+  EXPECT_EQ(nullptr, find_child(profiler::collect(), "exited_zone"));
+}
+
+TEST(ProfilerTest, ZoneMacro) {
+  profiler::reset();
+  {
+    DERPLIB_PROFILE_ZONE("macro");
+  }
+
+  const auto root{profiler::collect()};
+  const auto* node{find_child(root, "macro")};
+#if defined(DERPLIB_ENABLE_PROFILING)
+  ASSERT_NE(nullptr, node);
+  EXPECT_EQ(1U, node->count);
+#else
+  EXPECT_EQ(nullptr, node);
+#endif  // defined(DERPLIB_ENABLE_PROFILING)
+}
+}  // namespace
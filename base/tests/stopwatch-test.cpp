@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/stopwatch.h>
+#include <derplib/base/tsc_clock.h>
+
+#include <chrono>
+#include <thread>
+
+namespace {
+using derplib::basic_stopwatch;
+using derplib::stopwatch;
+using derplib::tsc_clock;
+
+TEST(StopwatchTest, MeasuresElapsedTime) {
+  stopwatch sw{};
+  sw.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  sw.stop();
+
+  const auto elapsed{sw.duration()};
+  EXPECT_GE(elapsed, std::chrono::milliseconds{10});
+  EXPECT_EQ(elapsed.count(), sw.count());
+
+  // A stopped stopwatch does not advance.
+  std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  EXPECT_EQ(elapsed, sw.duration());
+}
+
+TEST(TscClockTest, IsMonotonic) {
+  auto last{tsc_clock::now()};
+  for (int i{0}; i < 100000; ++i) {
+    const auto now{tsc_clock::now()};
+    EXPECT_LE(last, now);
+    last = now;
+  }
+}
+
+TEST(TscClockTest, AgreesWithSteadyClock) {
+  const auto steady_begin{std::chrono::steady_clock::now()};
+  const auto tsc_begin{tsc_clock::now()};
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  const auto tsc_end{tsc_clock::now()};
+  const auto steady_end{std::chrono::steady_clock::now()};
+
+  const auto steady_ns{std::chrono::duration_cast<std::chrono::nanoseconds>(steady_end - steady_begin).count()};
+  const auto tsc_ns{(tsc_end - tsc_begin).count()};
+  // Allows for errors in calibration.
+  EXPECT_LE(tsc_ns, steady_ns * 105 / 100);
+  EXPECT_GE(tsc_ns, steady_ns * 95 / 100);
+
+  if (tsc_clock::uses_tsc()) {
+    EXPECT_GT(tsc_clock::tsc_frequency(), 0.0);
+  } else {
+    EXPECT_EQ(0.0, tsc_clock::tsc_frequency());
+  }
+}
+
+TEST(TscClockTest, Stopwatch) {
+  basic_stopwatch<tsc_clock> sw{};
+  sw.start();
+  std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  sw.stop();
+
+  EXPECT_GE(sw.duration<std::chrono::microseconds>(), std::chrono::microseconds{9500});
+}
+}  // namespace
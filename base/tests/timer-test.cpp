@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/timer.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+using derplib::timer;
+
+TEST(TimerTest, InvokesCallbackAfterDuration) {
+  std::atomic_bool fired{false};
+
+  const auto start{std::chrono::steady_clock::now()};
+  timer<> t{std::chrono::milliseconds{20}, [&] { fired = true; }};
+  t.start();
+  EXPECT_TRUE(t.active());
+
+  while (!fired) {
+    std::this_thread::yield();
+  }
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds{20});
+  EXPECT_TRUE(t.expired());
+}
+
+TEST(TimerTest, StopReturnsBeforeDeadline) {
+  std::atomic_bool fired{false};
+
+  timer<> t{std::chrono::seconds{30}, [&] { fired = true; }};
+  t.start();
+
+  const auto start{std::chrono::steady_clock::now()};
+  t.stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{1});
+
+  EXPECT_FALSE(t.active());
+  EXPECT_FALSE(t.expired());
+  EXPECT_FALSE(fired);
+}
+
+TEST(TimerTest, DestructorReturnsBeforeDeadline) {
+  const auto start{std::chrono::steady_clock::now()};
+  {
+    timer<> t{std::chrono::seconds{30}, [] {}};
+    t.start();
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{1});
+}
+
+TEST(TimerTest, CopyAssignment) {
+  std::atomic_int fired{0};
+
+  const timer<> source{std::chrono::milliseconds{20}, [&] { fired = 1; }};
+  timer<> t{std::chrono::seconds{30}, [&] { fired = 2; }};
+  t.start();
+
+  // Assigning to a running timer stops it without invoking its callback.
+  const auto start{std::chrono::steady_clock::now()};
+  t = source;
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{1});
+  EXPECT_FALSE(t.active());
+  EXPECT_FALSE(t.expired());
+  EXPECT_EQ(0, fired);
+
+  t.start();
+  while (fired == 0) {
+    std::this_thread::yield();
+  }
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds{20});
+  EXPECT_EQ(1, fired);
+  EXPECT_TRUE(t.expired());
+}
+}  // namespace
@@ -0,0 +1,179 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/timer_service.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+using derplib::timer_service;
+
+TEST(TimerServiceTest, InvokesCallbackAfterDeadline) {
+  timer_service service{};
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  bool fired{false};
+
+  const auto start{timer_service::clock::now()};
+  timer_service::clock::time_point fired_at{};
+  service.schedule_after(std::chrono::milliseconds{20}, [&] {
+    std::lock_guard<std::mutex> lk{mutex};
+    fired_at = timer_service::clock::now();
+    fired = true;
+    cv.notify_one();
+  });
+
+  std::unique_lock<std::mutex> lk{mutex};
+  ASSERT_TRUE(cv.wait_for(lk, std::chrono::seconds{5}, [&] { return fired; }));
+  EXPECT_GE(fired_at - start, std::chrono::milliseconds{20});
+  EXPECT_EQ(0U, service.pending());
+}
+
+TEST(TimerServiceTest, InvokesCallbacksInDeadlineOrder) {
+  timer_service service{};
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  std::vector<int> order{};
+
+  // Spans the first two levels of the wheel.
+  for (const int ms : {300, 10, 100, 5, 270}) {
+    service.schedule_after(std::chrono::milliseconds{ms}, [&, ms] {
+      std::lock_guard<std::mutex> lk{mutex};
+      order.push_back(ms);
+      cv.notify_one();
+    });
+  }
+  EXPECT_EQ(5U, service.pending());
+
+  std::unique_lock<std::mutex> lk{mutex};
+  ASSERT_TRUE(cv.wait_for(lk, std::chrono::seconds{5}, [&] { return order.size() == 5; }));
+
+  const std::vector<int> expected{5, 10, 100, 270, 300};
+  EXPECT_EQ(expected, order);
+}
+
+TEST(TimerServiceTest, CancelTimer) {
+  timer_service service{};
+  std::atomic_int fired{0};
+
+  auto h{service.schedule_after(std::chrono::milliseconds{20}, [&] { ++fired; })};
+  service.schedule_after(std::chrono::milliseconds{40}, [&] { fired += 10; });
+
+  EXPECT_TRUE(h.cancel());
+  EXPECT_FALSE(h.cancel());
+  EXPECT_FALSE(timer_service::handle{}.cancel());
+  EXPECT_EQ(1U, service.pending());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  EXPECT_EQ(10, fired);
+}
+
+TEST(TimerServiceTest, HandleOfExpiredTimerDoesNotCancelReusedSlot) {
+  timer_service service{};
+  std::atomic_int fired{0};
+
+  auto h{service.schedule_after(std::chrono::milliseconds{1}, [&] { ++fired; })};
+  while (fired == 0) {
+    std::this_thread::yield();
+  }
+
+  service.schedule_after(std::chrono::milliseconds{20}, [&] { ++fired; });
+  EXPECT_FALSE(h.cancel());
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{100});
+  EXPECT_EQ(2, fired);
+}
+
+TEST(TimerServiceTest, ManyTimers) {
+  constexpr int timers{100000};
+
+  timer_service service{};
+  std::atomic_int fired{0};
+  std::vector<timer_service::handle> handles{};
+  handles.reserve(timers);
+
+  // Deadlines are far enough in the future that no timer expires before all of them have been scheduled and cancelled.
+  const auto start{timer_service::clock::now() + std::chrono::seconds{1}};
+  for (int i{0}; i < timers; ++i) {
+    handles.push_back(service.schedule_at(start + std::chrono::milliseconds{i % 50}, [&] { ++fired; }));
+  }
+  for (int i{0}; i < timers; i += 2) {
+    EXPECT_TRUE(handles[static_cast<std::size_t>(i)].cancel());
+  }
+
+  const auto deadline{std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+  while (fired < timers / 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  EXPECT_EQ(timers / 2, fired);
+  EXPECT_EQ(0U, service.pending());
+}
+
+TEST(TimerServiceTest, DispatchesOntoExecutor) {
+  std::atomic_int dispatched{0};
+  std::atomic_int fired{0};
+
+  timer_service::config config{};
+  config.executor = [&](timer_service::callback_type callback) {
+    ++dispatched;
+    callback();
+  };
+  timer_service service{config};
+
+  service.schedule_after(std::chrono::milliseconds{1}, [&] { ++fired; });
+  service.schedule_after(std::chrono::milliseconds{2}, [&] { ++fired; });
+
+  const auto deadline{std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+  while (fired < 2 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  EXPECT_EQ(2, dispatched);
+  EXPECT_EQ(2, fired);
+}
+
+TEST(TimerServiceTest, RecordsStats) {
+  timer_service service{};
+  std::atomic_int fired{0};
+
+  for (int i{0}; i < 10; ++i) {
+    service.schedule_after(std::chrono::milliseconds{1 + i}, [&] {
+      std::this_thread::sleep_for(std::chrono::microseconds{100});
+      ++fired;
+    });
+  }
+
+  const auto deadline{std::chrono::steady_clock::now() + std::chrono::seconds{5}};
+  while (fired < 10 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  ASSERT_EQ(10, fired);
+
+  // The stats of the last callback are recorded after it returns.
+  std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  const auto stats{service.stats()};
+  EXPECT_EQ(10U, stats.fired);
+
+  std::uint64_t slow_callbacks{0};
+  // Bucket 17 counts durations from 65536ns.
+  for (std::size_t i{17}; i < stats.callback_time.size(); ++i) {
+    slow_callbacks += stats.callback_time[i];
+  }
+  EXPECT_EQ(10U, slow_callbacks);
+}
+
+TEST(TimerServiceTest, InvalidResolution) {
+  timer_service::config config{};
+  config.resolution = std::chrono::nanoseconds{0};
+
+  EXPECT_THROW(timer_service{config}, std::invalid_argument);
+}
+}  // namespace
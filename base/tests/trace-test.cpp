@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <derplib/base/trace.h>
+
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+using derplib::trace_zone;
+using derplib::tracer;
+using derplib::tsc_clock;
+
+std::string trace_json() {
+  std::ostringstream oss{};
+  tracer::write_json(oss);
+  return oss.str();
+}
+
+std::size_t count_of(const std::string& str, const std::string& substr) {
+  std::size_t count{0};
+  for (auto pos{str.find(substr)}; pos != std::string::npos; pos = str.find(substr, pos + substr.size())) {
+    ++count;
+  }
+  return count;
+}
+
+TEST(TraceTest, RecordsEvents) {
+  tracer::clear();
+
+  std::thread t{[] {
+    tracer::set_thread_name("worker \"1\"");
+    trace_zone zone{"worker_zone"};
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }};
+  t.join();
+
+  {
+    trace_zone zone{"main_zone"};
+    tracer::instant("main_instant");
+  }
+
+  const auto json{trace_json()};
+  EXPECT_EQ(0U, json.find("{\"traceEvents\":["));
+  EXPECT_EQ(2U, count_of(json, "\"ph\":\"X\""));
+  EXPECT_EQ(1U, count_of(json, "\"ph\":\"i\""));
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"worker_zone\""));
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"main_zone\""));
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"main_instant\""));
+  EXPECT_NE(std::string::npos, json.find("\"args\":{\"name\":\"worker \\\"1\\\"\"}"));
+  EXPECT_EQ(0U, tracer::dropped());
+}
+
+TEST(TraceTest, CompleteEventDuration) {
+  tracer::clear();
+
+  const auto begin{tsc_clock::now()};
+  tracer::complete("fixed", begin, begin + std::chrono::microseconds{1500});
+
+  const auto json{trace_json()};
+  EXPECT_NE(std::string::npos, json.find("\"dur\":1500.000"));
+}
+
+TEST(TraceTest, Clear) {
+  tracer::instant("before_clear");
+  tracer::clear();
+
+  EXPECT_EQ(std::string::npos, trace_json().find("before_clear"));
+
+  tracer::instant("after_clear");
+  const auto json{trace_json()};
+  EXPECT_EQ(std::string::npos, json.find("before_clear"));
+  EXPECT_NE(std::string::npos, json.find("after_clear"));
+}
+
+TEST(TraceTest, ClearReleasesExitedThreads) {
+  tracer::clear();
+
+  std::thread t{[] {
+    tracer::set_thread_name("exited_worker");
+    tracer::instant("exited_instant");
+  }};
+  t.join();
+
+  // Events of exited threads are retained until the next clear.
+  EXPECT_NE(std::string::npos, trace_json().find("\"name\":\"exited_worker\""));
+  EXPECT_NE(std::string::npos, trace_json().find("\"name\":\"exited_instant\""));
+
+  tracer::clear();
+  tracer::set_thread_name("main");
+  const auto json{trace_json()};
+  EXPECT_EQ(std::string::npos, json.find("exited_worker"));
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"main\""));
+}
+
+TEST(TraceTest, DropsEventsWhenFull) {
+  tracer::clear();
+  tracer::set_buffer_capacity(4);
+
+  std::thread t{[] {
+    for (int i{0}; i < 10; ++i) {
+      tracer::instant("bounded");
+    }
+  }};
+  t.join();
+  tracer::set_buffer_capacity(65536);
+
+  EXPECT_EQ(4U, count_of(trace_json(), "\"name\":\"bounded\""));
+  EXPECT_EQ(6U, tracer::dropped());
+
+  EXPECT_THROW(tracer::set_buffer_capacity(0), std::invalid_argument);
+}
+
+TEST(TraceTest, ZoneMacro) {
+  tracer::clear();
+  {
+    DERPLIB_TRACE_ZONE("macro_zone");
+    DERPLIB_TRACE_INSTANT("macro_instant");
+  }
+
+  const auto json{trace_json()};
+#if defined(DERPLIB_ENABLE_TRACING)
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"macro_zone\""));
+  EXPECT_NE(std::string::npos, json.find("\"name\":\"macro_instant\""));
+#else
+  EXPECT_EQ(std::string::npos, json.find("macro_zone"));
+  EXPECT_EQ(std::string::npos, json.find("macro_instant"));
+#endif  // defined(DERPLIB_ENABLE_TRACING)
+}
+}  // namespace
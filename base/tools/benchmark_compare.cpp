@@ -0,0 +1,110 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <derplib/base/benchmark_report.h>
+
+namespace {
+constexpr int ExitNoRegression = 0;
+constexpr int ExitRegression = 1;
+constexpr int ExitError = 2;
+
+void _print_usage(const char* program) {
+  std::cerr << "Usage: " << program << " [--threshold=<percent>] [--alpha=<p>] <baseline.json> <contender.json>\n"
+            << "\n"
+            << "Compares two benchmark result files written with --json, and exits with " << ExitRegression
+            << " if any benchmark regressed.\n"
+            << "\n"
+            << "  --threshold=<percent>  minimum change in median time to report (default: 5)\n"
+            << "  --alpha=<p>            significance level of the Mann-Whitney U test (default: 0.05)\n";
+}
+
+/**
+ * \return Whether `str` is a non-negative number, in which case `value` is set to its value.
+ */
+bool _parse_double(const std::string& str, double& value) {
+  char* end{nullptr};
+  value = std::strtod(str.c_str(), &end);
+  return !str.empty() && end == str.c_str() + str.size() && value >= 0.0;
+}
+
+/**
+ * \brief Reads a benchmark result file, printing an error if it cannot be read.
+ */
+bool _read_report(const std::string& path, derplib::benchmark_report& report) {
+  std::ifstream ifs{path};
+  if (!ifs) {
+    std::cerr << "Cannot open " << path << '\n';
+    return false;
+  }
+
+  try {
+    report = derplib::read_benchmark_json(ifs);
+  } catch (const derplib::benchmark_format_error& e) {
+    std::cerr << "Cannot read " << path << ": " << e.what() << '\n';
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Warns if the results were produced in different contexts, which makes the comparison less meaningful.
+ */
+void _check_context(const derplib::benchmark_context& baseline, const derplib::benchmark_context& contender) {
+  if (baseline.cpu_model != contender.cpu_model || baseline.cpu_count != contender.cpu_count) {
+    std::cerr << "Warning: results were produced on different CPUs (" << baseline.cpu_model << " x"
+              << baseline.cpu_count << " vs " << contender.cpu_model << " x" << contender.cpu_count << ")\n";
+  }
+  if (baseline.build_type != contender.build_type) {
+    std::cerr << "Warning: results were produced by different build types (" << baseline.build_type << " vs "
+              << contender.build_type << ")\n";
+  }
+  if (baseline.build_type == "debug" || contender.build_type == "debug") {
+    std::cerr << "Warning: results were produced by a debug build\n";
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  derplib::benchmark_compare_config cfg{};
+  std::string paths[2]{};
+  int path_count{0};
+
+  for (int i{1}; i < argc; ++i) {
+    const std::string arg{argv[i]};
+    double value{0.0};
+
+    if (arg.compare(0, 12, "--threshold=") == 0 && _parse_double(arg.substr(12), value)) {
+      cfg.threshold = value / 100.0;
+    } else if (arg.compare(0, 8, "--alpha=") == 0 && _parse_double(arg.substr(8), value) && value <= 1.0) {
+      cfg.alpha = value;
+    } else if (arg.compare(0, 2, "--") != 0 && path_count < 2) {
+      paths[path_count++] = arg;
+    } else {
+      _print_usage(argv[0]);
+      return ExitError;
+    }
+  }
+  if (path_count != 2) {
+    _print_usage(argv[0]);
+    return ExitError;
+  }
+
+  derplib::benchmark_report baseline{};
+  derplib::benchmark_report contender{};
+  if (!_read_report(paths[0], baseline) || !_read_report(paths[1], contender)) {
+    return ExitError;
+  }
+  _check_context(baseline.context, contender.context);
+
+  const auto comparisons{derplib::compare_benchmarks(baseline, contender, cfg)};
+  derplib::print_benchmark_comparisons(std::cout, comparisons);
+
+  for (const auto& comparison : comparisons) {
+    if (comparison.verdict == derplib::benchmark_verdict::regressed) {
+      return ExitRegression;
+    }
+  }
+  return ExitNoRegression;
+}
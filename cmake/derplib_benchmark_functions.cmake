@@ -0,0 +1,28 @@
+# Adds a benchmark executable named "derplib_$name-benchmark" with derplib::$name as a library dependency.
+#
+# The benchmarks are registered using DERPLIB_BENCHMARK from <derplib/base/benchmark.h>, and a main function which runs
+# all registered benchmarks and supports writing the results as JSON is generated.
+#
+# Benchmark executables are also added as dependencies of the derplib_benchmarks target. Configure with
+# CMAKE_BUILD_TYPE=Release to obtain meaningful timings.
+#
+# This function will do nothing if ${DERPLIB_BUILD_BENCHMARKS} is set to OFF.
+#
+# Usage: derplib_add_benchmark(name SOURCES srcs... LINK_DEPS lib_deps...)
+function(derplib_add_benchmark benchname)
+    if (${DERPLIB_BUILD_BENCHMARKS})
+        set(multiValueArgs SOURCES LINK_DEPS)
+        cmake_parse_arguments(DERPLIB_BENCHMARK "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
+
+        set(DERPLIB_BENCHMARK_MAIN ${CMAKE_CURRENT_BINARY_DIR}/derplib_${benchname}-benchmark_main.cpp)
+        file(GENERATE
+                OUTPUT ${DERPLIB_BENCHMARK_MAIN}
+                CONTENT "#include <derplib/base/benchmark_report.h>\n\nDERPLIB_BENCHMARK_JSON_MAIN()\n")
+
+        derplib_add_executable(derplib_${benchname}-benchmark ${DERPLIB_BENCHMARK_SOURCES} ${DERPLIB_BENCHMARK_MAIN})
+        target_link_libraries(derplib_${benchname}-benchmark
+                derplib::${benchname} derplib::base ${DERPLIB_BENCHMARK_LINK_DEPS})
+
+        add_dependencies(derplib_benchmarks derplib_${benchname}-benchmark)
+    endif (${DERPLIB_BUILD_BENCHMARKS})
+endfunction()
@@ -0,0 +1,27 @@
+#include <derplib/base/benchmark.h>
+#include <derplib/container/circular_queue.h>
+
+namespace {
+DERPLIB_BENCHMARK(circular_queue_push_pop) {
+  derplib::circular_queue<int, 1024> q{};
+  int value{0};
+  state.measure([&] {
+    q.push(value++);
+    derplib::do_not_optimize(q.front());
+    q.pop();
+  });
+}
+
+DERPLIB_BENCHMARK(circular_queue_fill_drain) {
+  derplib::circular_queue<int, 1024> q{};
+  state.measure([&] {
+    for (int i{0}; i < 1024; ++i) {
+      q.push(i);
+    }
+    derplib::clobber_memory();
+    while (!q.empty()) {
+      q.pop();
+    }
+  });
+}
+}  // namespace
@@ -1,13 +1,27 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <limits>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <stdexcept>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <derplib/base/trace.h>
+#include <derplib/internal/cpu_relax.h>
+#include <derplib/internal/eventcount.h>
+#include <derplib/internal/log2_histogram.h>
+#include <derplib/internal/mpsc_ring.h>
 #include <derplib/stdext/type_traits.h>
 
 namespace derplib {
@@ -18,6 +32,9 @@ inline namespace container {
  *
  * See \ref cfq_parallel_consumer<InT, ConsumerT>.
  *
+ * If `DERPLIB_ENABLE_TRACING` is defined, every added element is recorded as an instant trace event, and every
+ * consumed element as a trace event spanning the call to the consumer. See \ref tracer.
+ *
  * \tparam InT The type of the elements to be processed.
  * \tparam ConsumerT The type of the functor to process the elements. Must have a prototype of
  * `void f(InT)`.
@@ -37,17 +54,198 @@ class cfq_parallel_consumer<InT, ConsumerT> {
    */
   using consumer_type = ConsumerT;
 
+  /**
+   * \brief Distribution of durations.
+   *
+   * Bucket `0` counts durations of zero nanoseconds, and bucket `i` counts durations in the range
+   * `[2^(i-1), 2^i)` nanoseconds.
+   */
+  using latency_histogram = std::array<std::uint64_t, 64>;
+
+  /**
+   * \brief Implementation of the buffer owned by each consumer.
+   */
+  enum struct inbox_type {
+    /**
+     * \brief An unbounded `std::deque` guarded by a mutex.
+     */
+    locked,
+    /**
+     * \brief A bounded lock-free ring. Producers never take a lock, and the consumer only parks when it finds its
+     * buffer empty. Pushing into a full buffer blocks until space is available.
+     *
+     * The move constructor of the element type must not throw.
+     */
+    lock_free
+  };
+
+  /**
+   * \brief Order in which a consumer drains its priority lanes.
+   */
+  enum struct lane_policy {
+    /**
+     * \brief Always consumes from the non-empty lane with the highest priority.
+     */
+    strict,
+    /**
+     * \brief Visits the non-empty lanes in turn, consuming up to the weight of each lane before moving to the next.
+     */
+    weighted_round_robin
+  };
+
+  /**
+   * \brief Consumer configuration.
+   */
+  struct config {
+    /**
+     * \brief Whether to record the queueing and processing latency of each element.
+     *
+     * Recording the latency requires reading the clock once when an element is added, and twice when an element is
+     * consumed, so it is disabled by default to keep the push path free of clock reads.
+     */
+    bool record_latency = false;
+    /**
+     * \brief Implementation of the buffer owned by each consumer.
+     */
+    inbox_type inbox = inbox_type::locked;
+    /**
+     * \brief Capacity of the buffer owned by each consumer. Only used by `inbox_type::lock_free`, and rounded up to the
+     * next power of two.
+     */
+    std::size_t inbox_capacity = 1024;
+    /**
+     * \brief Number of priority lanes in the buffer of each consumer. Must be at least `1`.
+     *
+     * Lane `0` has the highest priority. Elements which are added without a priority are added to the lane with the
+     * lowest priority.
+     */
+    std::size_t lanes = 1;
+    /**
+     * \brief Order in which a consumer drains its priority lanes.
+     */
+    lane_policy policy = lane_policy::strict;
+    /**
+     * \brief Weight of each lane under `lane_policy::weighted_round_robin`.
+     *
+     * Lanes without a weight, or with a weight of `0`, have a weight of `1`.
+     */
+    std::vector<std::size_t> lane_weights;
+    /**
+     * \brief Maximum time an idle consumer busy-waits for a new element before yielding.
+     *
+     * Busy-waiting avoids the cost of parking and waking the consumer thread when elements arrive in quick succession,
+     * at the cost of keeping a processor busy while idle. A value of `0` disables busy-waiting.
+     */
+    std::chrono::nanoseconds spin_time{0};
+    /**
+     * \brief Number of times an idle consumer yields its time slice after busy-waiting, before parking.
+     */
+    std::size_t yield_count = 0;
+    /**
+     * \brief Whether to adapt the busy-wait time to the observed time between elements.
+     *
+     * If `true`, each consumer tracks the average time it stays idle, and only busy-waits for up to twice that time,
+     * capped to `spin_time`. Consumers whose idle periods are usually longer than `spin_time` skip busy-waiting.
+     */
+    bool adaptive_spin = false;
+    /**
+     * \brief Hash of the coalescing key of an element.
+     *
+     * Setting this function enables coalescing: when an element is added while another element with the same key is
+     * waiting in the same priority lane, the two elements are combined using `coalesce_combine` instead of being
+     * consumed separately. Elements are routed to a consumer by the hash of their key rather than by load, so that
+     * elements with the same key always meet in the same buffer.
+     *
+     * Coalescing requires `inbox_type::locked`.
+     */
+    std::function<std::size_t(const stdext::decay_t<InT>&)> coalesce_hash;
+    /**
+     * \brief Returns whether two elements have the same coalescing key.
+     *
+     * If empty, elements with the same hash are considered to have the same key.
+     */
+    std::function<bool(const stdext::decay_t<InT>&, const stdext::decay_t<InT>&)> coalesce_equal;
+    /**
+     * \brief Combines a newly-added element into a waiting element with the same key.
+     *
+     * The first argument is the waiting element, and the second argument is the newly-added element. If empty, the
+     * waiting element is replaced by the newly-added element.
+     */
+    std::function<void(stdext::decay_t<InT>&, stdext::decay_t<InT>&&)> coalesce_combine;
+
+    /**
+     * \brief Enables coalescing by a key extracted from each element.
+     *
+     * Sets `coalesce_hash` and `coalesce_equal` to hash and compare the extracted keys using `std::hash` and
+     * `operator==`.
+     *
+     * \tparam KeyFn Type of the key extractor. Must have a prototype of `K f(const InT&)`.
+     * \param key_of Function which returns the coalescing key of an element.
+     */
+    template<typename KeyFn>
+    void coalesce_by(KeyFn key_of) {
+      using key_type = stdext::decay_t<decltype(key_of(std::declval<const stdext::decay_t<InT>&>()))>;
+
+      coalesce_hash = [key_of](const stdext::decay_t<InT>& value) { return std::hash<key_type>{}(key_of(value)); };
+      coalesce_equal = [key_of](const stdext::decay_t<InT>& lhs, const stdext::decay_t<InT>& rhs) {
+        return key_of(lhs) == key_of(rhs);
+      };
+    }
+  };
+
+  /**
+   * \brief Statistics of a single consumer thread.
+   */
+  struct worker_stats {
+    /**
+     * \brief Number of elements which have been added to the buffer of this consumer.
+     */
+    std::uint64_t enqueued;
+    /**
+     * \brief Number of elements which have been consumed by this consumer.
+     */
+    std::uint64_t processed;
+    /**
+     * \brief Number of added elements which have been combined into a waiting element instead of being buffered.
+     */
+    std::uint64_t coalesced;
+    /**
+     * \brief Number of elements currently in the buffer of this consumer.
+     */
+    std::size_t depth;
+    /**
+     * \brief Total time spent in the consumer function.
+     *
+     * Only populated if `config::record_latency` is `true`.
+     */
+    std::chrono::nanoseconds busy_time;
+    /**
+     * \brief Distribution of the time between an element being added and its consumption being started.
+     *
+     * Only populated if `config::record_latency` is `true`.
+     */
+    latency_histogram queue_latency;
+    /**
+     * \brief Distribution of the time spent by the consumer function on each element.
+     *
+     * Only populated if `config::record_latency` is `true`.
+     */
+    latency_histogram processing_latency;
+  };
+
   /**
    * \param concurrency Number of concurrent consumers.
    * \param consumer Consumer function.
+   * \param cfg Configuration of the consumer.
    */
-  cfq_parallel_consumer(std::size_t concurrency, const consumer_type& consumer);
+  cfq_parallel_consumer(std::size_t concurrency, const consumer_type& consumer, const config& cfg = {});
 
   /**
    * \param concurrency Number of concurrent consumers.
    * \param consumer Consumer function.
+   * \param cfg Configuration of the consumer.
    */
-  cfq_parallel_consumer(std::size_t concurrency, consumer_type&& consumer);
+  cfq_parallel_consumer(std::size_t concurrency, consumer_type&& consumer, const config& cfg = {});
 
   cfq_parallel_consumer(const cfq_parallel_consumer&) = delete;
   cfq_parallel_consumer(cfq_parallel_consumer&&) noexcept = delete;
@@ -55,6 +253,11 @@ class cfq_parallel_consumer<InT, ConsumerT> {
   cfq_parallel_consumer& operator=(const cfq_parallel_consumer&) = delete;
   cfq_parallel_consumer& operator=(cfq_parallel_consumer&&) noexcept = delete;
 
+  /**
+   * \brief Destructor.
+   *
+   * Drains all buffered elements before stopping the consumer threads.
+   */
   ~cfq_parallel_consumer();
 
   /**
@@ -86,49 +289,388 @@ class cfq_parallel_consumer<InT, ConsumerT> {
   template<typename... Args>
   void emplace(Args&&... args);
 
+  /**
+   * \brief Adds an element to the back of a priority lane.
+   *
+   * The new element is initialized as a copy of `value`.
+   *
+   * \param priority The priority lane to append to, where `0` is the highest priority.
+   * \param value The value of the element to append.
+   * \throw std::out_of_range if `priority` is not less than `config::lanes`.
+   */
+  void push(std::size_t priority, const stdext::decay_t<InT>& value);
+
+  /**
+   * \brief Adds an element to the back of a priority lane.
+   *
+   * `value` is moved into the new element.
+   *
+   * \param priority The priority lane to append to, where `0` is the highest priority.
+   * \param value The value of the element to append.
+   * \throw std::out_of_range if `priority` is not less than `config::lanes`.
+   */
+  void push(std::size_t priority, stdext::decay_t<InT>&& value);
+
+  /**
+   * \brief Constructs an element in-place at the back of a priority lane.
+   *
+   * \tparam Args Argument types of the element constructor.
+   * \param priority The priority lane to append to, where `0` is the highest priority.
+   * \param args Arguments to forward to the constructor of the element.
+   * \throw std::out_of_range if `priority` is not less than `config::lanes`.
+   */
+  template<typename... Args>
+  void emplace_priority(std::size_t priority, Args&&... args);
+
+  /**
+   * \brief Waits until all elements which are added before this call have been consumed.
+   *
+   * Elements which are added while this function is blocking are not waited for.
+   */
+  void flush();
+
+  /**
+   * \brief Waits until all elements which are added before this call have been consumed, or until `timeout` has
+   * elapsed.
+   *
+   * \tparam Rep an arithmetic type representing the number of ticks
+   * \tparam Period a `std::ratio` representing the tick period
+   * \param timeout maximum duration to block for
+   * \return `true` if all elements have been consumed, `false` if the timeout has expired.
+   */
+  template<typename Rep, typename Period>
+  bool wait_idle(std::chrono::duration<Rep, Period> timeout);
+
+  /**
+   * \brief Retrieves the statistics of all consumers.
+   *
+   * Counters are read without synchronizing with the consumers, so the values of different counters may be slightly
+   * out of sync with each other.
+   *
+   * \return Statistics of each consumer, indexed by the consumer.
+   */
+  std::vector<worker_stats> snapshot() const;
+
  private:
+  using _clock = std::chrono::steady_clock;
+
+  /**
+   * \brief An element in the buffer.
+   */
+  struct _entry {
+    template<typename... Args>
+    explicit _entry(const _clock::time_point enqueue_time, Args&&... args) :
+        _value(std::forward<Args>(args)...), _enqueue_time{enqueue_time} {}
+
+    stdext::decay_t<InT> _value;
+    _clock::time_point _enqueue_time;
+  };
+
+  /**
+   * \brief Counters which are only modified by a single consumer thread.
+   */
+  struct _worker_counters {
+    /**
+     * \brief Number of elements whose consumer invocation has returned.
+     */
+    std::atomic<std::uint64_t> _processed{0};
+    /**
+     * \brief Total time spent in the consumer function, in nanoseconds.
+     */
+    std::atomic<std::uint64_t> _busy_ns{0};
+    /**
+     * \brief Number of added elements which have been combined into a waiting element. Modified by producers while
+     * holding the mutex of the consumer.
+     */
+    std::atomic<std::uint64_t> _coalesced{0};
+
+    internal::_log2_histogram<std::tuple_size<latency_histogram>::value> _queue_latency;
+    internal::_log2_histogram<std::tuple_size<latency_histogram>::value> _processing_latency;
+  };
+
+  /**
+   * \brief Position of a consumer in its round-robin visit of the priority lanes.
+   */
+  struct _lane_cursor {
+    std::size_t _lane;
+    std::size_t _credits;
+  };
+
+  /**
+   * \brief Idle tracking state of a consumer thread.
+   */
+  struct _idle_state {
+    /**
+     * \brief Time at which the consumer became idle, or the epoch if the consumer is not idle.
+     */
+    _clock::time_point _since;
+    /**
+     * \brief Exponentially-weighted moving average of the duration of idle periods, in nanoseconds.
+     */
+    std::int64_t _average_ns;
+  };
+
   /**
-   * \brief Daemon method for consuming the elements in the buffer.
+   * \brief Daemon method for consuming the elements in a `inbox_type::locked` buffer.
    *
    * \param i The index of the thread.
    */
   void _daemon(std::size_t i);
 
+  /**
+   * \brief Daemon method for consuming the elements in a `inbox_type::lock_free` buffer.
+   *
+   * \param i The index of the thread.
+   */
+  void _lock_free_daemon(std::size_t i);
+
+  /**
+   * \brief Invokes the consumer on an element and updates the counters of the consumer thread.
+   *
+   * \param i The index of the thread.
+   * \param entry The element to consume.
+   */
+  void _consume(std::size_t i, _entry&& entry);
+
+  /**
+   * \brief Allocates the buffers and starts the consumer threads.
+   */
+  void _start();
+
+  /**
+   * \brief Adds an element to a priority lane of the least-loaded consumer.
+   *
+   * \tparam Args Argument types of the element constructor.
+   * \param lane The priority lane to append to.
+   * \param args Arguments to forward to the constructor of the element.
+   */
+  template<typename... Args>
+  void _emplace(std::size_t lane, Args&&... args);
+
+  /**
+   * \brief Adds an element to a priority lane of the consumer selected by its coalescing key, or combines it into a
+   * waiting element with the same key.
+   *
+   * \param lane The priority lane to append to.
+   * \param enqueue_time The time at which the element is added.
+   * \param value The element to add.
+   */
+  void _emplace_coalescing(std::size_t lane, _clock::time_point enqueue_time, stdext::decay_t<InT>&& value);
+
+  /**
+   * \brief Removes the front element of a buffer from `_coalesce_index_`. Must be called while holding the mutex of the
+   * consumer, before the element is popped.
+   *
+   * \param buffer The index of the buffer.
+   */
+  void _unindex_front(std::size_t buffer);
+
+  /**
+   * \return Whether coalescing is enabled.
+   */
+  bool _is_coalescing() const { return static_cast<bool>(_config_.coalesce_hash); }
+
+  /**
+   * \brief Selects the next priority lane to consume from according to `config::policy`.
+   *
+   * \tparam IsNonEmpty Type of the predicate. Must have a prototype of `bool f(std::size_t)`.
+   * \param cursor The round-robin position of the consumer.
+   * \param is_non_empty Predicate which returns whether the given lane has an element to consume.
+   * \return The index of the lane, or `_lanes` if all lanes are empty.
+   */
+  template<typename IsNonEmpty>
+  std::size_t _next_lane(_lane_cursor& cursor, IsNonEmpty is_non_empty) const;
+
+  /**
+   * \return Whether idle consumers busy-wait or yield before parking.
+   */
+  bool _is_spin_enabled() const { return _config_.spin_time.count() > 0 || _config_.yield_count > 0; }
+
+  /**
+   * \brief Busy-waits and then yields according to `config::spin_time` and `config::yield_count`, until `is_ready`
+   * returns `true`.
+   *
+   * \tparam Predicate Type of the predicate. Must have a prototype of `bool f()`.
+   * \param idle The idle tracking state of the consumer.
+   * \param is_ready Predicate which returns whether the consumer has an element to consume or is stopping.
+   */
+  template<typename Predicate>
+  void _spin_wait(_idle_state& idle, Predicate is_ready) const;
+
+  /**
+   * \brief Marks the end of an idle period of a consumer, if any, and updates its average idle time.
+   *
+   * \param idle The idle tracking state of the consumer.
+   */
+  void _end_idle(_idle_state& idle) const;
+
+  /**
+   * \param lane The index of the lane.
+   * \return The weight of the lane under `lane_policy::weighted_round_robin`.
+   */
+  std::size_t _lane_weight(std::size_t lane) const;
+
+  /**
+   * \param i The index of the consumer.
+   * \param lane The index of the lane.
+   * \return The ring of the given lane of the consumer.
+   */
+  internal::_mpsc_ring<_entry>& _ring(std::size_t i, std::size_t lane) const { return *_rings_[i * _lanes + lane]; }
+
+  /**
+   * \return The index of the consumer with the least number of outstanding elements.
+   */
+  std::size_t _select_buffer() const;
+
+  /**
+   * \param i The index of the consumer.
+   * \return The approximate number of elements which are buffered or being consumed by the consumer.
+   */
+  std::size_t _outstanding(std::size_t i) const;
+
+  /**
+   * \brief Estimates the number of elements in the buffer of a consumer without taking its lock.
+   *
+   * \param i The index of the consumer.
+   * \return The approximate number of elements in the buffer.
+   */
+  std::size_t _buffer_size(std::size_t i) const;
+
+  /**
+   * \param i The index of the consumer.
+   * \return The number of elements which have been added to the buffer of the consumer.
+   */
+  std::size_t _enqueued(std::size_t i) const;
+
+  /**
+   * \brief Computes the number of elements each consumer has to consume before all currently-buffered elements are
+   * processed.
+   *
+   * \return The target number of consumed elements for each consumer.
+   */
+  std::vector<std::size_t> _flush_targets();
+
+  /**
+   * \param targets target number of consumed elements for each consumer, as returned by `_flush_targets()`
+   * \return Whether all consumers have reached their target.
+   */
+  bool _is_flushed(const std::vector<std::size_t>& targets) const;
+
+  /**
+   * \param begin start of the duration
+   * \param end end of the duration
+   * \return Number of nanoseconds between `begin` and `end`.
+   */
+  static std::uint64_t _elapsed_ns(_clock::time_point begin, _clock::time_point end);
+
   consumer_type _consumer_ = nullptr;
+  const config _config_;
+  const std::size_t _lanes;
 
   std::atomic_bool _keep_alive_;
 
-  std::vector<std::deque<stdext::decay_t<InT>>> _buffers_;
+  /**
+   * \brief Priority lanes of each consumer. The buffer of lane `l` of consumer `i` is at index `i * _lanes + l`.
+   */
+  std::vector<std::deque<_entry>> _buffers_;
   std::vector<std::thread> _threads_;
-  std::vector<std::mutex> _mutexes_;
+  mutable std::vector<std::mutex> _mutexes_;
   std::vector<std::condition_variable> _cvs_;
+
+  /**
+   * \brief Buffers used by `inbox_type::lock_free`, in place of `_buffers_`, `_mutexes_` and `_cvs_`.
+   *
+   * Lanes are laid out in the same way as `_buffers_`.
+   */
+  std::vector<std::unique_ptr<internal::_mpsc_ring<_entry>>> _rings_;
+  /**
+   * \brief Notified when an element is added to the rings of each consumer.
+   */
+  std::vector<internal::_eventcount> _eventcounts_;
+  /**
+   * \brief Notified when each consumer removes an element from its rings.
+   */
+  std::vector<internal::_eventcount> _not_full_;
+
+  /**
+   * \brief Number of elements added to all lanes of each consumer. Only used by `inbox_type::locked`.
+   *
+   * Only modified while holding the corresponding mutex in `_mutexes_`, but may be read without it to estimate the size
+   * of the buffer.
+   */
+  std::vector<std::atomic_size_t> _enqueued_;
+  /**
+   * \brief Number of elements removed from all lanes of each consumer. Only used by `inbox_type::locked`.
+   *
+   * Only modified while holding the corresponding mutex in `_mutexes_`, but may be read without it to estimate the size
+   * of the buffer.
+   */
+  std::vector<std::atomic_size_t> _dequeued_;
+  /**
+   * \brief Index from the hash of the coalescing key to the position of each element in `_buffers_`. Only used when
+   * coalescing.
+   *
+   * Positions are absolute, meaning that the element at position `p` is at index `p - _popped_[b]` of buffer `b`, so
+   * that popping an element does not invalidate the positions of other elements.
+   */
+  std::vector<std::unordered_multimap<std::size_t, std::size_t>> _coalesce_index_;
+  /**
+   * \brief Number of elements popped from each buffer in `_buffers_`. Only used when coalescing.
+   */
+  std::vector<std::size_t> _popped_;
+  /**
+   * \brief Counters updated by each consumer thread.
+   *
+   * `flush()` snapshots the number of enqueued elements of each consumer, and waits until
+   * `_worker_counters::_processed` catches up.
+   */
+  std::vector<_worker_counters> _counters_;
+
+  std::atomic_size_t _flush_waiters_;
+  std::mutex _flush_mutex_;
+  std::condition_variable _flush_cv_;
 };
 
 template<typename InT, typename ConsumerT>
 cfq_parallel_consumer<InT, ConsumerT>::cfq_parallel_consumer(const std::size_t concurrency,
-                                                             const consumer_type& consumer) :
+                                                             const consumer_type& consumer,
+                                                             const config& cfg) :
     _consumer_(consumer),
+    _config_(cfg),
+    _lanes{cfg.lanes},
     _keep_alive_{true},
-    _buffers_{concurrency},
+    _buffers_(concurrency * cfg.lanes),
     _threads_{concurrency},
     _mutexes_{concurrency},
-    _cvs_{concurrency} {
-  for (std::size_t i{0}; i < _threads_.size(); ++i) {
-    _threads_[i] = std::thread{&cfq_parallel_consumer::_daemon, this, i};
-  }
+    _cvs_{concurrency},
+    _eventcounts_(cfg.inbox == inbox_type::lock_free ? concurrency : 0),
+    _not_full_(cfg.inbox == inbox_type::lock_free ? concurrency : 0),
+    _enqueued_(concurrency),
+    _dequeued_(concurrency),
+    _counters_(concurrency),
+    _flush_waiters_{0} {
+  _start();
 }
 
 template<typename InT, typename ConsumerT>
-cfq_parallel_consumer<InT, ConsumerT>::cfq_parallel_consumer(const std::size_t concurrency, consumer_type&& consumer) :
+cfq_parallel_consumer<InT, ConsumerT>::cfq_parallel_consumer(const std::size_t concurrency,
+                                                             consumer_type&& consumer,
+                                                             const config& cfg) :
     _consumer_(consumer),
+    _config_(cfg),
+    _lanes{cfg.lanes},
     _keep_alive_{true},
-    _buffers_{concurrency},
+    _buffers_(concurrency * cfg.lanes),
     _threads_{concurrency},
     _mutexes_{concurrency},
-    _cvs_{concurrency} {
-  for (std::size_t i{0}; i < _threads_.size(); ++i) {
-    _threads_[i] = std::thread{&cfq_parallel_consumer::_daemon, this, i};
-  }
+    _cvs_{concurrency},
+    _eventcounts_(cfg.inbox == inbox_type::lock_free ? concurrency : 0),
+    _not_full_(cfg.inbox == inbox_type::lock_free ? concurrency : 0),
+    _enqueued_(concurrency),
+    _dequeued_(concurrency),
+    _counters_(concurrency),
+    _flush_waiters_{0} {
+  _start();
 }
 
 template<typename InT, typename ConsumerT>
@@ -138,6 +680,9 @@ cfq_parallel_consumer<InT, ConsumerT>::~cfq_parallel_consumer() {
   for (auto& cv : _cvs_) {
     cv.notify_all();
   }
+  for (auto& eventcount : _eventcounts_) {
+    eventcount._notify_all();
+  }
 
   for (auto& thread : _threads_) {
     if (thread.joinable()) {
@@ -148,81 +693,490 @@ cfq_parallel_consumer<InT, ConsumerT>::~cfq_parallel_consumer() {
 
 template<typename InT, typename ConsumerT>
 void cfq_parallel_consumer<InT, ConsumerT>::push(const stdext::decay_t<InT>& value) {
-  std::size_t it{std::numeric_limits<std::size_t>::max()};
+  _emplace(_lanes - 1, value);
+}
 
-  for (std::size_t i{0}, n{std::numeric_limits<std::size_t>::max()}; i < _buffers_.size(); ++i) {
-    std::size_t size{_buffers_[i].size()};
-    if (n > size) {
-      it = i;
-      n = size;
+template<typename InT, typename ConsumerT>
+void cfq_parallel_consumer<InT, ConsumerT>::push(stdext::decay_t<InT>&& value) {
+  _emplace(_lanes - 1, std::move(value));
+}
+
+template<typename InT, typename ConsumerT>
+template<typename... Args>
+void cfq_parallel_consumer<InT, ConsumerT>::emplace(Args&&... args) {
+  _emplace(_lanes - 1, std::forward<Args>(args)...);
+}
+
+template<typename InT, typename ConsumerT>
+void cfq_parallel_consumer<InT, ConsumerT>::push(const std::size_t priority, const stdext::decay_t<InT>& value) {
+  emplace_priority(priority, value);
+}
+
+template<typename InT, typename ConsumerT>
+void cfq_parallel_consumer<InT, ConsumerT>::push(const std::size_t priority, stdext::decay_t<InT>&& value) {
+  emplace_priority(priority, std::move(value));
+}
+
+template<typename InT, typename ConsumerT>
+template<typename... Args>
+void cfq_parallel_consumer<InT, ConsumerT>::emplace_priority(const std::size_t priority, Args&&... args) {
+  if (priority >= _lanes) {
+    throw std::out_of_range{"emplace_priority(): priority out of range"};
+  }
+
+  _emplace(priority, std::forward<Args>(args)...);
+}
+
+template<typename InT, typename ConsumerT>
+void cfq_parallel_consumer<InT, ConsumerT>::flush() {
+  const std::vector<std::size_t> targets{_flush_targets()};
+
+  ++_flush_waiters_;
+  {
+    std::unique_lock<std::mutex> lk{_flush_mutex_};
+    _flush_cv_.wait(lk, [&] { return _is_flushed(targets); });
+  }
+  --_flush_waiters_;
+}
+
+template<typename InT, typename ConsumerT>
+template<typename Rep, typename Period>
+bool cfq_parallel_consumer<InT, ConsumerT>::wait_idle(const std::chrono::duration<Rep, Period> timeout) {
+  const auto deadline{_clock::now() + timeout};
+  const std::vector<std::size_t> targets{_flush_targets()};
+
+  bool is_flushed;
+  ++_flush_waiters_;
+  {
+    std::unique_lock<std::mutex> lk{_flush_mutex_};
+    is_flushed = _flush_cv_.wait_until(lk, deadline, [&] { return _is_flushed(targets); });
+  }
+  --_flush_waiters_;
+
+  return is_flushed;
+}
+
+template<typename InT, typename ConsumerT>
+std::vector<typename cfq_parallel_consumer<InT, ConsumerT>::worker_stats>
+cfq_parallel_consumer<InT, ConsumerT>::snapshot() const {
+  std::vector<worker_stats> stats(_threads_.size());
+
+  for (std::size_t i{0}; i < _threads_.size(); ++i) {
+    if (_config_.inbox == inbox_type::lock_free) {
+      stats[i].enqueued = _enqueued(i);
+      stats[i].depth = _buffer_size(i);
+    } else {
+      std::lock_guard<std::mutex> lk{_mutexes_[i]};
+      stats[i].enqueued = _enqueued(i);
+      stats[i].depth = _buffer_size(i);
     }
+
+    const _worker_counters& counters{_counters_[i]};
+    stats[i].processed = counters._processed.load(std::memory_order_relaxed);
+    stats[i].coalesced = counters._coalesced.load(std::memory_order_relaxed);
+    stats[i].busy_time = std::chrono::nanoseconds{counters._busy_ns.load(std::memory_order_relaxed)};
+    stats[i].queue_latency = counters._queue_latency._snapshot();
+    stats[i].processing_latency = counters._processing_latency._snapshot();
+  }
+
+  return stats;
+}
+
+template<typename InT, typename ConsumerT>
+void cfq_parallel_consumer<InT, ConsumerT>::_start() {
+  if (_lanes == 0) {
+    throw std::invalid_argument{"cfq_parallel_consumer must have at least one lane"};
+  }
+  if (_is_coalescing() && _config_.inbox != inbox_type::locked) {
+    throw std::invalid_argument{"cfq_parallel_consumer coalescing requires inbox_type::locked"};
+  }
+
+  if (_is_coalescing()) {
+    _coalesce_index_.resize(_buffers_.size());
+    _popped_.resize(_buffers_.size());
+  }
+
+  for (std::size_t i{0}; i < _threads_.size(); ++i) {
+    _enqueued_[i].store(0, std::memory_order_relaxed);
+    _dequeued_[i].store(0, std::memory_order_relaxed);
+  }
+
+  if (_config_.inbox == inbox_type::lock_free) {
+    _rings_.reserve(_threads_.size() * _lanes);
+    for (std::size_t i{0}; i < _threads_.size() * _lanes; ++i) {
+      _rings_.emplace_back(new internal::_mpsc_ring<_entry>{_config_.inbox_capacity});
+    }
+
+    for (std::size_t i{0}; i < _threads_.size(); ++i) {
+      _threads_[i] = std::thread{&cfq_parallel_consumer::_lock_free_daemon, this, i};
+    }
+  } else {
+    for (std::size_t i{0}; i < _threads_.size(); ++i) {
+      _threads_[i] = std::thread{&cfq_parallel_consumer::_daemon, this, i};
+    }
+  }
+}
+
+template<typename InT, typename ConsumerT>
+template<typename... Args>
+void cfq_parallel_consumer<InT, ConsumerT>::_emplace(const std::size_t lane, Args&&... args) {
+  DERPLIB_TRACE_INSTANT("cfq_parallel_consumer::enqueue");
+  const _clock::time_point enqueue_time{_config_.record_latency ? _clock::now() : _clock::time_point{}};
+
+  if (_is_coalescing()) {
+    _emplace_coalescing(lane, enqueue_time, stdext::decay_t<InT>(std::forward<Args>(args)...));
+    return;
+  }
+
+  std::size_t it{_select_buffer()};
+
+  if (_config_.inbox == inbox_type::lock_free) {
+    _entry entry{enqueue_time, std::forward<Args>(args)...};
+    while (!_ring(it, lane)._try_push(std::move(entry))) {
+      // The least-loaded consumer is full, so wait until it removes an element instead of retrying immediately.
+      const internal::_eventcount::_key_type key{_not_full_[it]._prepare_wait()};
+      if (_ring(it, lane)._try_push(std::move(entry))) {
+        _not_full_[it]._cancel_wait();
+        break;
+      }
+
+      _not_full_[it]._wait(key);
+      it = _select_buffer();
+    }
+
+    _eventcounts_[it]._notify_all();
+    return;
   }
 
   {
     std::lock_guard<std::mutex> lk{_mutexes_[it]};
-    _buffers_[it].push_back(value);
+    _buffers_[it * _lanes + lane].emplace_back(enqueue_time, std::forward<Args>(args)...);
+    _enqueued_[it].fetch_add(1, std::memory_order_relaxed);
   }
 
   _cvs_[it].notify_one();
 }
 
 template<typename InT, typename ConsumerT>
-void cfq_parallel_consumer<InT, ConsumerT>::push(stdext::decay_t<InT>&& value) {
-  std::size_t it{std::numeric_limits<std::size_t>::max()};
+void cfq_parallel_consumer<InT, ConsumerT>::_emplace_coalescing(const std::size_t lane,
+                                                                const _clock::time_point enqueue_time,
+                                                                stdext::decay_t<InT>&& value) {
+  const std::size_t hash{_config_.coalesce_hash(value)};
+  const std::size_t it{hash % _threads_.size()};
+  const std::size_t b{it * _lanes + lane};
 
-  for (std::size_t i{0}, n{std::numeric_limits<std::size_t>::max()}; i < _buffers_.size(); ++i) {
-    std::size_t size{_buffers_[i].size()};
-    if (n > size) {
-      it = i;
-      n = size;
+  {
+    std::lock_guard<std::mutex> lk{_mutexes_[it]};
+    std::deque<_entry>& buffer{_buffers_[b]};
+
+    const auto range{_coalesce_index_[b].equal_range(hash)};
+    for (auto entry_it{range.first}; entry_it != range.second; ++entry_it) {
+      _entry& pending{buffer[entry_it->second - _popped_[b]]};
+      if (_config_.coalesce_equal && !_config_.coalesce_equal(pending._value, value)) {
+        continue;
+      }
+
+      if (_config_.coalesce_combine) {
+        _config_.coalesce_combine(pending._value, std::move(value));
+      } else {
+        pending._value = std::move(value);
+      }
+      _counters_[it]._coalesced.fetch_add(1, std::memory_order_relaxed);
+      return;
     }
-  }
 
-  {
-    std::unique_lock<std::mutex> lk{_mutexes_[it]};
-    _buffers_[it].push_back(value);
+    buffer.emplace_back(enqueue_time, std::move(value));
+    _coalesce_index_[b].emplace(hash, _popped_[b] + buffer.size() - 1);
+    _enqueued_[it].fetch_add(1, std::memory_order_relaxed);
   }
 
   _cvs_[it].notify_one();
 }
 
 template<typename InT, typename ConsumerT>
-template<typename... Args>
-void cfq_parallel_consumer<InT, ConsumerT>::emplace(Args&&... args) {
+void cfq_parallel_consumer<InT, ConsumerT>::_unindex_front(const std::size_t buffer) {
+  const std::size_t position{_popped_[buffer]++};
+  const auto range{_coalesce_index_[buffer].equal_range(_config_.coalesce_hash(_buffers_[buffer].front()._value))};
+
+  for (auto it{range.first}; it != range.second; ++it) {
+    if (it->second == position) {
+      _coalesce_index_[buffer].erase(it);
+      return;
+    }
+  }
+}
+
+template<typename InT, typename ConsumerT>
+template<typename IsNonEmpty>
+std::size_t cfq_parallel_consumer<InT, ConsumerT>::_next_lane(_lane_cursor& cursor, IsNonEmpty is_non_empty) const {
+  if (_config_.policy == lane_policy::strict) {
+    for (std::size_t lane{0}; lane < _lanes; ++lane) {
+      if (is_non_empty(lane)) {
+        return lane;
+      }
+    }
+    return _lanes;
+  }
+
+  // Visit each lane at most once, starting from the current lane if it still has credits.
+  for (std::size_t visited{0}; visited <= _lanes; ++visited) {
+    if (cursor._credits != 0 && is_non_empty(cursor._lane)) {
+      --cursor._credits;
+      return cursor._lane;
+    }
+
+    cursor._lane = cursor._lane + 1 < _lanes ? cursor._lane + 1 : 0;
+    cursor._credits = _lane_weight(cursor._lane);
+  }
+  return _lanes;
+}
+
+template<typename InT, typename ConsumerT>
+template<typename Predicate>
+void cfq_parallel_consumer<InT, ConsumerT>::_spin_wait(_idle_state& idle, Predicate is_ready) const {
+  // Clock reads are amortized over this many iterations of the busy-wait.
+  constexpr std::size_t clock_interval{64};
+
+  const _clock::time_point now{_clock::now()};
+  if (idle._since == _clock::time_point{}) {
+    idle._since = now;
+  }
+
+  std::chrono::nanoseconds budget{_config_.spin_time};
+  if (_config_.adaptive_spin) {
+    // Busy-waiting only pays off if an element is likely to arrive before the budget runs out.
+    budget = idle._average_ns > budget.count() ? std::chrono::nanoseconds{0}
+                                               : std::min(budget, std::chrono::nanoseconds{2 * idle._average_ns});
+  }
+
+  if (budget.count() > 0) {
+    const _clock::time_point deadline{now + budget};
+    for (std::size_t n{1};; ++n) {
+      if (is_ready()) {
+        return;
+      }
+      if (n % clock_interval == 0 && _clock::now() >= deadline) {
+        break;
+      }
+      internal::_cpu_relax();
+    }
+  }
+
+  for (std::size_t n{0}; n < _config_.yield_count; ++n) {
+    if (is_ready()) {
+      return;
+    }
+    std::this_thread::yield();
+  }
+}
+
+template<typename InT, typename ConsumerT>
+void cfq_parallel_consumer<InT, ConsumerT>::_end_idle(_idle_state& idle) const {
+  if (idle._since == _clock::time_point{}) {
+    return;
+  }
+
+  const auto idle_ns{static_cast<std::int64_t>(_elapsed_ns(idle._since, _clock::now()))};
+  idle._average_ns += (idle_ns - idle._average_ns) / 8;
+  idle._since = _clock::time_point{};
+}
+
+template<typename InT, typename ConsumerT>
+std::size_t cfq_parallel_consumer<InT, ConsumerT>::_lane_weight(const std::size_t lane) const {
+  if (lane < _config_.lane_weights.size() && _config_.lane_weights[lane] != 0) {
+    return _config_.lane_weights[lane];
+  }
+  return 1;
+}
+
+template<typename InT, typename ConsumerT>
+std::size_t cfq_parallel_consumer<InT, ConsumerT>::_select_buffer() const {
   std::size_t it{std::numeric_limits<std::size_t>::max()};
 
-  for (std::size_t i{0}, n{std::numeric_limits<std::size_t>::max()}; i < _buffers_.size(); ++i) {
-    std::size_t size{_buffers_[i].size()};
+  for (std::size_t i{0}, n{std::numeric_limits<std::size_t>::max()}; i < _threads_.size(); ++i) {
+    std::size_t size{_outstanding(i)};
     if (n > size) {
       it = i;
       n = size;
     }
   }
 
-  {
-    std::lock_guard<std::mutex> lk{_mutexes_[it]};
-    _buffers_[it].emplace_back(std::forward<Args>(args)...);
+  return it;
+}
+
+template<typename InT, typename ConsumerT>
+std::size_t cfq_parallel_consumer<InT, ConsumerT>::_outstanding(const std::size_t i) const {
+  const auto processed{static_cast<std::size_t>(_counters_[i]._processed.load(std::memory_order_relaxed))};
+  const std::size_t enqueued{_enqueued(i)};
+  return enqueued > processed ? enqueued - processed : 0;
+}
+
+template<typename InT, typename ConsumerT>
+std::size_t cfq_parallel_consumer<InT, ConsumerT>::_buffer_size(const std::size_t i) const {
+  if (_config_.inbox == inbox_type::lock_free) {
+    std::size_t size{0};
+    for (std::size_t lane{0}; lane < _lanes; ++lane) {
+      size += _ring(i, lane)._size();
+    }
+    return size;
   }
 
-  _cvs_[it].notify_one();
+  const std::size_t dequeued{_dequeued_[i].load(std::memory_order_relaxed)};
+  const std::size_t enqueued{_enqueued_[i].load(std::memory_order_relaxed)};
+  return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+template<typename InT, typename ConsumerT>
+std::size_t cfq_parallel_consumer<InT, ConsumerT>::_enqueued(const std::size_t i) const {
+  if (_config_.inbox == inbox_type::lock_free) {
+    std::size_t enqueued{0};
+    for (std::size_t lane{0}; lane < _lanes; ++lane) {
+      enqueued += _ring(i, lane)._enqueued();
+    }
+    return enqueued;
+  }
+
+  return _enqueued_[i].load(std::memory_order_relaxed);
+}
+
+template<typename InT, typename ConsumerT>
+std::vector<std::size_t> cfq_parallel_consumer<InT, ConsumerT>::_flush_targets() {
+  std::vector<std::size_t> targets(_threads_.size());
+
+  for (std::size_t i{0}; i < _threads_.size(); ++i) {
+    if (_config_.inbox == inbox_type::lock_free) {
+      targets[i] = _enqueued(i);
+    } else {
+      std::lock_guard<std::mutex> lk{_mutexes_[i]};
+      targets[i] = _enqueued(i);
+    }
+  }
+
+  return targets;
+}
+
+template<typename InT, typename ConsumerT>
+bool cfq_parallel_consumer<InT, ConsumerT>::_is_flushed(const std::vector<std::size_t>& targets) const {
+  for (std::size_t i{0}; i < targets.size(); ++i) {
+    if (_counters_[i]._processed < targets[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template<typename InT, typename ConsumerT>
+std::uint64_t cfq_parallel_consumer<InT, ConsumerT>::_elapsed_ns(const _clock::time_point begin,
+                                                                 const _clock::time_point end) {
+  const auto ns{std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()};
+  return ns > 0 ? static_cast<std::uint64_t>(ns) : 0;
 }
 
 template<typename InT, typename ConsumerT>
 void cfq_parallel_consumer<InT, ConsumerT>::_daemon(size_t i) {
-  while (_keep_alive_ || !_buffers_[i].empty()) {
-    {
-      std::unique_lock<std::mutex> lk{_mutexes_[i]};
-      _cvs_[i].wait(lk, [&] { return !_keep_alive_ || !_buffers_[i].empty(); });
+  _lane_cursor cursor{_lanes - 1, 0};
+  _idle_state idle{_clock::time_point{}, _config_.spin_time.count() / 2};
+  const auto is_non_empty{[&](const std::size_t lane) { return !_buffers_[i * _lanes + lane].empty(); }};
+  const auto is_ready{[&] { return !_keep_alive_ || _buffer_size(i) != 0; }};
 
-      if (!_keep_alive_ && _buffers_[i].empty()) {
-        break;
+  while (true) {
+    if (_is_spin_enabled() && !is_ready()) {
+      _spin_wait(idle, is_ready);
+    }
+
+    std::unique_lock<std::mutex> lk{_mutexes_[i]};
+    _cvs_[i].wait(lk, is_ready);
+
+    if (_buffer_size(i) == 0) {
+      break;
+    }
+
+    const std::size_t b{i * _lanes + _next_lane(cursor, is_non_empty)};
+    if (_is_coalescing()) {
+      _unindex_front(b);
+    }
+
+    std::deque<_entry>& buffer{_buffers_[b]};
+    _entry entry{std::move(buffer.front())};
+    buffer.pop_front();
+    _dequeued_[i].fetch_add(1, std::memory_order_relaxed);
+    lk.unlock();
+
+    if (_config_.adaptive_spin) {
+      _end_idle(idle);
+    }
+    _consume(i, std::move(entry));
+  }
+}
+
+template<typename InT, typename ConsumerT>
+void cfq_parallel_consumer<InT, ConsumerT>::_lock_free_daemon(size_t i) {
+  internal::_eventcount& eventcount{_eventcounts_[i]};
+
+  _lane_cursor cursor{_lanes - 1, 0};
+  _idle_state idle{_clock::time_point{}, _config_.spin_time.count() / 2};
+  const auto is_non_empty{[&](const std::size_t lane) { return _ring(i, lane)._front() != nullptr; }};
+
+  while (true) {
+    std::size_t lane{_next_lane(cursor, is_non_empty)};
+
+    if (lane == _lanes && _is_spin_enabled() && _keep_alive_) {
+      _spin_wait(idle, [&] { return !_keep_alive_ || _buffer_size(i) != 0; });
+      lane = _next_lane(cursor, is_non_empty);
+    }
+
+    if (lane == _lanes) {
+      const internal::_eventcount::_key_type key{eventcount._prepare_wait()};
+
+      lane = _next_lane(cursor, is_non_empty);
+      if (lane == _lanes) {
+        if (!_keep_alive_ && _buffer_size(i) == 0) {
+          eventcount._cancel_wait();
+          break;
+        }
+
+        eventcount._wait(key);
+        continue;
       }
 
-      _consumer_(_buffers_[i].front());
-      _buffers_[i].pop_front();
+      eventcount._cancel_wait();
+    }
+
+    internal::_mpsc_ring<_entry>& ring{_ring(i, lane)};
+    _entry entry{std::move(*ring._front())};
+    ring._pop();
+    _not_full_[i]._notify_all();
+
+    if (_config_.adaptive_spin) {
+      _end_idle(idle);
     }
+    _consume(i, std::move(entry));
+  }
+}
+
+template<typename InT, typename ConsumerT>
+void cfq_parallel_consumer<InT, ConsumerT>::_consume(const std::size_t i, _entry&& entry) {
+  DERPLIB_TRACE_ZONE("cfq_parallel_consumer::consume");
+  _worker_counters& counters{_counters_[i]};
+
+  if (_config_.record_latency) {
+    const _clock::time_point start_time{_clock::now()};
+    _consumer_(std::move(entry._value));
+    const _clock::time_point end_time{_clock::now()};
+
+    const std::uint64_t processing_ns{_elapsed_ns(start_time, end_time)};
+    counters._queue_latency._record(_elapsed_ns(entry._enqueue_time, start_time));
+    counters._processing_latency._record(processing_ns);
+    counters._busy_ns.fetch_add(processing_ns, std::memory_order_relaxed);
+  } else {
+    _consumer_(std::move(entry._value));
+  }
 
-    _cvs_[i].notify_one();
+  ++counters._processed;
+  if (_flush_waiters_ != 0) {
+    std::lock_guard<std::mutex> flush_lk{_flush_mutex_};
+    _flush_cv_.notify_all();
   }
 }
 
@@ -0,0 +1,528 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <derplib/container/cfq_parallel_consumer.h>
+#include <derplib/stdext/memory.h>
+#include <derplib/stdext/type_traits.h>
+
+namespace derplib {
+inline namespace container {
+
+/**
+ * \brief Order in which a pipeline stage hands its results to the next stage.
+ */
+enum struct stage_order {
+  /**
+   * \brief Results are handed off as soon as they are available.
+   */
+  unordered,
+  /**
+   * \brief Results are handed off in the order which their inputs are pushed into the pipeline. For the last stage, the
+   * consumer function is invoked in this order, meaning that the last stage does not execute in parallel.
+   */
+  ordered
+};
+
+template<typename InT>
+class pipeline;
+
+template<typename InT, typename OutT>
+class pipeline_builder;
+
+}  // namespace container
+
+namespace internal {
+
+/**
+ * \brief A group of elements which is handed off between pipeline stages as a unit.
+ */
+template<typename T>
+struct _pipeline_batch {
+  /**
+   * \brief Position of this batch in the pipeline input.
+   */
+  std::uint64_t _sequence;
+  std::vector<T> _items;
+};
+
+/**
+ * \brief Type of the consumer executing a stage with input type `T`.
+ */
+template<typename T>
+using _pipeline_consumer = cfq_parallel_consumer<_pipeline_batch<T>, std::function<void(_pipeline_batch<T>)>>;
+
+/**
+ * \brief Function which hands a batch to the next stage.
+ */
+template<typename T>
+using _pipeline_outlet = std::function<void(_pipeline_batch<T>&&)>;
+
+/**
+ * \brief Releases batches in the order of their sequence numbers.
+ *
+ * Only one thread releases batches at a time, and it does so without holding the lock of this buffer, so that handing
+ * a batch to a full stage does not block threads which only hold a batch that is out of sequence.
+ */
+template<typename T>
+class _pipeline_reorder_buffer {
+ public:
+  /**
+   * \brief Releases `batch` and all consecutive batches after it if `batch` is the next batch in sequence, otherwise
+   * holds `batch` until its predecessors have been released.
+   *
+   * If another thread is releasing batches, waits until it has released every batch which is ready, so that a stage
+   * whose results cannot be handed off stops consuming its inputs.
+   *
+   * \param batch the batch to release
+   * \param release function to invoke on each released batch. Invoked by one thread at a time, in sequence order.
+   */
+  template<typename ReleaseFn>
+  void _submit(_pipeline_batch<T>&& batch, ReleaseFn release) {
+    std::unique_lock<std::mutex> lk{_mutex_};
+    const std::uint64_t sequence{batch._sequence};
+    _pending_.emplace(sequence, std::move(batch));
+
+    if (_is_releasing_) {
+      // The releasing thread collects batches under the lock, so it will release this batch if it becomes ready.
+      _released_cv_.wait(lk, [this] { return !_is_releasing_; });
+      return;
+    }
+
+    _is_releasing_ = true;
+    std::vector<_pipeline_batch<T>> ready{};
+    while (true) {
+      for (auto it{_pending_.begin()}; it != _pending_.end() && it->first == _next_sequence_;
+           it = _pending_.erase(it)) {
+        ready.push_back(std::move(it->second));
+        ++_next_sequence_;
+      }
+      if (ready.empty()) {
+        break;
+      }
+
+      lk.unlock();
+      for (auto& ready_batch : ready) {
+        release(std::move(ready_batch));
+      }
+      ready.clear();
+      lk.lock();
+    }
+
+    _is_releasing_ = false;
+    lk.unlock();
+    _released_cv_.notify_all();
+  }
+
+ private:
+  std::mutex _mutex_;
+  std::condition_variable _released_cv_;
+  /**
+   * \brief Whether a thread is releasing batches. Guarded by `_mutex_`.
+   */
+  bool _is_releasing_ = false;
+  std::uint64_t _next_sequence_ = 0;
+  std::map<std::uint64_t, _pipeline_batch<T>> _pending_;
+};
+
+/**
+ * \brief Type-erased pipeline stage.
+ */
+class _pipeline_stage_base {
+ public:
+  virtual ~_pipeline_stage_base() = default;
+
+  /**
+   * \brief Waits until all batches which are pushed into this stage before this call have been handed off.
+   */
+  virtual void _flush() = 0;
+};
+
+/**
+ * \brief A pipeline stage which transforms each element and hands the result to the next stage.
+ */
+template<typename InT, typename OutT>
+class _pipeline_stage final : public _pipeline_stage_base {
+ public:
+  using _consumer_type = _pipeline_consumer<InT>;
+
+  _pipeline_stage(const std::size_t concurrency,
+                  std::function<OutT(InT)>&& function,
+                  const stage_order order,
+                  const typename _consumer_type::config& config) :
+      _function_{std::move(function)},
+      _order{order},
+      _outlet_{std::make_shared<_pipeline_outlet<OutT>>()},
+      _consumer_{concurrency, [this](_pipeline_batch<InT> batch) { _process(std::move(batch)); }, config} {}
+
+  void _push(_pipeline_batch<InT>&& batch) { _consumer_.push(std::move(batch)); }
+
+  void _flush() final { _consumer_.flush(); }
+
+  /**
+   * \return Slot for the function which hands batches to the next stage.
+   */
+  const std::shared_ptr<_pipeline_outlet<OutT>>& _outlet() const { return _outlet_; }
+
+ private:
+  void _process(_pipeline_batch<InT>&& in) {
+    _pipeline_batch<OutT> out{in._sequence, {}};
+    out._items.reserve(in._items.size());
+    for (auto& item : in._items) {
+      out._items.push_back(_function_(std::move(item)));
+    }
+
+    if (_order == stage_order::ordered) {
+      _reorder_buffer_._submit(std::move(out),
+                               [this](_pipeline_batch<OutT>&& batch) { (*_outlet_)(std::move(batch)); });
+    } else {
+      (*_outlet_)(std::move(out));
+    }
+  }
+
+  std::function<OutT(InT)> _function_;
+  const stage_order _order;
+  std::shared_ptr<_pipeline_outlet<OutT>> _outlet_;
+  _pipeline_reorder_buffer<OutT> _reorder_buffer_;
+
+  // Declared last so that the consumer threads are started after, and stopped before, the other members.
+  _consumer_type _consumer_;
+};
+
+/**
+ * \brief The last stage of a pipeline, which consumes each element.
+ */
+template<typename InT>
+class _pipeline_sink final : public _pipeline_stage_base {
+ public:
+  using _consumer_type = _pipeline_consumer<InT>;
+
+  _pipeline_sink(const std::size_t concurrency,
+                 std::function<void(InT)>&& function,
+                 const stage_order order,
+                 const typename _consumer_type::config& config) :
+      _function_{std::move(function)},
+      _order{order},
+      _consumer_{concurrency, [this](_pipeline_batch<InT> batch) { _process(std::move(batch)); }, config} {}
+
+  void _push(_pipeline_batch<InT>&& batch) { _consumer_.push(std::move(batch)); }
+
+  void _flush() final { _consumer_.flush(); }
+
+ private:
+  void _process(_pipeline_batch<InT>&& in) {
+    const auto consume{[this](_pipeline_batch<InT>&& batch) {
+      for (auto& item : batch._items) {
+        _function_(std::move(item));
+      }
+    }};
+
+    if (_order == stage_order::ordered) {
+      _reorder_buffer_._submit(std::move(in), consume);
+    } else {
+      consume(std::move(in));
+    }
+  }
+
+  std::function<void(InT)> _function_;
+  const stage_order _order;
+  _pipeline_reorder_buffer<InT> _reorder_buffer_;
+
+  // Declared last so that the consumer threads are started after, and stopped before, the other members.
+  _consumer_type _consumer_;
+};
+
+/**
+ * \brief Collects elements pushed into a pipeline into batches.
+ */
+template<typename InT>
+class _pipeline_inlet {
+ public:
+  _pipeline_inlet(const std::size_t batch_size, std::shared_ptr<_pipeline_outlet<InT>> outlet) :
+      _batch_size{batch_size == 0 ? 1 : batch_size}, _outlet_{std::move(outlet)} {}
+
+  template<typename... Args>
+  void _emplace(Args&&... args) {
+    std::unique_lock<std::mutex> lk{_mutex_};
+    _pending_.emplace_back(std::forward<Args>(args)...);
+    if (_pending_.size() < _batch_size) {
+      return;
+    }
+
+    _pipeline_batch<InT> batch{_next_sequence_++, std::move(_pending_)};
+    _pending_ = std::vector<InT>{};
+    _pending_.reserve(_batch_size);
+    lk.unlock();
+
+    (*_outlet_)(std::move(batch));
+  }
+
+  /**
+   * \brief Hands off the current partial batch, if any.
+   */
+  void _flush() {
+    std::unique_lock<std::mutex> lk{_mutex_};
+    if (_pending_.empty()) {
+      return;
+    }
+
+    _pipeline_batch<InT> batch{_next_sequence_++, std::move(_pending_)};
+    _pending_ = std::vector<InT>{};
+    lk.unlock();
+
+    (*_outlet_)(std::move(batch));
+  }
+
+ private:
+  const std::size_t _batch_size;
+  const std::shared_ptr<_pipeline_outlet<InT>> _outlet_;
+
+  std::mutex _mutex_;
+  std::uint64_t _next_sequence_ = 0;
+  std::vector<InT> _pending_;
+};
+
+}  // namespace internal
+
+inline namespace container {
+
+/**
+ * \brief A chain of parallel processing stages.
+ *
+ * Each stage is executed by its own `cfq_parallel_consumer`. Elements are grouped into batches when they are pushed
+ * into the pipeline, and each batch is handed from one stage to the next as a unit. The queue between two stages is
+ * bounded, so a slow stage blocks the stages before it, and ultimately `push()`. Blocked threads park until space is
+ * available instead of spinning.
+ *
+ * Pipelines are created using `make_pipeline()`.
+ *
+ * \tparam InT The type of the elements pushed into the pipeline.
+ */
+template<typename InT>
+class pipeline {
+ public:
+  /**
+   * \brief Type of elements.
+   */
+  using value_type = InT;
+
+  /**
+   * \brief Pipeline configuration.
+   */
+  struct config {
+    /**
+     * \brief Maximum number of elements in each batch.
+     */
+    std::size_t batch_size = 64;
+    /**
+     * \brief Maximum number of batches buffered by each consumer of a stage.
+     */
+    std::size_t queue_capacity = 16;
+  };
+
+  pipeline(const pipeline&) = delete;
+  pipeline(pipeline&&) noexcept = default;
+
+  pipeline& operator=(const pipeline&) = delete;
+  pipeline& operator=(pipeline&&) noexcept = delete;
+
+  /**
+   * \brief Destructor.
+   *
+   * Drains all pushed elements through the pipeline before stopping the stages.
+   */
+  ~pipeline();
+
+  /**
+   * \brief Pushes a copy of `value` into the pipeline.
+   *
+   * The element is handed to the first stage once a full batch has been collected, or when `flush()` is called.
+   *
+   * \param value The value of the element to push.
+   */
+  void push(const InT& value) { _inlet_->_emplace(value); }
+
+  /**
+   * \brief Pushes `value` into the pipeline.
+   *
+   * The element is handed to the first stage once a full batch has been collected, or when `flush()` is called.
+   *
+   * \param value The value of the element to push.
+   */
+  void push(InT&& value) { _inlet_->_emplace(std::move(value)); }
+
+  /**
+   * \brief Waits until all elements which are pushed before this call have been consumed by the last stage.
+   */
+  void flush();
+
+ private:
+  template<typename, typename>
+  friend class pipeline_builder;
+
+  pipeline(std::unique_ptr<internal::_pipeline_inlet<InT>>&& inlet,
+           std::vector<std::unique_ptr<internal::_pipeline_stage_base>>&& stages) :
+      _inlet_{std::move(inlet)}, _stages_{std::move(stages)} {}
+
+  std::unique_ptr<internal::_pipeline_inlet<InT>> _inlet_;
+  std::vector<std::unique_ptr<internal::_pipeline_stage_base>> _stages_;
+};
+
+/**
+ * \brief Builder for `pipeline`.
+ *
+ * \tparam InT The type of the elements pushed into the pipeline.
+ * \tparam OutT The type of the elements produced by the last stage added so far.
+ */
+template<typename InT, typename OutT>
+class pipeline_builder {
+ public:
+  pipeline_builder(const pipeline_builder&) = delete;
+  pipeline_builder(pipeline_builder&&) noexcept = default;
+
+  pipeline_builder& operator=(const pipeline_builder&) = delete;
+  pipeline_builder& operator=(pipeline_builder&&) noexcept = default;
+
+  /**
+   * \brief Appends a transforming stage.
+   *
+   * \tparam Fn The type of the functor. Must have a prototype of `R f(OutT)`.
+   * \param concurrency Number of concurrent consumers of this stage.
+   * \param function Function which produces the input of the next stage.
+   * \param order Order in which the results are handed to the next stage.
+   * \return Builder with the new stage appended.
+   */
+  template<typename Fn, typename R = stdext::decay_t<decltype(std::declval<Fn&>()(std::declval<OutT>()))>>
+  pipeline_builder<InT, R> stage(std::size_t concurrency, Fn function, stage_order order = stage_order::unordered) &&;
+
+  /**
+   * \brief Appends the last stage and creates the pipeline.
+   *
+   * \tparam Fn The type of the functor. Must have a prototype of `void f(OutT)`.
+   * \param concurrency Number of concurrent consumers of this stage.
+   * \param function Function which consumes the results of the previous stage.
+   * \param order Order in which `function` is invoked on the results.
+   * \return The pipeline.
+   */
+  template<typename Fn>
+  pipeline<InT> sink(std::size_t concurrency, Fn function, stage_order order = stage_order::unordered) &&;
+
+ private:
+  template<typename, typename>
+  friend class pipeline_builder;
+
+  template<typename T>
+  friend pipeline_builder<T, T> make_pipeline(const typename pipeline<T>::config& config);
+
+  pipeline_builder(const typename pipeline<InT>::config& config,
+                   std::unique_ptr<internal::_pipeline_inlet<InT>>&& inlet,
+                   std::vector<std::unique_ptr<internal::_pipeline_stage_base>>&& stages,
+                   std::shared_ptr<internal::_pipeline_outlet<OutT>> outlet) :
+      _config_(config), _inlet_{std::move(inlet)}, _stages_{std::move(stages)}, _outlet_{std::move(outlet)} {}
+
+  /**
+   * \return Configuration of the consumers executing each stage.
+   */
+  template<typename T>
+  typename internal::_pipeline_consumer<T>::config _stage_config() const;
+
+  typename pipeline<InT>::config _config_;
+  std::unique_ptr<internal::_pipeline_inlet<InT>> _inlet_;
+  std::vector<std::unique_ptr<internal::_pipeline_stage_base>> _stages_;
+
+  /**
+   * \brief Slot for the function which hands batches from the last stage to the stage appended next.
+   */
+  std::shared_ptr<internal::_pipeline_outlet<OutT>> _outlet_;
+};
+
+/**
+ * \brief Starts building a pipeline.
+ *
+ * \tparam InT The type of the elements pushed into the pipeline.
+ * \param config Configuration of the pipeline.
+ * \return Builder of a pipeline without any stages.
+ */
+template<typename InT>
+pipeline_builder<InT, InT> make_pipeline(const typename pipeline<InT>::config& config = {}) {
+  auto outlet{std::make_shared<internal::_pipeline_outlet<InT>>()};
+  auto inlet{stdext::make_unique<internal::_pipeline_inlet<InT>>(config.batch_size, outlet)};
+
+  return pipeline_builder<InT, InT>{config, std::move(inlet), {}, std::move(outlet)};
+}
+
+template<typename InT>
+pipeline<InT>::~pipeline() {
+  if (_inlet_ == nullptr) {
+    return;
+  }
+
+  flush();
+
+  // Stop the stages from front to back, so that each stage can drain into the stage after it.
+  for (auto& stage : _stages_) {
+    stage.reset();
+  }
+}
+
+template<typename InT>
+void pipeline<InT>::flush() {
+  _inlet_->_flush();
+
+  for (const auto& stage : _stages_) {
+    stage->_flush();
+  }
+}
+
+template<typename InT, typename OutT>
+template<typename Fn, typename R>
+pipeline_builder<InT, R>
+pipeline_builder<InT, OutT>::stage(const std::size_t concurrency, Fn function, const stage_order order) && {
+  using stage_type = internal::_pipeline_stage<OutT, R>;
+
+  auto stage{stdext::make_unique<stage_type>(
+      concurrency, std::function<R(OutT)>{std::move(function)}, order, _stage_config<OutT>())};
+  stage_type* const stage_ptr{stage.get()};
+  *_outlet_ = [stage_ptr](internal::_pipeline_batch<OutT>&& batch) { stage_ptr->_push(std::move(batch)); };
+
+  auto outlet{stage->_outlet()};
+  _stages_.emplace_back(std::move(stage));
+
+  return pipeline_builder<InT, R>{_config_, std::move(_inlet_), std::move(_stages_), std::move(outlet)};
+}
+
+template<typename InT, typename OutT>
+template<typename Fn>
+pipeline<InT>
+pipeline_builder<InT, OutT>::sink(const std::size_t concurrency, Fn function, const stage_order order) && {
+  using stage_type = internal::_pipeline_sink<OutT>;
+
+  auto stage{stdext::make_unique<stage_type>(
+      concurrency, std::function<void(OutT)>{std::move(function)}, order, _stage_config<OutT>())};
+  stage_type* const stage_ptr{stage.get()};
+  *_outlet_ = [stage_ptr](internal::_pipeline_batch<OutT>&& batch) { stage_ptr->_push(std::move(batch)); };
+
+  _stages_.emplace_back(std::move(stage));
+
+  return pipeline<InT>{std::move(_inlet_), std::move(_stages_)};
+}
+
+template<typename InT, typename OutT>
+template<typename T>
+typename internal::_pipeline_consumer<T>::config pipeline_builder<InT, OutT>::_stage_config() const {
+  typename internal::_pipeline_consumer<T>::config config{};
+  config.record_latency = false;
+  config.inbox = decltype(config.inbox)::lock_free;
+  config.inbox_capacity = _config_.queue_capacity;
+  return config;
+}
+
+}  // namespace container
+}  // namespace derplib
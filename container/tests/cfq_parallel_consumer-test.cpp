@@ -5,6 +5,10 @@
 #include <atomic>
 #include <chrono>
 #include <functional>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace {
 template<typename InT, typename ConsumerT = void (*)(InT)>
@@ -43,4 +47,346 @@ TEST(CFQParallelConsumerTest, CheckConcurrency) {
   }
 }
 
+TEST(CFQParallelConsumerTest, FlushConsumesPendingElements) {
+  constexpr int elements{100};
+  std::atomic_int consumed{0};
+
+  cpc<int, std::function<void(int)>> executor{4, [&](int) {
+    std::this_thread::sleep_for(std::chrono::microseconds{100});
+    ++consumed;
+  }};
+
+  for (int i{0}; i < elements; ++i) {
+    executor.push(i);
+  }
+  executor.flush();
+
+  EXPECT_EQ(elements, consumed);
+}
+
+TEST(CFQParallelConsumerTest, WaitIdleTimeout) {
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  bool is_released{false};
+
+  cpc<int, std::function<void(int)>> executor{1, [&](int) {
+    std::unique_lock<std::mutex> lk{mutex};
+    cv.wait(lk, [&] { return is_released; });
+  }};
+
+  executor.push(0);
+  EXPECT_FALSE(executor.wait_idle(std::chrono::milliseconds{10}));
+
+  {
+    std::lock_guard<std::mutex> lk{mutex};
+    is_released = true;
+  }
+  cv.notify_all();
+
+  EXPECT_TRUE(executor.wait_idle(std::chrono::seconds{10}));
+}
+
+TEST(CFQParallelConsumerTest, SnapshotCountsElements) {
+  using executor_type = cpc<int, std::function<void(int)>>;
+
+  constexpr std::uint64_t elements{64};
+
+  executor_type::config config{};
+  config.record_latency = true;
+
+  executor_type executor{2, [](int) {}, config};
+
+  for (std::uint64_t i{0}; i < elements; ++i) {
+    executor.push(0);
+  }
+  executor.flush();
+
+  std::uint64_t enqueued{0};
+  std::uint64_t processed{0};
+  std::uint64_t queue_samples{0};
+  std::uint64_t processing_samples{0};
+  for (const auto& stats : executor.snapshot()) {
+    enqueued += stats.enqueued;
+    processed += stats.processed;
+    EXPECT_EQ(0, stats.depth);
+
+    queue_samples = std::accumulate(stats.queue_latency.begin(), stats.queue_latency.end(), queue_samples);
+    processing_samples =
+        std::accumulate(stats.processing_latency.begin(), stats.processing_latency.end(), processing_samples);
+  }
+
+  EXPECT_EQ(elements, enqueued);
+  EXPECT_EQ(elements, processed);
+  EXPECT_EQ(elements, queue_samples);
+  EXPECT_EQ(elements, processing_samples);
+}
+
+TEST(CFQParallelConsumerTest, SnapshotWithoutLatency) {
+  constexpr std::uint64_t elements{64};
+
+  cpc<int, std::function<void(int)>> executor{2, [](int) {}};
+
+  for (std::uint64_t i{0}; i < elements; ++i) {
+    executor.push(0);
+  }
+  executor.flush();
+
+  std::uint64_t processed{0};
+  for (const auto& stats : executor.snapshot()) {
+    processed += stats.processed;
+    EXPECT_EQ(0, std::accumulate(stats.queue_latency.begin(), stats.queue_latency.end(), std::uint64_t{0}));
+    EXPECT_EQ(0, std::accumulate(stats.processing_latency.begin(), stats.processing_latency.end(), std::uint64_t{0}));
+    EXPECT_EQ(0, stats.busy_time.count());
+  }
+  EXPECT_EQ(elements, processed);
+}
+
+TEST(CFQParallelConsumerTest, LockFreeInbox) {
+  using executor_type = cpc<int, std::function<void(int)>>;
+
+  constexpr int producers{4};
+  constexpr int elements_per_producer{10000};
+  std::atomic_int consumed{0};
+  std::atomic_int sum{0};
+
+  executor_type::config config{};
+  config.inbox = executor_type::inbox_type::lock_free;
+  config.inbox_capacity = 64;
+
+  executor_type executor{2, [&](const int v) {
+    sum += v;
+    ++consumed;
+  }, config};
+
+  std::vector<std::thread> threads{};
+  for (int i{0}; i < producers; ++i) {
+    threads.emplace_back([&] {
+      for (int j{0}; j < elements_per_producer; ++j) {
+        executor.push(1);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  executor.flush();
+
+  EXPECT_EQ(producers * elements_per_producer, consumed);
+  EXPECT_EQ(producers * elements_per_producer, sum);
+
+  std::uint64_t enqueued{0};
+  for (const auto& stats : executor.snapshot()) {
+    enqueued += stats.enqueued;
+    EXPECT_EQ(stats.enqueued, stats.processed);
+  }
+  EXPECT_EQ(static_cast<std::uint64_t>(producers * elements_per_producer), enqueued);
+}
+
+TEST(CFQParallelConsumerTest, LockFreeInboxBlocksWhenFull) {
+  using executor_type = cpc<int, std::function<void(int)>>;
+
+  constexpr int elements{16};
+  std::atomic_bool released{false};
+  std::atomic_int consumed{0};
+  std::atomic_int pushed{0};
+
+  executor_type::config config{};
+  config.inbox = executor_type::inbox_type::lock_free;
+  config.inbox_capacity = 2;
+
+  executor_type executor{1, [&](int) {
+    while (!released) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    ++consumed;
+  }, config};
+
+  std::thread producer{[&] {
+    for (int i{0}; i < elements; ++i) {
+      executor.push(i);
+      ++pushed;
+    }
+  }};
+
+  // At most one element is being consumed and two are buffered, so the producer must be waiting for space.
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  EXPECT_LE(pushed, 3);
+  EXPECT_EQ(0, consumed);
+
+  released = true;
+  producer.join();
+  executor.flush();
+  EXPECT_EQ(elements, consumed);
+}
+
+TEST(CFQParallelConsumerTest, SpinThenParkWait) {
+  using executor_type = cpc<int, std::function<void(int)>>;
+
+  constexpr int elements{200};
+
+  for (const auto inbox : {executor_type::inbox_type::locked, executor_type::inbox_type::lock_free}) {
+    for (const bool adaptive : {false, true}) {
+      std::atomic_int consumed{0};
+
+      executor_type::config config{};
+      config.inbox = inbox;
+      config.spin_time = std::chrono::microseconds{50};
+      config.yield_count = 4;
+      config.adaptive_spin = adaptive;
+
+      executor_type executor{2, [&](int) { ++consumed; }, config};
+
+      for (int i{0}; i < elements; ++i) {
+        executor.push(i);
+        if (i % 50 == 0) {
+          // Let the consumers exhaust their spin budget and park.
+          std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+      }
+      executor.flush();
+
+      EXPECT_EQ(elements, consumed);
+    }
+  }
+}
+
+TEST(CFQParallelConsumerTest, StrictPriorityLanes) {
+  using executor_type = cpc<int, std::function<void(int)>>;
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  bool is_released{false};
+  std::vector<int> order{};
+
+  executor_type::config config{};
+  config.lanes = 2;
+
+  executor_type executor{1, [&](const int v) {
+    std::unique_lock<std::mutex> lk{mutex};
+    cv.wait(lk, [&] { return is_released; });
+    order.push_back(v);
+  }, config};
+
+  // The first element blocks the consumer until all other elements are buffered.
+  executor.push(0);
+  while (executor.snapshot().front().depth != 0) {
+    std::this_thread::yield();
+  }
+  for (int i{1}; i <= 4; ++i) {
+    executor.push(i);
+  }
+  executor.push(0, 5);
+  EXPECT_THROW(executor.push(2, 6), std::out_of_range);
+
+  {
+    std::lock_guard<std::mutex> lk{mutex};
+    is_released = true;
+  }
+  cv.notify_all();
+  executor.flush();
+
+  ASSERT_EQ(6, order.size());
+  EXPECT_EQ(5, order[1]);
+}
+
+TEST(CFQParallelConsumerTest, WeightedRoundRobinLanes) {
+  using executor_type = cpc<int, std::function<void(int)>>;
+
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  bool is_released{false};
+  std::vector<int> order{};
+
+  executor_type::config config{};
+  config.inbox = executor_type::inbox_type::lock_free;
+  config.lanes = 2;
+  config.policy = executor_type::lane_policy::weighted_round_robin;
+  config.lane_weights = {2, 1};
+
+  executor_type executor{1, [&](const int v) {
+    std::unique_lock<std::mutex> lk{mutex};
+    cv.wait(lk, [&] { return is_released; });
+    order.push_back(v);
+  }, config};
+
+  // The first element blocks the consumer until all other elements are buffered.
+  executor.push(0, -1);
+  while (executor.snapshot().front().depth != 0) {
+    std::this_thread::yield();
+  }
+  for (int i{0}; i < 3; ++i) {
+    executor.push(1, 1);
+    executor.push(0, 0);
+  }
+
+  {
+    std::lock_guard<std::mutex> lk{mutex};
+    is_released = true;
+  }
+  cv.notify_all();
+  executor.flush();
+
+  const std::vector<int> expected{-1, 0, 1, 0, 0, 1, 1};
+  EXPECT_EQ(expected, order);
+}
+
+TEST(CFQParallelConsumerTest, CoalescePendingElements) {
+  using element_type = std::pair<int, int>;
+  using executor_type = cpc<element_type, std::function<void(element_type)>>;
+
+  std::atomic_bool started{false};
+  std::atomic_bool blocked{true};
+  std::mutex mutex{};
+  std::vector<element_type> consumed{};
+
+  executor_type::config config{};
+  config.coalesce_by([](const element_type& e) { return e.first; });
+  config.coalesce_combine = [](element_type& pending, element_type&& incoming) { pending.second += incoming.second; };
+
+  executor_type executor{1, [&](const element_type e) {
+    started = true;
+    while (blocked) {
+      std::this_thread::yield();
+    }
+
+    std::lock_guard<std::mutex> lk{mutex};
+    consumed.push_back(e);
+  }, config};
+
+  // Occupy the consumer, so that the following elements stay in the buffer.
+  executor.push(element_type{-1, 0});
+  while (!started) {
+    std::this_thread::yield();
+  }
+
+  for (int i{0}; i < 100; ++i) {
+    executor.push(element_type{i % 2, 1});
+  }
+  blocked = false;
+  executor.flush();
+
+  const std::vector<element_type> expected{{-1, 0}, {0, 50}, {1, 50}};
+  EXPECT_EQ(expected, consumed);
+
+  const auto stats{executor.snapshot()};
+  EXPECT_EQ(3U, stats.front().processed);
+  EXPECT_EQ(98U, stats.front().coalesced);
+
+  // Processed elements are no longer coalesced into.
+  executor.push(element_type{0, 1});
+  executor.flush();
+  EXPECT_EQ(4U, consumed.size());
+  EXPECT_EQ((element_type{0, 1}), consumed.back());
+}
+
+TEST(CFQParallelConsumerTest, CoalesceRequiresLockedInbox) {
+  using executor_type = cpc<int, std::function<void(int)>>;
+
+  executor_type::config config{};
+  config.inbox = executor_type::inbox_type::lock_free;
+  config.coalesce_by([](const int i) { return i; });
+
+  EXPECT_THROW((executor_type{1, [](int) {}, config}), std::invalid_argument);
+}
+
 }  // namespace
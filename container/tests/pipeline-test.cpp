@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <derplib/container/pipeline.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using derplib::container::make_pipeline;
+using derplib::container::pipeline;
+using derplib::container::stage_order;
+
+TEST(PipelineTest, TransformsAllElements) {
+  constexpr int elements{1000};
+  std::atomic<long> sum{0};
+  std::atomic_int count{0};
+
+  auto p{make_pipeline<int>()
+             .stage(4, [](const int v) { return v * 2; })
+             .stage(2, [](const int v) { return std::to_string(v); })
+             .sink(2, [&](const std::string& s) {
+               sum += std::stol(s);
+               ++count;
+             })};
+
+  for (int i{0}; i < elements; ++i) {
+    p.push(i);
+  }
+  p.flush();
+
+  EXPECT_EQ(elements, count);
+  EXPECT_EQ(static_cast<long>(elements) * (elements - 1), sum);
+}
+
+TEST(PipelineTest, OrderedStagesPreserveInputOrder) {
+  constexpr int elements{500};
+  std::vector<int> output{};
+
+  pipeline<int>::config config{};
+  config.batch_size = 7;
+
+  auto p{make_pipeline<int>(config)
+             .stage(
+                 4,
+                 [](const int v) {
+                   // Make later batches finish earlier.
+                   std::this_thread::sleep_for(std::chrono::microseconds{(elements - v) % 13});
+                   return v + 1;
+                 },
+                 stage_order::ordered)
+             .sink(
+                 1, [&](const int v) { output.push_back(v); }, stage_order::ordered)};
+
+  for (int i{0}; i < elements; ++i) {
+    p.push(i);
+  }
+  p.flush();
+
+  ASSERT_EQ(static_cast<std::size_t>(elements), output.size());
+  for (int i{0}; i < elements; ++i) {
+    EXPECT_EQ(i + 1, output[i]);
+  }
+}
+
+TEST(PipelineTest, DestructorDrainsElements) {
+  constexpr int elements{100};
+  std::atomic_int count{0};
+
+  {
+    auto p{make_pipeline<int>()
+               .stage(2, [](const int v) { return v; })
+               .sink(2, [&](int) { ++count; })};
+
+    for (int i{0}; i < elements; ++i) {
+      p.push(i);
+    }
+  }
+
+  EXPECT_EQ(elements, count);
+}
+
+TEST(PipelineTest, BackpressureBoundsBufferedElements) {
+  constexpr int elements{200};
+  std::atomic_bool blocked{true};
+  std::atomic_int produced{0};
+  std::atomic_int consumed{0};
+
+  pipeline<int>::config config{};
+  config.batch_size = 1;
+  config.queue_capacity = 2;
+
+  auto p{make_pipeline<int>(config)
+             .stage(1,
+                    [&](const int v) {
+                      ++produced;
+                      return v;
+                    })
+             .sink(1, [&](int) {
+               while (blocked) {
+                 std::this_thread::yield();
+               }
+               ++consumed;
+             })};
+
+  std::thread producer{[&] {
+    for (int i{0}; i < elements; ++i) {
+      p.push(i);
+    }
+  }};
+
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  // The sink holds one element, its inbox holds at most two, and the first stage holds at most two more in its inbox
+  // plus one which it is trying to hand off.
+  EXPECT_LT(produced, elements);
+  EXPECT_EQ(0, consumed);
+
+  blocked = false;
+  producer.join();
+  p.flush();
+
+  EXPECT_EQ(elements, produced);
+  EXPECT_EQ(elements, consumed);
+}
+
+TEST(PipelineTest, OrderedStagesPreserveOrderUnderBackpressure) {
+  constexpr int elements{300};
+  std::vector<int> output{};
+
+  pipeline<int>::config config{};
+  config.batch_size = 1;
+  config.queue_capacity = 2;
+
+  auto p{make_pipeline<int>(config)
+             .stage(
+                 4,
+                 [](const int v) {
+                   std::this_thread::sleep_for(std::chrono::microseconds{(elements - v) % 7});
+                   return v;
+                 },
+                 stage_order::ordered)
+             .sink(
+                 1,
+                 [&](const int v) {
+                   // Keep the inbox of the sink full, so that the stage blocks while releasing its batches.
+                   std::this_thread::sleep_for(std::chrono::microseconds{20});
+                   output.push_back(v);
+                 },
+                 stage_order::ordered)};
+
+  for (int i{0}; i < elements; ++i) {
+    p.push(i);
+  }
+  p.flush();
+
+  ASSERT_EQ(static_cast<std::size_t>(elements), output.size());
+  for (int i{0}; i < elements; ++i) {
+    EXPECT_EQ(i, output[i]);
+  }
+}
+}  // namespace
@@ -0,0 +1,35 @@
+#include <derplib/base/benchmark.h>
+#include <derplib/experimental/heap_pool_allocator/simple_pool_allocator.h>
+
+#include <array>
+#include <cstddef>
+
+namespace {
+using derplib::experimental::simple_pool_allocator;
+
+DERPLIB_BENCHMARK(simple_pool_allocator_allocate_deallocate) {
+  simple_pool_allocator allocator{4096, {}};
+  state.measure([&] {
+    void* p{allocator.allocate(64)};
+    derplib::do_not_optimize(p);
+    allocator.deallocate(p);
+  });
+}
+
+DERPLIB_BENCHMARK(simple_pool_allocator_fragmented) {
+  constexpr std::size_t allocations{32};
+  simple_pool_allocator allocator{allocations * 128, {}};
+  std::array<void*, allocations> ptrs{};
+  state.measure([&] {
+    for (auto& p : ptrs) {
+      p = allocator.allocate(64);
+    }
+    for (std::size_t i{0}; i < allocations; i += 2) {
+      allocator.deallocate(ptrs[i]);
+    }
+    for (std::size_t i{1}; i < allocations; i += 2) {
+      allocator.deallocate(ptrs[i]);
+    }
+  });
+}
+}  // namespace
@@ -2,6 +2,8 @@
 
 #include <derplib/experimental/heap_pool_allocator/simple_pool_allocator.h>
 
+#include <array>
+
 namespace {
 using derplib::experimental::simple_pool_allocator;
 
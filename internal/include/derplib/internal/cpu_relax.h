@@ -0,0 +1,28 @@
+#pragma once
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#endif  // defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+
+namespace derplib {
+namespace internal {
+
+/**
+ * \brief Hints to the processor that the calling thread is busy-waiting.
+ *
+ * On x86, this issues a `pause` instruction, which reduces the power consumption of the spin loop and avoids the memory
+ * order mis-speculation penalty when the loop exits. On ARM, this issues a `yield` instruction. On other architectures,
+ * this does nothing.
+ */
+inline void _cpu_relax() noexcept {
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  _mm_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__i386__) || defined(__x86_64__))
+  __builtin_ia32_pause();
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__arm__) || defined(__aarch64__))
+  __asm__ __volatile__("yield");
+#endif
+}
+
+}  // namespace internal
+}  // namespace derplib
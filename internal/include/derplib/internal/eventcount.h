@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace derplib {
+namespace internal {
+
+/**
+ * \brief A condition variable for lock-free data structures.
+ *
+ * A waiting thread first announces itself with `_prepare_wait()`, re-checks its condition, and then either calls
+ * `_cancel_wait()` if the condition is satisfied or `_wait()` to park. A notifying thread first makes its change
+ * visible and then calls `_notify_all()`, which returns without any system call if no thread is waiting.
+ */
+class _eventcount {
+ public:
+  /**
+   * \brief Token returned by `_prepare_wait()`.
+   */
+  using _key_type = std::uint64_t;
+
+  _eventcount() noexcept : _epoch_{0}, _waiters_{0} {}
+
+  _eventcount(const _eventcount&) = delete;
+  _eventcount& operator=(const _eventcount&) = delete;
+
+  /**
+   * \brief Announces that the calling thread is about to wait.
+   *
+   * \return Key to pass to `_wait()`.
+   */
+  _key_type _prepare_wait() noexcept {
+    _waiters_.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return _epoch_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * \brief Withdraws an announcement made by `_prepare_wait()`.
+   */
+  void _cancel_wait() noexcept { _waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+  /**
+   * \brief Parks the calling thread until `_notify_all()` is called after the matching `_prepare_wait()`.
+   *
+   * \param key key returned by `_prepare_wait()`
+   */
+  void _wait(const _key_type key) {
+    {
+      std::unique_lock<std::mutex> lk{_mutex_};
+      _cv_.wait(lk, [&] { return _epoch_.load(std::memory_order_acquire) != key; });
+    }
+    _waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * \brief Wakes all threads which are parked or about to park.
+   */
+  void _notify_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_waiters_.load(std::memory_order_relaxed) == 0) {
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lk{_mutex_};
+      _epoch_.fetch_add(1, std::memory_order_release);
+    }
+    _cv_.notify_all();
+  }
+
+ private:
+  std::atomic<_key_type> _epoch_;
+  std::atomic<std::uint32_t> _waiters_;
+
+  std::mutex _mutex_;
+  std::condition_variable _cv_;
+};
+
+}  // namespace internal
+}  // namespace derplib
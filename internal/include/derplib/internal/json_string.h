@@ -0,0 +1,36 @@
+#pragma once
+
+#include <iomanip>
+#include <ostream>
+
+namespace derplib {
+namespace internal {
+
+/**
+ * \brief Writes a string as a quoted JSON string, escaping quotes, backslashes and control characters.
+ *
+ * \param os stream to write to
+ * \param str null-terminated string to write
+ */
+inline void _write_json_string(std::ostream& os, const char* str) {
+  const auto fill{os.fill()};
+
+  os << '"';
+  for (; *str != '\0'; ++str) {
+    const char c{*str};
+    const auto uc{static_cast<unsigned char>(c)};
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (uc < 0x20) {
+      os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<unsigned>(uc) << std::dec;
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+
+  os.fill(fill);
+}
+
+}  // namespace internal
+}  // namespace derplib
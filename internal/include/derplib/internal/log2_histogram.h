@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace derplib {
+namespace internal {
+
+/**
+ * \brief A fixed-size histogram with power-of-two buckets, which can be recorded into concurrently.
+ *
+ * Bucket `0` counts the value `0`, and bucket `i` counts values in the range `[2^(i-1), 2^i)`. Values which exceed the
+ * range of the last bucket are counted in the last bucket.
+ *
+ * All operations use relaxed atomics, meaning that a snapshot taken while values are being recorded may not reflect the
+ * most recent records.
+ *
+ * \tparam N Number of buckets.
+ */
+template<std::size_t N = 64>
+class _log2_histogram {
+ public:
+  static_assert(N > 0, "Histogram must have at least one bucket");
+
+  /**
+   * \brief Type of a snapshot of this histogram.
+   */
+  using _snapshot_type = std::array<std::uint64_t, N>;
+
+  _log2_histogram() noexcept {
+    for (auto& bucket : _buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  _log2_histogram(const _log2_histogram&) = delete;
+  _log2_histogram& operator=(const _log2_histogram&) = delete;
+
+  /**
+   * \brief Records a value into the histogram.
+   *
+   * \param value value to record
+   */
+  void _record(const std::uint64_t value) noexcept {
+    _buckets_[_bucket_of(value)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * \return The number of values recorded into each bucket.
+   */
+  _snapshot_type _snapshot() const noexcept {
+    _snapshot_type snapshot{};
+    for (std::size_t i{0}; i < N; ++i) {
+      snapshot[i] = _buckets_[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+  }
+
+  /**
+   * \param value value to look up
+   * \return The index of the bucket which `value` is recorded into.
+   */
+  static std::size_t _bucket_of(std::uint64_t value) noexcept {
+    std::size_t bucket{0};
+#if defined(__clang__) || defined(__GNUG__)
+    if (value != 0) {
+      bucket = static_cast<std::size_t>(64 - __builtin_clzll(value));
+    }
+#else
+    while (value != 0) {
+      ++bucket;
+      value >>= 1;
+    }
+#endif  // defined(__clang__) || defined(__GNUG__)
+    return bucket < N ? bucket : N - 1;
+  }
+
+ private:
+  std::array<std::atomic<std::uint64_t>, N> _buckets_;
+};
+
+}  // namespace internal
+}  // namespace derplib
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace derplib {
+namespace internal {
+
+/**
+ * \brief A bounded lock-free multi-producer single-consumer queue.
+ *
+ * Each slot carries a sequence number which tells producers and the consumer whether the slot is free or holds a
+ * published element. In the uncontended case, a push costs one compare-and-swap and one release store, and a pop costs
+ * one acquire load and one release store.
+ *
+ * Positions are never wrapped, so `_enqueued()` and `_dequeued()` double as the total number of elements pushed and
+ * popped.
+ *
+ * \tparam T Type of the stored elements. The move constructor of `T` must not throw.
+ */
+template<typename T>
+class _mpsc_ring {
+ public:
+  /**
+   * \param capacity minimum number of elements which can be stored. Rounded up to the next power of two.
+   */
+  explicit _mpsc_ring(std::size_t capacity) :
+      _mask{_round_up_pow2(capacity) - 1},
+      _cells_{new _cell[_mask + 1]},
+      _tail_{0},
+      _head_{0} {
+    for (std::size_t i{0}; i <= _mask; ++i) {
+      _cells_[i]._sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  _mpsc_ring(const _mpsc_ring&) = delete;
+  _mpsc_ring& operator=(const _mpsc_ring&) = delete;
+
+  ~_mpsc_ring() {
+    while (T* const value = _front()) {
+      (void) value;
+      _pop();
+    }
+  }
+
+  /**
+   * \brief Moves an element into the queue. May be called concurrently by multiple threads.
+   *
+   * \param value element to push. Only moved from if the push is successful.
+   * \return `true` if the element is pushed, `false` if the queue is full.
+   */
+  bool _try_push(T&& value) noexcept {
+    std::size_t pos{_tail_.load(std::memory_order_relaxed)};
+    _cell* cell;
+
+    while (true) {
+      cell = &_cells_[pos & _mask];
+      const std::size_t seq{cell->_sequence.load(std::memory_order_acquire)};
+
+      if (seq == pos) {
+        if (_tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (seq < pos) {
+        return false;
+      } else {
+        pos = _tail_.load(std::memory_order_relaxed);
+      }
+    }
+
+    ::new (static_cast<void*>(&cell->_storage)) T(std::move(value));
+    cell->_sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * \brief Retrieves the oldest published element. Must only be called by the consumer thread.
+   *
+   * \return Pointer to the oldest element, or `nullptr` if the queue is empty or the next element is not yet published.
+   */
+  T* _front() noexcept {
+    const std::size_t pos{_head_.load(std::memory_order_relaxed)};
+    _cell& cell{_cells_[pos & _mask]};
+
+    if (cell._sequence.load(std::memory_order_acquire) != pos + 1) {
+      return nullptr;
+    }
+    return reinterpret_cast<T*>(&cell._storage);
+  }
+
+  /**
+   * \brief Removes the element returned by `_front()`. Must only be called by the consumer thread.
+   */
+  void _pop() noexcept {
+    const std::size_t pos{_head_.load(std::memory_order_relaxed)};
+    _cell& cell{_cells_[pos & _mask]};
+
+    reinterpret_cast<T*>(&cell._storage)->~T();
+    cell._sequence.store(pos + _mask + 1, std::memory_order_release);
+    _head_.store(pos + 1, std::memory_order_relaxed);
+  }
+
+  /**
+   * \return Number of slots which have been claimed by producers.
+   */
+  std::size_t _enqueued() const noexcept { return _tail_.load(std::memory_order_relaxed); }
+  /**
+   * \return Number of elements which have been popped by the consumer.
+   */
+  std::size_t _dequeued() const noexcept { return _head_.load(std::memory_order_relaxed); }
+  /**
+   * \return Approximate number of elements in the queue.
+   */
+  std::size_t _size() const noexcept {
+    const std::size_t head{_dequeued()};
+    const std::size_t tail{_enqueued()};
+    return tail > head ? tail - head : 0;
+  }
+
+ private:
+  /**
+   * \brief Assumed size of a cache line, used to keep the producer and consumer positions apart.
+   */
+  static constexpr std::size_t CacheLineSize = 64;
+
+  struct _cell {
+    std::atomic<std::size_t> _sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type _storage;
+  };
+
+  static std::size_t _round_up_pow2(const std::size_t n) noexcept {
+    std::size_t capacity{1};
+    while (capacity < n) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  const std::size_t _mask;
+  const std::unique_ptr<_cell[]> _cells_;
+
+  char _producer_padding_[CacheLineSize];
+  std::atomic<std::size_t> _tail_;
+  char _consumer_padding_[CacheLineSize];
+  std::atomic<std::size_t> _head_;
+};
+
+}  // namespace internal
+}  // namespace derplib
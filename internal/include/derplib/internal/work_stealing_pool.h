@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <derplib/internal/eventcount.h>
+
+namespace derplib {
+namespace internal {
+
+/**
+ * \brief A fixed-size thread pool with a task queue per worker and work stealing.
+ *
+ * Tasks submitted by a worker are pushed to the queue of that worker. Each worker pops tasks from the back of its own
+ * queue, and steals from the front of the other queues when its own queue is empty. Tasks submitted by other threads
+ * are distributed over the queues in a round-robin fashion.
+ *
+ * Threads which wait for tasks to complete should do so using `_wait_until()`, which executes pending tasks while
+ * waiting. This allows tasks to wait for their own subtasks without exhausting the workers of the pool. Once there is
+ * nothing left to execute, waiting threads park until a task is submitted or `_notify_done()` is called, so whoever
+ * makes the predicate of a waiting thread true must call `_notify_done()` afterwards.
+ *
+ * Tasks must not throw. Use `_parallel_invoke()` or `stdext::task_group` to propagate exceptions to the waiting thread.
+ */
+class _work_stealing_pool {
+ public:
+  /**
+   * \brief Type of a task.
+   */
+  using _task_type = std::function<void()>;
+
+  /**
+   * \param concurrency number of worker threads. A value of `0` is treated as `1`.
+   */
+  explicit _work_stealing_pool(std::size_t concurrency) :
+      _queues_(concurrency == 0 ? 1 : concurrency), _keep_alive_{true}, _pending_{0}, _sleepers_{0}, _next_queue_{0} {
+    _threads_.reserve(_queues_.size());
+    for (std::size_t i{0}; i < _queues_.size(); ++i) {
+      _threads_.emplace_back(&_work_stealing_pool::_worker, this, i);
+    }
+  }
+
+  _work_stealing_pool(const _work_stealing_pool&) = delete;
+  _work_stealing_pool& operator=(const _work_stealing_pool&) = delete;
+
+  /**
+   * \brief Executes all pending tasks and stops the worker threads.
+   */
+  ~_work_stealing_pool() {
+    _keep_alive_ = false;
+    {
+      std::lock_guard<std::mutex> lk{_sleep_mutex_};
+    }
+    _sleep_cv_.notify_all();
+
+    for (auto& thread : _threads_) {
+      thread.join();
+    }
+  }
+
+  /**
+   * \return The pool shared by the library, with one worker per hardware thread.
+   */
+  static _work_stealing_pool& _default() {
+    static _work_stealing_pool pool{std::thread::hardware_concurrency()};
+    return pool;
+  }
+
+  /**
+   * \return Number of worker threads.
+   */
+  std::size_t _concurrency() const noexcept { return _queues_.size(); }
+
+  /**
+   * \brief Submits a task for execution.
+   *
+   * \param task task to execute
+   */
+  void _submit(_task_type&& task) {
+    const std::size_t self{_current_worker()};
+    const std::size_t i{self != NoWorker ? self
+                                         : _next_queue_.fetch_add(1, std::memory_order_relaxed) % _queues_.size()};
+
+    {
+      std::lock_guard<std::mutex> lk{_queues_[i]._mutex};
+      _queues_[i]._tasks.push_back(std::move(task));
+      _pending_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    if (_sleepers_.load(std::memory_order_seq_cst) != 0) {
+      {
+        std::lock_guard<std::mutex> lk{_sleep_mutex_};
+      }
+      _sleep_cv_.notify_one();
+    }
+    _progress_._notify_all();
+  }
+
+  /**
+   * \brief Wakes threads parked in `_wait_until()`, so that they re-evaluate their predicates.
+   *
+   * Must be called after making the predicate of a waiting thread true. Returns without any system call if no thread is
+   * parked.
+   */
+  void _notify_done() { _progress_._notify_all(); }
+
+  /**
+   * \brief Executes one pending task on the calling thread, if any.
+   *
+   * \return `true` if a task is executed.
+   */
+  bool _try_run_one() {
+    _task_type task;
+    if (!_try_pop(task)) {
+      return false;
+    }
+
+    task();
+    return true;
+  }
+
+  /**
+   * \brief Executes pending tasks on the calling thread until `done` returns `true`.
+   *
+   * If there is no pending task, the calling thread yields for up to `SpinRounds` rounds, and then parks until a task
+   * is submitted or `_notify_done()` is called.
+   *
+   * \tparam Predicate Type of the predicate. Must have a prototype of `bool f()`.
+   * \param done predicate which returns whether to stop waiting
+   */
+  template<typename Predicate>
+  void _wait_until(Predicate done) {
+    std::size_t idle_rounds{0};
+    while (!done()) {
+      if (_try_run_one()) {
+        idle_rounds = 0;
+        continue;
+      }
+
+      if (idle_rounds < SpinRounds) {
+        ++idle_rounds;
+        std::this_thread::yield();
+        continue;
+      }
+
+      const _eventcount::_key_type key{_progress_._prepare_wait()};
+      if (done() || _pending_.load(std::memory_order_seq_cst) != 0) {
+        _progress_._cancel_wait();
+      } else {
+        _progress_._wait(key);
+      }
+      idle_rounds = 0;
+    }
+  }
+
+  /**
+   * \brief Invokes `fn(i)` for each `i` in `[0, count)` in parallel, and waits for all invocations to return.
+   *
+   * The calling thread executes the first invocation and helps executing pending tasks while waiting.
+   *
+   * \tparam Fn Type of the function. Must have a prototype of `void f(std::size_t)`.
+   * \param count number of invocations
+   * \param fn function to invoke
+   * \throw Rethrows the first exception thrown by `fn`, after all invocations have returned.
+   */
+  template<typename Fn>
+  void _parallel_invoke(std::size_t count, Fn fn) {
+    if (count == 0) {
+      return;
+    }
+
+    std::atomic_size_t remaining{count};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    const auto run{[&](const std::size_t i) {
+      // Read the pool before decrementing, as this closure may be destroyed once the counter reaches zero.
+      _work_stealing_pool& pool{*this};
+      try {
+        fn(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lk{error_mutex};
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        pool._notify_done();
+      }
+    }};
+
+    for (std::size_t i{1}; i < count; ++i) {
+      _submit([&run, i] { run(i); });
+    }
+    run(0);
+
+    _wait_until([&] { return remaining.load(std::memory_order_acquire) == 0; });
+
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+ private:
+  /**
+   * \brief Value of `_current_worker()` for threads which are not a worker of this pool.
+   */
+  static constexpr std::size_t NoWorker = std::numeric_limits<std::size_t>::max();
+  /**
+   * \brief Number of rounds which `_wait_until()` yields without finding a task before parking.
+   */
+  static constexpr std::size_t SpinRounds = 64;
+
+  struct _queue {
+    std::mutex _mutex;
+    std::deque<_task_type> _tasks;
+  };
+
+  /**
+   * \brief Identity of the calling thread, if it is a worker of any pool.
+   */
+  struct _worker_id {
+    const _work_stealing_pool* _pool;
+    std::size_t _index;
+  };
+
+  static _worker_id& _this_thread() noexcept {
+    static thread_local _worker_id id{nullptr, NoWorker};
+    return id;
+  }
+
+  /**
+   * \return The index of the calling thread in this pool, or `NoWorker` if the calling thread is not a worker of this
+   * pool.
+   */
+  std::size_t _current_worker() const noexcept {
+    const _worker_id& id{_this_thread()};
+    if (id._pool != this) {
+      return NoWorker;
+    }
+    return id._index;
+  }
+
+  /**
+   * \brief Pops a task from the queue of the calling thread, or steals one from another queue.
+   *
+   * \param task assigned the popped task
+   * \return `true` if a task is popped.
+   */
+  bool _try_pop(_task_type& task) {
+    if (_pending_.load(std::memory_order_relaxed) == 0) {
+      return false;
+    }
+
+    const std::size_t self{_current_worker()};
+    if (self != NoWorker) {
+      _queue& queue{_queues_[self]};
+      std::lock_guard<std::mutex> lk{queue._mutex};
+      if (!queue._tasks.empty()) {
+        task = std::move(queue._tasks.back());
+        queue._tasks.pop_back();
+        _pending_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+
+    const std::size_t n{_queues_.size()};
+    const std::size_t start{self != NoWorker ? self + 1 : _next_queue_.load(std::memory_order_relaxed)};
+    for (std::size_t k{0}; k < n; ++k) {
+      _queue& queue{_queues_[(start + k) % n]};
+      std::lock_guard<std::mutex> lk{queue._mutex};
+      if (!queue._tasks.empty()) {
+        task = std::move(queue._tasks.front());
+        queue._tasks.pop_front();
+        _pending_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void _worker(const std::size_t i) {
+    _this_thread() = _worker_id{this, i};
+
+    while (true) {
+      if (_try_run_one()) {
+        continue;
+      }
+
+      _sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      {
+        std::unique_lock<std::mutex> lk{_sleep_mutex_};
+        _sleep_cv_.wait(lk, [&] { return _pending_.load(std::memory_order_seq_cst) != 0 || !_keep_alive_; });
+      }
+      _sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+      if (!_keep_alive_ && _pending_.load(std::memory_order_relaxed) == 0) {
+        break;
+      }
+    }
+  }
+
+  std::vector<_queue> _queues_;
+  std::vector<std::thread> _threads_;
+
+  std::atomic_bool _keep_alive_;
+  /**
+   * \brief Number of tasks in all queues. Only modified while holding the mutex of the modified queue.
+   */
+  std::atomic_size_t _pending_;
+  /**
+   * \brief Number of workers which are parked or about to park.
+   */
+  std::atomic_size_t _sleepers_;
+  /**
+   * \brief Round-robin position for tasks submitted by threads which are not workers.
+   */
+  std::atomic_size_t _next_queue_;
+
+  std::mutex _sleep_mutex_;
+  std::condition_variable _sleep_cv_;
+
+  /**
+   * \brief Signalled when a task is submitted or `_notify_done()` is called, to wake threads parked in `_wait_until()`.
+   */
+  _eventcount _progress_;
+};
+
+}  // namespace internal
+}  // namespace derplib
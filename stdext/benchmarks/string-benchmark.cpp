@@ -0,0 +1,20 @@
+#include <derplib/base/benchmark.h>
+#include <derplib/stdext/string.h>
+
+#include <string>
+
+namespace {
+const std::string& csv_line() {
+  static const std::string line{"alpha,beta,gamma,delta,epsilon,zeta,eta,theta,iota,kappa,lambda,mu,nu,xi,omicron"};
+  return line;
+}
+
+DERPLIB_BENCHMARK(split_string_char) {
+  state.measure([] { derplib::do_not_optimize(derplib::split_string(csv_line(), ',')); });
+}
+
+DERPLIB_BENCHMARK(split_string_string) {
+  const std::string delimiter{","};
+  state.measure([&] { derplib::do_not_optimize(derplib::split_string(csv_line(), delimiter)); });
+}
+}  // namespace
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+#include <derplib/internal/work_stealing_pool.h>
+
+namespace derplib {
+namespace internal {
+
+/**
+ * \brief Computes the number of elements processed by each task of a parallel algorithm.
+ *
+ * Chunks are sized to fit in the L1 data cache, but are made smaller if that would leave fewer than four chunks per
+ * worker, so that stealing can balance uneven workloads.
+ *
+ * \tparam T type of the elements
+ * \param n number of elements
+ * \param concurrency number of workers
+ * \return Number of elements per chunk.
+ */
+template<typename T>
+std::size_t _parallel_chunk_size(const std::size_t n, const std::size_t concurrency) {
+  constexpr std::size_t cache_size{32 * 1024};
+  constexpr std::size_t chunks_per_worker{4};
+
+  const std::size_t cache_elements{sizeof(T) < cache_size ? cache_size / sizeof(T) : 1};
+  const std::size_t chunks{concurrency * chunks_per_worker};
+  const std::size_t balanced_elements{(n + chunks - 1) / chunks};
+
+  return std::max<std::size_t>(1, std::min(cache_elements, balanced_elements));
+}
+
+/**
+ * \brief Splits a range into chunks.
+ *
+ * \tparam ForwardIt type of the iterator
+ * \param first beginning of the range
+ * \param n number of elements in the range
+ * \param chunk_size number of elements per chunk
+ * \return Boundaries of the chunks, including `first` and the end of the range.
+ */
+template<typename ForwardIt>
+std::vector<ForwardIt> _split_range(ForwardIt first, const std::size_t n, const std::size_t chunk_size) {
+  std::vector<ForwardIt> bounds{};
+  bounds.reserve((n + chunk_size - 1) / chunk_size + 1);
+
+  bounds.push_back(first);
+  for (std::size_t offset{0}; offset < n;) {
+    const std::size_t step{std::min(chunk_size, n - offset)};
+    std::advance(first, static_cast<typename std::iterator_traits<ForwardIt>::difference_type>(step));
+    offset += step;
+    bounds.push_back(first);
+  }
+
+  return bounds;
+}
+
+/**
+ * \return The iterator to the median of the three elements.
+ */
+template<typename RandomIt, typename Compare>
+RandomIt _median_of_three(const RandomIt a, const RandomIt b, const RandomIt c, Compare& comp) {
+  if (comp(*a, *b)) {
+    if (comp(*b, *c)) {
+      return b;
+    }
+    return comp(*a, *c) ? c : a;
+  }
+
+  if (comp(*a, *c)) {
+    return a;
+  }
+  return comp(*b, *c) ? c : b;
+}
+
+/**
+ * \brief Sorts a range using quicksort, sorting the two partitions of each step in parallel.
+ *
+ * \tparam RandomIt type of the iterator
+ * \tparam Compare type of the comparator
+ * \param pool pool to sort the partitions on
+ * \param first beginning of the range
+ * \param last end of the range
+ * \param comp comparator
+ * \param cutoff maximum number of elements to sort sequentially
+ * \param depth_limit maximum recursion depth before falling back to `std::sort`
+ */
+template<typename RandomIt, typename Compare>
+void _parallel_quicksort(_work_stealing_pool& pool, RandomIt first, RandomIt last, Compare comp,
+                         const std::size_t cutoff, const std::size_t depth_limit) {
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+  if (static_cast<std::size_t>(last - first) <= cutoff || depth_limit == 0) {
+    std::sort(first, last, comp);
+    return;
+  }
+
+  // Move the pivot to the front, partition the rest of the range around it, and then move it between the partitions.
+  std::iter_swap(first, _median_of_three(first, first + (last - first) / 2, last - 1, comp));
+  const RandomIt lower_end{
+      std::partition(std::next(first), last, [&](const value_type& v) { return comp(v, *first); })};
+  const RandomIt pivot{std::prev(lower_end)};
+  std::iter_swap(first, pivot);
+
+  // Elements equivalent to the pivot are already in place.
+  const RandomIt upper_begin{std::partition(lower_end, last, [&](const value_type& v) { return !comp(*pivot, v); })};
+
+  pool._parallel_invoke(2, [&](const std::size_t i) {
+    if (i == 0) {
+      _parallel_quicksort(pool, first, pivot, comp, cutoff, depth_limit - 1);
+    } else {
+      _parallel_quicksort(pool, upper_begin, last, comp, cutoff, depth_limit - 1);
+    }
+  });
+}
+
+}  // namespace internal
+
+inline namespace stdext {
+
+/**
+ * \brief Parallel version of `std::for_each`.
+ *
+ * The range is split into chunks which are processed by the worker pool shared by the library. The calling thread
+ * participates in processing the chunks.
+ *
+ * \tparam ForwardIt type of the iterator
+ * \tparam UnaryFn type of the function. Must have a prototype of `void f(T&)`.
+ * \param first beginning of the range
+ * \param last end of the range
+ * \param f function to apply to each element. Invoked concurrently from multiple threads.
+ * \throw Rethrows the first exception thrown by `f`, after all chunks have been processed.
+ */
+template<class ForwardIt, class UnaryFn>
+void parallel_for_each(ForwardIt first, ForwardIt last, UnaryFn f) {
+  using value_type = typename std::iterator_traits<ForwardIt>::value_type;
+
+  const auto n{static_cast<std::size_t>(std::distance(first, last))};
+  if (n == 0) {
+    return;
+  }
+
+  internal::_work_stealing_pool& pool{internal::_work_stealing_pool::_default()};
+  const std::vector<ForwardIt> bounds{
+      internal::_split_range(first, n, internal::_parallel_chunk_size<value_type>(n, pool._concurrency()))};
+
+  pool._parallel_invoke(bounds.size() - 1, [&](const std::size_t i) { std::for_each(bounds[i], bounds[i + 1], f); });
+}
+
+/**
+ * \brief Parallel version of `std::transform`.
+ *
+ * \tparam ForwardIt1 type of the input iterator
+ * \tparam ForwardIt2 type of the output iterator
+ * \tparam UnaryOp type of the function. Must have a prototype of `R f(const T&)`.
+ * \param first1 beginning of the input range
+ * \param last1 end of the input range
+ * \param d_first beginning of the output range
+ * \param op function to apply to each element. Invoked concurrently from multiple threads.
+ * \return Iterator to the element past the last element written.
+ * \throw Rethrows the first exception thrown by `op`, after all chunks have been processed.
+ */
+template<class ForwardIt1, class ForwardIt2, class UnaryOp>
+ForwardIt2 parallel_transform(ForwardIt1 first1, ForwardIt1 last1, ForwardIt2 d_first, UnaryOp op) {
+  using value_type = typename std::iterator_traits<ForwardIt1>::value_type;
+
+  const auto n{static_cast<std::size_t>(std::distance(first1, last1))};
+  if (n == 0) {
+    return d_first;
+  }
+
+  internal::_work_stealing_pool& pool{internal::_work_stealing_pool::_default()};
+  const std::size_t chunk_size{internal::_parallel_chunk_size<value_type>(n, pool._concurrency())};
+  const std::vector<ForwardIt1> in_bounds{internal::_split_range(first1, n, chunk_size)};
+  const std::vector<ForwardIt2> out_bounds{internal::_split_range(d_first, n, chunk_size)};
+
+  pool._parallel_invoke(in_bounds.size() - 1, [&](const std::size_t i) {
+    std::transform(in_bounds[i], in_bounds[i + 1], out_bounds[i], op);
+  });
+
+  return out_bounds.back();
+}
+
+/**
+ * \brief Parallel version of `std::reduce`.
+ *
+ * Elements are combined in an unspecified grouping, but in their original order.
+ *
+ * \tparam ForwardIt type of the iterator
+ * \tparam T type of the result
+ * \tparam BinaryOp type of the function. Must have a prototype of `T f(const T&, const T&)`, and must be associative.
+ * \param first beginning of the range
+ * \param last end of the range
+ * \param init initial value of the result
+ * \param op function to combine two values. Invoked concurrently from multiple threads.
+ * \return `init` combined with all elements in the range.
+ * \throw Rethrows the first exception thrown by `op`, after all chunks have been processed.
+ */
+template<class ForwardIt, class T, class BinaryOp>
+T parallel_reduce(ForwardIt first, ForwardIt last, T init, BinaryOp op) {
+  using value_type = typename std::iterator_traits<ForwardIt>::value_type;
+
+  const auto n{static_cast<std::size_t>(std::distance(first, last))};
+  if (n == 0) {
+    return init;
+  }
+
+  internal::_work_stealing_pool& pool{internal::_work_stealing_pool::_default()};
+  const std::vector<ForwardIt> bounds{
+      internal::_split_range(first, n, internal::_parallel_chunk_size<value_type>(n, pool._concurrency()))};
+
+  // Each chunk is non-empty, so its first element seeds its partial result.
+  std::vector<T> partials(bounds.size() - 1, init);
+  pool._parallel_invoke(bounds.size() - 1, [&](const std::size_t i) {
+    partials[i] = std::accumulate(std::next(bounds[i]), bounds[i + 1], T(*bounds[i]), op);
+  });
+
+  for (auto& partial : partials) {
+    init = op(std::move(init), std::move(partial));
+  }
+  return init;
+}
+
+/**
+ * \brief Parallel version of `std::reduce`, which adds all elements.
+ *
+ * \tparam ForwardIt type of the iterator
+ * \tparam T type of the result
+ * \param first beginning of the range
+ * \param last end of the range
+ * \param init initial value of the result
+ * \return The sum of `init` and all elements in the range.
+ */
+template<class ForwardIt, class T>
+T parallel_reduce(ForwardIt first, ForwardIt last, T init) {
+  return parallel_reduce(first, last, std::move(init), std::plus<T>{});
+}
+
+/**
+ * \brief Parallel version of `std::sort`.
+ *
+ * Sorts the range using quicksort, where the two partitions of each step are sorted in parallel. Partitions which fit
+ * in the L1 data cache are sorted sequentially, and the recursion falls back to `std::sort` if it becomes too deep.
+ *
+ * \tparam RandomIt type of the iterator
+ * \tparam Compare type of the comparator
+ * \param first beginning of the range
+ * \param last end of the range
+ * \param comp comparator which returns `true` if the first argument is less than the second. Invoked concurrently from
+ * multiple threads.
+ */
+template<class RandomIt, class Compare>
+void parallel_sort(RandomIt first, RandomIt last, Compare comp) {
+  using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+  const auto n{static_cast<std::size_t>(last - first)};
+  if (n < 2) {
+    return;
+  }
+
+  std::size_t depth_limit{0};
+  for (std::size_t i{n}; i != 0; i >>= 1) {
+    depth_limit += 2;
+  }
+
+  internal::_work_stealing_pool& pool{internal::_work_stealing_pool::_default()};
+  const std::size_t cutoff{internal::_parallel_chunk_size<value_type>(n, pool._concurrency())};
+  internal::_parallel_quicksort(pool, first, last, comp, cutoff, depth_limit);
+}
+
+/**
+ * \brief Parallel version of `std::sort`, which sorts the range in ascending order.
+ *
+ * \tparam RandomIt type of the iterator
+ * \param first beginning of the range
+ * \param last end of the range
+ */
+template<class RandomIt>
+void parallel_sort(RandomIt first, RandomIt last) {
+  parallel_sort(first, last, std::less<typename std::iterator_traits<RandomIt>::value_type>{});
+}
+
+}  // namespace stdext
+}  // namespace derplib
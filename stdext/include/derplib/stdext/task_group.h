@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#include <derplib/internal/work_stealing_pool.h>
+#include <derplib/stdext/type_traits.h>
+
+namespace derplib {
+inline namespace stdext {
+
+/**
+ * \brief A group of tasks which are executed in parallel and waited for together.
+ *
+ * Tasks are executed by the worker pool shared by the library. Threads which wait for a group execute pending tasks,
+ * and only block once no task is left to execute, so tasks may create their own groups and wait for them. This makes
+ * recursive divide-and-conquer algorithms safe regardless of the number of workers.
+ *
+ * The destructor waits for all tasks in the group, discarding any exception thrown by them.
+ */
+class task_group {
+ public:
+  task_group() : _pool_(internal::_work_stealing_pool::_default()), _pending_{0} {}
+
+  task_group(const task_group&) = delete;
+  task_group(task_group&&) noexcept = delete;
+
+  task_group& operator=(const task_group&) = delete;
+  task_group& operator=(task_group&&) noexcept = delete;
+
+  /**
+   * \brief Destructor.
+   *
+   * Waits for all tasks in the group.
+   */
+  ~task_group() {
+    _pool_._wait_until([this] { return _pending_.load(std::memory_order_acquire) == 0; });
+  }
+
+  /**
+   * \brief Adds a task to the group.
+   *
+   * \tparam Fn type of the task. Must have a prototype of `void f()`, and must be copy-constructible.
+   * \param fn task to execute
+   */
+  template<typename Fn>
+  void run(Fn&& fn) {
+    using task_type = stdext::decay_t<Fn>;
+
+    _pending_.fetch_add(1, std::memory_order_relaxed);
+    _pool_._submit(std::bind(&task_group::_execute<task_type>, this, task_type{std::forward<Fn>(fn)}));
+  }
+
+  /**
+   * \brief Executes a task on the calling thread, and then waits for all tasks in the group.
+   *
+   * \tparam Fn type of the task. Must have a prototype of `void f()`.
+   * \param fn task to execute
+   * \throw Rethrows the first exception thrown by any task in the group.
+   */
+  template<typename Fn>
+  void run_and_wait(Fn&& fn) {
+    try {
+      std::forward<Fn>(fn)();
+    } catch (...) {
+      _set_exception(std::current_exception());
+    }
+
+    wait();
+  }
+
+  /**
+   * \brief Waits for all tasks in the group, executing pending tasks of the pool in the meantime.
+   *
+   * \throw Rethrows the first exception thrown by any task in the group since the last call to `wait()`.
+   */
+  void wait() {
+    _pool_._wait_until([this] { return _pending_.load(std::memory_order_acquire) == 0; });
+
+    std::exception_ptr error{};
+    {
+      std::lock_guard<std::mutex> lk{_error_mutex_};
+      std::swap(error, _error_);
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+ private:
+  template<typename Fn>
+  void _execute(Fn& fn) {
+    try {
+      fn();
+    } catch (...) {
+      _set_exception(std::current_exception());
+    }
+
+    // This must be the last access to the group, as the group may be destroyed once the counter reaches zero.
+    internal::_work_stealing_pool& pool{_pool_};
+    if (_pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      pool._notify_done();
+    }
+  }
+
+  void _set_exception(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lk{_error_mutex_};
+    if (!_error_) {
+      _error_ = std::move(error);
+    }
+  }
+
+  internal::_work_stealing_pool& _pool_;
+
+  /**
+   * \brief Number of tasks which have been added but have not returned.
+   */
+  std::atomic_size_t _pending_;
+
+  std::mutex _error_mutex_;
+  std::exception_ptr _error_;
+};
+
+}  // namespace stdext
+}  // namespace derplib
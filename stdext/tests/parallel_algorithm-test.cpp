@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include <derplib/stdext/parallel_algorithm.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <list>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+namespace stdext = derplib::stdext;
+
+std::vector<int> make_random_vector(const std::size_t n) {
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<int> dist{-1000000, 1000000};
+
+  std::vector<int> v(n);
+  std::generate(v.begin(), v.end(), [&] { return dist(rng); });
+  return v;
+}
+
+TEST(ParallelAlgorithmTest, ForEachVisitsAllElements) {
+  std::vector<int> v(100000);
+  std::iota(v.begin(), v.end(), 0);
+
+  stdext::parallel_for_each(v.begin(), v.end(), [](int& i) { i *= 2; });
+
+  for (std::size_t i{0}; i < v.size(); ++i) {
+    EXPECT_EQ(static_cast<int>(i * 2), v[i]);
+  }
+}
+
+TEST(ParallelAlgorithmTest, ForEachForwardIterator) {
+  std::list<int> l(1000, 1);
+  std::atomic_int sum{0};
+
+  stdext::parallel_for_each(l.begin(), l.end(), [&](const int i) { sum += i; });
+
+  EXPECT_EQ(1000, sum);
+}
+
+TEST(ParallelAlgorithmTest, ForEachPropagatesException) {
+  std::vector<int> v(10000);
+  std::iota(v.begin(), v.end(), 0);
+
+  EXPECT_THROW(stdext::parallel_for_each(v.begin(), v.end(),
+                                         [](const int i) {
+                                           if (i == 5000) {
+                                             throw std::runtime_error{"error"};
+                                           }
+                                         }),
+               std::runtime_error);
+}
+
+TEST(ParallelAlgorithmTest, Transform) {
+  const std::vector<int> in{make_random_vector(100000)};
+  std::vector<long> out(in.size());
+
+  const auto it{stdext::parallel_transform(in.begin(), in.end(), out.begin(), [](const int i) { return i * 3L; })};
+
+  EXPECT_EQ(out.end(), it);
+  for (std::size_t i{0}; i < in.size(); ++i) {
+    EXPECT_EQ(in[i] * 3L, out[i]);
+  }
+}
+
+TEST(ParallelAlgorithmTest, Reduce) {
+  const std::vector<int> v{make_random_vector(100000)};
+
+  EXPECT_EQ(std::accumulate(v.begin(), v.end(), 0L), stdext::parallel_reduce(v.begin(), v.end(), 0L));
+  EXPECT_EQ(7, stdext::parallel_reduce(v.begin(), v.begin(), 7));
+}
+
+TEST(ParallelAlgorithmTest, ReducePreservesOrder) {
+  std::vector<std::string> v(5000);
+  for (std::size_t i{0}; i < v.size(); ++i) {
+    v[i] = std::to_string(i % 10);
+  }
+
+  const std::string expected{std::accumulate(v.begin(), v.end(), std::string{">"})};
+  EXPECT_EQ(expected, stdext::parallel_reduce(v.begin(), v.end(), std::string{">"}));
+}
+
+TEST(ParallelAlgorithmTest, Sort) {
+  for (const std::size_t n : {0, 1, 2, 1000, 100000, 250001}) {
+    std::vector<int> v{make_random_vector(n)};
+    std::vector<int> expected{v};
+    std::sort(expected.begin(), expected.end());
+
+    stdext::parallel_sort(v.begin(), v.end());
+    EXPECT_EQ(expected, v);
+  }
+}
+
+TEST(ParallelAlgorithmTest, SortWithComparator) {
+  std::vector<int> v{make_random_vector(100000)};
+  std::vector<int> expected{v};
+  std::sort(expected.begin(), expected.end(), std::greater<int>{});
+
+  stdext::parallel_sort(v.begin(), v.end(), std::greater<int>{});
+  EXPECT_EQ(expected, v);
+}
+
+TEST(ParallelAlgorithmTest, NestedInvocation) {
+  std::vector<std::vector<int>> vs(16);
+  for (auto& v : vs) {
+    v = make_random_vector(10000);
+  }
+
+  stdext::parallel_for_each(vs.begin(), vs.end(),
+                            [](std::vector<int>& v) { stdext::parallel_sort(v.begin(), v.end()); });
+
+  for (const auto& v : vs) {
+    EXPECT_TRUE(std::is_sorted(v.begin(), v.end()));
+  }
+}
+}  // namespace
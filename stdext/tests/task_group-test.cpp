@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <derplib/stdext/task_group.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+namespace stdext = derplib::stdext;
+
+int fibonacci(const int n) {
+  if (n < 2) {
+    return n;
+  }
+
+  int a{0};
+  int b{0};
+  stdext::task_group group{};
+  group.run([&] { a = fibonacci(n - 1); });
+  group.run_and_wait([&] { b = fibonacci(n - 2); });
+  return a + b;
+}
+
+TEST(TaskGroupTest, RunsAllTasks) {
+  constexpr int tasks{1000};
+  std::atomic_int count{0};
+
+  stdext::task_group group{};
+  for (int i{0}; i < tasks; ++i) {
+    group.run([&] { ++count; });
+  }
+  group.wait();
+
+  EXPECT_EQ(tasks, count);
+}
+
+TEST(TaskGroupTest, NestedGroups) {
+  // Every task waits on its own subtasks, which would deadlock a pool which blocks waiting threads.
+  EXPECT_EQ(6765, fibonacci(20));
+}
+
+TEST(TaskGroupTest, WaitRethrowsException) {
+  std::atomic_int count{0};
+
+  stdext::task_group group{};
+  group.run([] { throw std::runtime_error{"error"}; });
+  for (int i{0}; i < 10; ++i) {
+    group.run([&] { ++count; });
+  }
+
+  EXPECT_THROW(group.wait(), std::runtime_error);
+  EXPECT_EQ(10, count);
+
+  // The exception is only rethrown once.
+  EXPECT_NO_THROW(group.wait());
+}
+
+TEST(TaskGroupTest, RunAndWaitRethrowsException) {
+  stdext::task_group group{};
+  EXPECT_THROW(group.run_and_wait([] { throw std::logic_error{"error"}; }), std::logic_error);
+}
+
+TEST(TaskGroupTest, DestructorWaits) {
+  std::atomic_int count{0};
+
+  {
+    stdext::task_group group{};
+    for (int i{0}; i < 10; ++i) {
+      group.run([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        ++count;
+      });
+    }
+  }
+
+  EXPECT_EQ(10, count);
+}
+
+TEST(TaskGroupTest, WaitDoesNotSpinWhenIdle) {
+  constexpr std::chrono::milliseconds sleep{200};
+
+  stdext::task_group group{};
+  group.run([&] { std::this_thread::sleep_for(sleep); });
+
+  // Let a worker take the task, so that the waiting thread has nothing left to execute.
+  std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  const std::clock_t start{std::clock()};
+  group.wait();
+  const std::clock_t cpu_time{std::clock() - start};
+
+  // A waiting thread which keeps polling the pool would use the CPU for the whole duration of the task.
+  EXPECT_LT(cpu_time, CLOCKS_PER_SEC * (sleep / 4).count() / 1000);
+}
+}  // namespace